@@ -0,0 +1,211 @@
+#include "Body.h"
+#include "World.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+constexpr float k_timeStep = 1.0f / 60.0f;
+constexpr uint32_t k_warmUpSteps = 60;
+constexpr uint32_t k_measuredSteps = 240;
+
+// Counts the last-level cache misses of this thread, where the system
+// exposes hardware counters.
+struct CacheMissCounter
+{
+    CacheMissCounter();
+    ~CacheMissCounter();
+    bool IsAvailable() const;
+    void Start();
+    uint64_t Stop();
+
+    int m_file;
+};
+
+#if defined(__linux__)
+
+CacheMissCounter::CacheMissCounter()
+{
+    perf_event_attr attributes;
+    std::memset(&attributes, 0, sizeof(attributes));
+    attributes.size = sizeof(attributes);
+    attributes.type = PERF_TYPE_HARDWARE;
+    attributes.config = PERF_COUNT_HW_CACHE_MISSES;
+    attributes.disabled = 1;
+    attributes.exclude_kernel = 1;
+    attributes.exclude_hv = 1;
+    m_file = static_cast<int>(syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0));
+}
+
+CacheMissCounter::~CacheMissCounter()
+{
+    if (m_file >= 0)
+    {
+        close(m_file);
+    }
+}
+
+void CacheMissCounter::Start()
+{
+    ioctl(m_file, PERF_EVENT_IOC_RESET, 0);
+    ioctl(m_file, PERF_EVENT_IOC_ENABLE, 0);
+}
+
+uint64_t CacheMissCounter::Stop()
+{
+    ioctl(m_file, PERF_EVENT_IOC_DISABLE, 0);
+
+    uint64_t count = 0;
+    if (read(m_file, &count, sizeof(count)) != sizeof(count))
+    {
+        return 0;
+    }
+
+    return count;
+}
+
+#else
+
+CacheMissCounter::CacheMissCounter()
+: m_file(-1)
+{
+}
+
+CacheMissCounter::~CacheMissCounter()
+{
+}
+
+void CacheMissCounter::Start()
+{
+}
+
+uint64_t CacheMissCounter::Stop()
+{
+    return 0;
+}
+
+#endif
+
+bool CacheMissCounter::IsAvailable() const
+{
+    return m_file >= 0;
+}
+
+static Body* CreateBox(World& world, Material* material, const glm::vec3& halfSize, float mass, const glm::vec3& position)
+{
+    Handle<Body> handle = world.CreateBody();
+    ShapeBox* shape = static_cast<ShapeBox*>(world.Get(world.CreateShape(handle, ShapeType::Box)));
+    shape->Set(halfSize);
+    shape->m_material = material;
+
+    Body* body = world.Get(handle);
+    body->SetMass(mass);
+    body->m_state->m_position = position;
+    world.Add(body);
+
+    return body;
+}
+
+// Boxes too far apart to touch, so that the step is mostly the work done
+// per body.
+static void CreateScatter(World& world, Material* material)
+{
+    for (int x = 0; x < 20; ++x)
+    {
+        for (int y = 0; y < 5; ++y)
+        {
+            for (int z = 0; z < 20; ++z)
+            {
+                CreateBox(world, material, glm::vec3(0.5f, 0.5f, 0.5f), 1.0f, glm::vec3(4.0f * x, 4.0f * y, 4.0f * z));
+            }
+        }
+    }
+}
+
+// Many stacked bodies in contact, so that the solver dominates.
+static void CreatePyramids(World& world, Material* material)
+{
+    CreateBox(world, material, glm::vec3(200.0f, 10.0f, 200.0f), std::numeric_limits<float>::infinity(), glm::vec3(0.0f, -10.0f, 0.0f));
+
+    for (int p = 0; p < 25; ++p)
+    {
+        glm::vec3 x(-6.0f + 20.0f * (p % 5), 0.5f, 20.0f * (p / 5));
+
+        for (int i = 0; i < 10; ++i)
+        {
+            glm::vec3 y = x;
+
+            for (int j = i; j < 10; ++j)
+            {
+                CreateBox(world, material, glm::vec3(0.5f, 0.5f, 0.5f), 1.0f, y);
+                y += glm::vec3(1.125f, 0.0f, 0.0f);
+            }
+
+            x += glm::vec3(0.5625f, 1.0f, 0.0f);
+        }
+    }
+}
+
+struct Scene
+{
+    const char* m_name;
+    void (*m_create)(World&, Material*);
+};
+
+int main(int argc, char** argv)
+{
+    const Scene scenes[] =
+    {
+        { "scatter", CreateScatter },
+        { "pyramids", CreatePyramids },
+    };
+
+    CacheMissCounter cacheMissCounter;
+
+    for (const Scene& scene : scenes)
+    {
+        if ((argc > 1) && (std::strcmp(argv[1], scene.m_name) != 0))
+        {
+            continue;
+        }
+
+        World world(glm::vec3(0.0f, -10.0f, 0.0f), 10);
+        Handle<Material> material = world.CreateMaterial();
+        scene.m_create(world, world.Get(material));
+
+        for (uint32_t i = 0; i < k_warmUpSteps; ++i)
+        {
+            world.Step(k_timeStep);
+        }
+
+        if (cacheMissCounter.IsAvailable())
+        {
+            cacheMissCounter.Start();
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        for (uint32_t i = 0; i < k_measuredSteps; ++i)
+        {
+            world.Step(k_timeStep);
+        }
+        const auto end = std::chrono::steady_clock::now();
+
+        const double milliseconds = std::chrono::duration<double, std::milli>(end - start).count() / k_measuredSteps;
+        std::printf("%s: %zu bodies, %.3f ms per step", scene.m_name, world.m_bodies.size(), milliseconds);
+        if (cacheMissCounter.IsAvailable())
+        {
+            std::printf(", %.0f cache misses per step", static_cast<double>(cacheMissCounter.Stop()) / k_measuredSteps);
+        }
+        std::printf("\n");
+    }
+
+    return EXIT_SUCCESS;
+}
\ No newline at end of file
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// Where the world gets the memory for its objects and internal containers.
+// Implementations must be safe to call from several threads.
+struct Allocator
+{
+    virtual ~Allocator() = default;
+    virtual void* Allocate(size_t size, size_t alignment) = 0;
+    virtual void Free(void* memory, size_t size, size_t alignment) = 0;
+    // Readies count allocations of the given size and alignment so that
+    // making them later takes no new memory. Does nothing by default.
+    virtual void Reserve(size_t /*size*/, size_t /*alignment*/, size_t /*count*/) {}
+};
+
+struct HeapAllocator : Allocator
+{
+    void* Allocate(size_t size, size_t alignment) override;
+    void Free(void* memory, size_t size, size_t alignment) override;
+};
+
+Allocator* GetHeapAllocator();
+
+struct ArenaBlock
+{
+    ArenaBlock* m_next;
+    size_t m_size;
+};
+
+// Hands out memory from large blocks taken from the parent and gives it
+// all back at once on Reset or destruction. Free does nothing. Objects
+// still in the arena are not destroyed, so a level whose objects hold no
+// other resources can be dropped without visiting them.
+struct ArenaAllocator : Allocator
+{
+    explicit ArenaAllocator(size_t blockSize, Allocator* parent = GetHeapAllocator());
+    ~ArenaAllocator() override;
+    void* Allocate(size_t size, size_t alignment) override;
+    void Free(void* memory, size_t size, size_t alignment) override;
+    void Reset();
+
+    Allocator* m_parent;
+    size_t m_blockSize;
+    ArenaBlock* m_blocks;
+    unsigned char* m_cursor;
+    unsigned char* m_end;
+    std::mutex m_mutex;
+};
+
+// Rounds small allocations up to a power of two and keeps freed ones in a
+// list per size, so containers and nodes that come and go every step are
+// recycled in constant time. Small allocations are cut from blocks taken
+// from the parent, larger ones are passed to it.
+struct PoolAllocator : Allocator
+{
+    static constexpr size_t k_minSize = 16;
+    static constexpr size_t k_maxSize = 4096;
+    static constexpr size_t k_sizeClassCount = 9;
+    static constexpr size_t k_blockSize = 64 * 1024;
+
+    explicit PoolAllocator(Allocator* parent = GetHeapAllocator());
+    ~PoolAllocator() override;
+    void* Allocate(size_t size, size_t alignment) override;
+    void Free(void* memory, size_t size, size_t alignment) override;
+    // Cuts slots of the size class from blocks until its free list holds
+    // count of them.
+    void Reserve(size_t size, size_t alignment, size_t count) override;
+
+    Allocator* m_parent;
+    ArenaBlock* m_blocks;
+    unsigned char* m_cursor;
+    unsigned char* m_end;
+    void* m_freeLists[k_sizeClassCount];
+    std::mutex m_mutex;
+};
+
+// Lets standard containers allocate from an Allocator.
+template <typename T>
+struct StlAllocator
+{
+    using value_type = T;
+
+    StlAllocator(Allocator* allocator)
+    : m_allocator(allocator)
+    {
+    }
+
+    template <typename U>
+    StlAllocator(const StlAllocator<U>& other)
+    : m_allocator(other.m_allocator)
+    {
+    }
+
+    T* allocate(size_t count)
+    {
+        return static_cast<T*>(m_allocator->Allocate(count * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T* memory, size_t count)
+    {
+        m_allocator->Free(memory, count * sizeof(T), alignof(T));
+    }
+
+    Allocator* m_allocator;
+};
+
+template <typename T, typename U>
+bool operator==(const StlAllocator<T>& a, const StlAllocator<U>& b)
+{
+    return a.m_allocator == b.m_allocator;
+}
+
+template <typename T, typename U>
+bool operator!=(const StlAllocator<T>& a, const StlAllocator<U>& b)
+{
+    return a.m_allocator != b.m_allocator;
+}
+
+template <typename T>
+using Vector = std::vector<T, StlAllocator<T>>;
\ No newline at end of file
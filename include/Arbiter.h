@@ -1,20 +1,52 @@
 #pragma once
 
 #include <Collide.h>
+#include <Solver.h>
+
+constexpr float g_velocityThreshold = 1.0f;
+
+struct ConstraintRow;
+
+bool SolveContactLCP(const float k[g_maxContactPoints][g_maxContactPoints], const float* b, size_t count, float* x);
 
 struct Arbiter
 {
-    Arbiter(Shape* shape1, Shape* shape2);
+    // The materials of the shapes are combined by the caller.
+    Arbiter(Shape* shape1, Shape* shape2, float margin, const MaterialPair& materialPair);
     void Update(Contact* contacts, size_t contactCount, Contact* newContacts, size_t& newContactCount);
-    void PreStep(float invElapsedTime);
-    void ApplyImpulse();
+    void PreStep(const SolverBodies& bodies, float invElapsedTime, bool useBlockSolver, bool useSplitImpulse);
+    void WarmStart(SolverBodies& bodies) const;
+    // The solve functions return the largest impulse change they made.
+    float ApplyImpulse(SolverBodies& bodies);
+    bool ApplyNormalBlock(float invMass1, float invMass2, const glm::mat3& invI1, const glm::mat3& invI2, glm::vec3& v1, glm::vec3& w1, glm::vec3& v2, glm::vec3& w2, float& residual);
+    void WarmStartPseudoImpulse(SolverBodies& bodies) const;
+    float ApplyPseudoImpulse(SolverBodies& bodies);
+    float ApplyImpulseMassSplit(const SolverBodies& bodies, float share1, float share2, glm::vec3* velocityDeltas);
+    float ApplyFriction(Contact* c, float massTangent, float massBitangent, float invMass1, float invMass2, const glm::mat3& invI1, const glm::mat3& invI2, glm::vec3& v1, glm::vec3& w1, glm::vec3& v2, glm::vec3& w2) const;
+    float SolveSoft(SolverBodies& bodies, const Softness& softness, float invSubStep, float maxPushVelocity, bool useBias);
+    void ApplyRestitution(SolverBodies& bodies);
+    // A normal, tangent and bitangent row per contact, in that order.
+    uint32_t GetRowCount() const
+    {
+        return static_cast<uint32_t>(3 * m_contactCount);
+    }
+    void BuildRows(const SolverBodies& bodies, ConstraintRow* rows) const;
+    void StoreRows(const ConstraintRow* rows);
 
+    Shape* m_shape1;
+    Shape* m_shape2;
     Body* m_body1;
     Body* m_body2;
+    uint32_t m_index1;
+    uint32_t m_index2;
     Contact m_contacts[g_maxContactPoints];
     size_t m_contactCount;
+    // Couples the normal impulses of the contacts, for the block solver.
+    float m_normalCoupling[g_maxContactPoints][g_maxContactPoints];
+    bool m_useBlockSolver;
     float m_staticFriction;
     float m_dynamicFriction;
     float m_restitution;
     bool m_isTrigger;
+    uint32_t m_timestamp;
 };
\ No newline at end of file
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+
+struct Body;
+
+constexpr uint32_t g_invalidLink = 0xFFFFFFFF;
+
+// A 6D motion or force vector with its angular part first, both taken
+// about the world origin.
+struct SpatialVector
+{
+    glm::vec3 m_angular;
+    glm::vec3 m_linear;
+};
+
+// A 6x6 matrix as 3x3 blocks, [m_a m_b; m_c m_d].
+struct SpatialMatrix
+{
+    glm::mat3 m_a;
+    glm::mat3 m_b;
+    glm::mat3 m_c;
+    glm::mat3 m_d;
+};
+
+// A body of an articulation, attached to its parent link by a ball joint.
+struct ArticulationLink
+{
+    Body* m_body;
+    uint32_t m_parent;
+    glm::vec3 m_parentAnchor;
+    glm::vec3 m_childAnchor;
+    // Angular velocity relative to the parent link, in world space.
+    glm::vec3 m_jointVelocity;
+    glm::vec3 m_jointAcceleration;
+
+    // Articulated-body algorithm terms.
+    glm::vec3 m_pivot;
+    SpatialVector m_velocity;
+    SpatialVector m_bias;
+    SpatialVector m_force;
+    SpatialVector m_acceleration;
+    SpatialMatrix m_inertia;
+    glm::mat3 m_Ut;
+    glm::mat3 m_Ub;
+    glm::mat3 m_invD;
+    glm::vec3 m_u;
+
+    glm::vec3 m_savedVelocity;
+    glm::vec3 m_savedAngularVelocity;
+};
+
+// A tree of bodies simulated in reduced coordinates with the articulated
+// body algorithm, so its joints hold exactly at a cost linear in the number
+// of links. The link bodies are added to the world as usual and collide
+// through the contact pipeline. Their contacts are solved as if the links
+// were free, and the velocity changes are then turned into impulses on the
+// whole tree. The links of one articulation do not collide with each other.
+struct Articulation
+{
+    Articulation();
+    // Links must be added parents first. The first link is the root, which
+    // moves freely unless PinRoot fixes a point of it to the world.
+    uint32_t AddLink(Body* body, uint32_t parent, const glm::vec3& anchor);
+    void PinRoot(const glm::vec3& anchor);
+
+    // Called by the world before forces are integrated, after the velocities
+    // are solved and after the positions are integrated.
+    void PreStep(float elapsedTime);
+    void ApplyImpulses();
+    void UpdatePositions();
+
+    void UpdateVelocities();
+    void ComputeInertias();
+    void ComputeVelocityForces();
+    void ComputeAccelerations(bool isImpulse);
+
+    std::vector<ArticulationLink> m_links;
+    // Steps the velocity-dependent forces are integrated in per world step.
+    uint32_t m_velocitySubSteps;
+    // The velocity terms are still explicit, so long undamped chains whipping
+    // around at large time steps gain some energy. Joint damping, in 1/s,
+    // and a limit on the joint speeds, in rad/s, keep them in check.
+    float m_jointDamping;
+    float m_maxJointVelocity;
+    float m_timeStep;
+    bool m_isPinned;
+    glm::vec3 m_pinAnchor;
+};
\ No newline at end of file
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "Allocator.h"
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <vector>
+
+struct AABB
+{
+    AABB()
+    : m_min(0.0f, 0.0f, 0.0f)
+    , m_max(0.0f, 0.0f, 0.0f)
+    {
+    }
+
+    AABB(const glm::vec3& min, const glm::vec3& max)
+    : m_min(min)
+    , m_max(max)
+    {
+    }
+
+    glm::vec3 GetCenter() const
+    {
+        return (m_min + m_max) * 0.5f;
+    }
+
+    glm::vec3 GetHalfExtents() const
+    {
+        return (m_max - m_min) * 0.5f;
+    }
+
+    glm::vec3 m_min;
+    glm::vec3 m_max;
+};
+
+bool Overlap(const AABB& a, const AABB& b);
+AABB Merge(const AABB& a, const AABB& b);
+AABB Fatten(const AABB& aabb, float margin);
+AABB TransformAABB(const AABB& aabb, const glm::vec3& position, const glm::quat& rotation);
+
+struct BVHNode
+{
+    bool IsLeaf() const
+    {
+        return m_count > 0;
+    }
+
+    AABB m_aabb;
+    // Leaves store the first index into BVH::m_leaves, interior nodes the
+    // index of their first child (the second child immediately follows it).
+    uint32_t m_first;
+    uint32_t m_count;
+};
+
+struct BVHPair
+{
+    uint32_t m_index1;
+    uint32_t m_index2;
+};
+
+// Bounding volume hierarchy over a small set of local-space boxes, used
+// to cull the shape pairs of two compound bodies before narrowphase.
+struct BVH
+{
+    void Build(const AABB* leafAABBs, size_t leafCount);
+
+    bool IsEmpty() const
+    {
+        return m_nodes.empty();
+    }
+
+    const AABB& GetRootAABB() const
+    {
+        return m_nodes[0].m_aabb;
+    }
+
+    std::vector<BVHNode> m_nodes;
+    std::vector<uint32_t> m_leaves;
+};
+
+// Appends to pairs every (leaf of bvh1, leaf of bvh2) whose boxes overlap
+// once both hierarchies are placed in world space and inflated by margin.
+void QueryPairs(const BVH& bvh1, const glm::vec3& position1, const glm::quat& rotation1, const BVH& bvh2, const glm::vec3& position2, const glm::quat& rotation2, float margin, Vector<BVHPair>& pairs, Vector<BVHPair>& stack);
\ No newline at end of file
@@ -1,10 +1,13 @@
 #pragma once
 
+#include "BVH.h"
 #include <glm/glm.hpp>
 #include <glm/gtc/quaternion.hpp>
 #include <vector>
 
+struct Articulation;
 struct Body;
+struct World;
 
 enum class CombineMode
 {
@@ -14,17 +17,41 @@ enum class CombineMode
     Maximum
 };
 
+constexpr uint32_t g_invalidMaterialID = 0xFFFFFFFF;
+
 struct Material
 {
     Material();
-
+    // Copies only the values. A copy belongs to no world, and assigning to
+    // a material keeps the world and row it already has.
+    Material(const Material& other);
+    Material& operator=(const Material& other);
+
+    // Call World::UpdateMaterial after changing these on a material that a
+    // world created, so that its pair table has them before the next
+    // lookup. Steps only catch up on changes made without it at their
+    // start.
     float m_staticFriction;
     float m_dynamicFriction;
     float m_restitution;
     CombineMode m_frictionCombineMode;
     CombineMode m_restitutionCombineMode;
+    // The world that created the material, if any, and the row of the
+    // material in that world's pair table.
+    const World* m_world;
+    uint32_t m_id;
 };
 
+// Friction and restitution of two touching materials.
+struct MaterialPair
+{
+    float m_staticFriction;
+    float m_dynamicFriction;
+    float m_restitution;
+};
+
+MaterialPair CombineMaterials(const Material& material1, const Material& material2);
+
 enum class ShapeType : size_t
 {
     Box,
@@ -35,13 +62,17 @@ enum class ShapeType : size_t
 
 struct Shape
 {
-    ~Shape();
+    virtual ~Shape();
 
     Body* m_owner;
     glm::vec3 m_position;
     glm::quat m_rotation;
     Material* m_material;
 
+    // Moves the shape on its body and has the body's BVH rebuilt. Writing
+    // m_position or m_rotation directly leaves the BVH of the body the
+    // shape is already on stale.
+    void SetTransform(const glm::vec3& position, const glm::quat& rotation);
     void SetIsTrigger(bool isTrigger);
 
     bool IsTrigger() const
@@ -72,6 +103,7 @@ struct ShapeBox : Shape
     ShapeBox();
     void Set(const glm::vec3& halfSize);
     glm::vec3 ComputeI(float mass) const;
+    AABB ComputeAABB() const;
 
     glm::vec3 m_halfSize;
 };
@@ -81,6 +113,7 @@ struct ShapeSphere : Shape
     ShapeSphere();
     void Set(float radius);
     glm::vec3 ComputeI(float mass) const;
+    AABB ComputeAABB() const;
 
     float m_radius;
 };
@@ -90,32 +123,63 @@ struct ShapeCapsule : Shape
     ShapeCapsule();
     void Set(float radius, float halfHeight);
     glm::vec3 ComputeI(float mass) const;
+    AABB ComputeAABB() const;
 
     float m_radius;
     float m_halfHeight;
 };
 
+// Returns R * diag(diagonal) * R^T.
+glm::mat3 RotateDiagonal(const glm::quat& rotation, const glm::vec3& diagonal);
+
+// Everything about a body that the integration and solver staging loops
+// of a step read and write. A world keeps the states of its bodies packed
+// in one array, in the order of World::m_bodies, and points each body at
+// its entry. A body outside a world points at its own copy.
+struct BodyState
+{
+    glm::vec3 m_position;
+    float m_invMass;
+    glm::quat m_rotation;
+    glm::vec3 m_velocity;
+    float m_linearDamping;
+    glm::vec3 m_angularVelocity;
+    float m_angularDamping;
+    glm::vec3 m_force;
+    glm::vec3 m_torque;
+    // Inverse inertia about the body axes.
+    glm::vec3 m_invI;
+    bool m_useGravity;
+    bool m_useCCD;
+};
+
 struct Body
 {
     Body();
     ~Body();
+    Body(const Body&) = delete;
+    Body& operator=(const Body&) = delete;
     void SetMass(float mass);
     void AddForce(const glm::vec3& force);
     void AddShape(Shape* shape);
     void ComputeInvI();
+    void UpdateBVH();
+
+    // Only valid until the body is added to or removed from a world, or
+    // another body is.
+    BodyState* m_state;
+    BodyState m_localState;
+    // The index of the body in World::m_bodies and the solver arrays.
+    uint32_t m_solverIndex;
 
     void* userData;
-    glm::vec3 m_position;
-    glm::quat m_rotation;
-    glm::vec3 m_velocity;
-    glm::vec3 m_angularVelocity;
-    glm::vec3 m_force;
-    glm::vec3 m_torque;
     float m_mass;
-    float m_invMass;
-    float m_linearDamping;
-    float m_angularDamping;
-    bool m_useGravity;
     std::vector<Shape*> m_shapes;
-    glm::mat3 m_invI;
+    BVH m_bvh;
+    // Scratch for the shape boxes UpdateBVH builds from, kept so that
+    // rebuilds reuse its memory.
+    std::vector<AABB> m_shapeAABBs;
+    bool m_bvhDirty;
+    Articulation* m_articulation;
+    uint32_t m_linkIndex;
 };
\ No newline at end of file
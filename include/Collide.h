@@ -16,6 +16,10 @@ struct Contact
     , m_massTangent(0.0f)
     , m_massBitangent(0.0f)
     , m_bias(0.0f)
+    , m_positionBias(0.0f)
+    , m_Pp(0.0f)
+    , m_adjustedSeparation(0.0f)
+    , m_relativeVelocity(0.0f)
     , m_feature(0)
     {
     }
@@ -24,6 +28,8 @@ struct Contact
     glm::vec3 m_normal;
     glm::vec3 m_r1;
     glm::vec3 m_r2;
+    glm::vec3 m_tangent;
+    glm::vec3 m_bitangent;
     float m_separation;
     float m_Pn;
     float m_Pt;
@@ -32,13 +38,22 @@ struct Contact
     float m_massTangent;
     float m_massBitangent;
     float m_bias;
+    // Split impulse: the penetration is resolved by a pseudo-velocity
+    // impulse that moves the bodies without changing their velocities.
+    float m_positionBias;
+    float m_Pp;
+    // Separation minus the anchor offset along the normal, so that the
+    // substepping solver can track the separation from body motion alone.
+    float m_adjustedSeparation;
+    float m_relativeVelocity;
     uint32_t m_feature;
 };
 
-size_t CollideBoxBox(Contact* contacts, glm::vec3 positionShape1, glm::quat rotationShape1, Shape* shape1, glm::vec3 positionShape2, glm::quat rotationShape2, Shape* shape2);
-size_t CollideBoxSphere(Contact* contacts, glm::vec3 positionShape1, glm::quat rotationShape1, Shape* shape1, glm::vec3 positionShape2, glm::quat rotationShape2, Shape* shape2);
-size_t CollideBoxCapsule(Contact* contacts, glm::vec3 positionShape1, glm::quat rotationShape1, Shape* shape1, glm::vec3 positionShape2, glm::quat rotationShape2, Shape* shape2);
-size_t CollideSphereSphere(Contact* contacts, glm::vec3 positionShape1, glm::quat rotationShape1, Shape* shape1, glm::vec3 positionShape2, glm::quat rotationShape2, Shape* shape2);
-size_t CollideSphereCapsule(Contact* contacts, glm::vec3 positionShape1, glm::quat rotationShape1, Shape* shape1, glm::vec3 positionShape2, glm::quat rotationShape2, Shape* shape2);
-size_t CollideCapsuleCapsule(Contact* contacts, glm::vec3 positionShape1, glm::quat rotationShape1, Shape* shape1, glm::vec3 positionShape2, glm::quat rotationShape2, Shape* shape2);
-size_t Collide(Contact* contacts, Body* body1, Shape* shape1, Body* body2, Shape* shape2);
\ No newline at end of file
+size_t CollideBoxBox(Contact* contacts, glm::vec3 positionShape1, glm::quat rotationShape1, Shape* shape1, glm::vec3 positionShape2, glm::quat rotationShape2, Shape* shape2, float margin);
+size_t CollideBoxSphere(Contact* contacts, glm::vec3 positionShape1, glm::quat rotationShape1, Shape* shape1, glm::vec3 positionShape2, glm::quat rotationShape2, Shape* shape2, float margin);
+size_t CollideBoxCapsule(Contact* contacts, glm::vec3 positionShape1, glm::quat rotationShape1, Shape* shape1, glm::vec3 positionShape2, glm::quat rotationShape2, Shape* shape2, float margin);
+size_t CollideSphereSphere(Contact* contacts, glm::vec3 positionShape1, glm::quat rotationShape1, Shape* shape1, glm::vec3 positionShape2, glm::quat rotationShape2, Shape* shape2, float margin);
+size_t CollideSphereCapsule(Contact* contacts, glm::vec3 positionShape1, glm::quat rotationShape1, Shape* shape1, glm::vec3 positionShape2, glm::quat rotationShape2, Shape* shape2, float margin);
+size_t CollideCapsuleCapsule(Contact* contacts, glm::vec3 positionShape1, glm::quat rotationShape1, Shape* shape1, glm::vec3 positionShape2, glm::quat rotationShape2, Shape* shape2, float margin);
+size_t Collide(Contact* contacts, Body* body1, Shape* shape1, Body* body2, Shape* shape2, float margin);
+size_t Collide(Contact* contacts, const glm::vec3& positionBody1, const glm::quat& rotationBody1, Shape* shape1, const glm::vec3& positionBody2, const glm::quat& rotationBody2, Shape* shape2, float margin);
\ No newline at end of file
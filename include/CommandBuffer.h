@@ -0,0 +1,60 @@
+#pragma once
+
+#include "Allocator.h"
+#include <glm/glm.hpp>
+#include <mutex>
+
+struct Body;
+struct Joint;
+struct Shape;
+struct ShapeBox;
+struct ShapeSphere;
+struct ShapeCapsule;
+
+enum class WorldCommandType
+{
+    AddBody,
+    RemoveBody,
+    AddJoint,
+    RemoveJoint,
+    AddShape,
+    SetBox,
+    SetSphere,
+    SetCapsule,
+    SetIsTrigger,
+    SetMass
+};
+
+struct WorldCommand
+{
+    WorldCommandType m_type;
+    Body* m_body;
+    Joint* m_joint;
+    Shape* m_shape;
+    // Half size for boxes; radius and half height for spheres and capsules;
+    // mass or trigger flag in x.
+    glm::vec3 m_values;
+};
+
+// World mutations recorded from listener callbacks or from other threads
+// while a step runs. World::Step applies them all at its start.
+struct CommandBuffer
+{
+    explicit CommandBuffer(Allocator* allocator);
+    void AddBody(Body* body);
+    void RemoveBody(Body* body);
+    void AddJoint(Joint* joint);
+    void RemoveJoint(Joint* joint);
+    void AddShape(Body* body, Shape* shape);
+    void SetBox(ShapeBox* shape, const glm::vec3& halfSize);
+    void SetSphere(ShapeSphere* shape, float radius);
+    void SetCapsule(ShapeCapsule* shape, float radius, float halfHeight);
+    void SetIsTrigger(Shape* shape, bool isTrigger);
+    void SetMass(Body* body, float mass);
+    void Record(WorldCommandType type, Body* body, Joint* joint, Shape* shape, const glm::vec3& values);
+    // Moves the recorded commands into commands, leaving the buffer empty.
+    void Swap(Vector<WorldCommand>& commands);
+
+    std::mutex m_mutex;
+    Vector<WorldCommand> m_commands;
+};
\ No newline at end of file
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "Solver.h"
+#include <glm/glm.hpp>
+
+// One scalar velocity constraint between two bodies,
+// dot(m_linear, v2 - v1) + dot(m_angular1, w1) + dot(m_angular2, w2) = bias,
+// with its accumulated impulse kept between two bounds. Contacts write their
+// rows after PreStep so that a single loop solves them together with the
+// rows that joints keep.
+struct ConstraintRow
+{
+    glm::vec3 m_linear;
+    glm::vec3 m_angular1;
+    glm::vec3 m_angular2;
+    // Inverse inertia times the angular terms, for applying impulses.
+    glm::vec3 m_response1;
+    glm::vec3 m_response2;
+    float m_invMass1;
+    float m_invMass2;
+    float m_mass;
+    float m_bias;
+    // Position error at PreStep, from which the soft solver tracks the
+    // current one as the bodies move.
+    float m_separation;
+    float m_softness;
+    float m_lower;
+    float m_upper;
+    // For friction rows, how many rows back the normal row is whose impulse
+    // bounds this one. Zero for rows with fixed bounds.
+    uint32_t m_normalOffset;
+    float m_staticFriction;
+    float m_dynamicFriction;
+    float m_impulse;
+    uint32_t m_index1;
+    uint32_t m_index2;
+};
+
+void InitRow(ConstraintRow& row, const SolverBodies& bodies, uint32_t index1, uint32_t index2, const glm::vec3& linear, const glm::vec3& angular1, const glm::vec3& angular2, float bias, float softness, float impulse);
+// Three rows that pull the anchors r1 and r2 of two bodies, separation
+// apart, together. Their impulses are kept for warm starting.
+void InitPointRows(ConstraintRow* rows, const SolverBodies& bodies, uint32_t index1, uint32_t index2, const glm::vec3& r1, const glm::vec3& r2, const glm::vec3& separation, float biasRate, float softness);
+void WarmStartRows(const ConstraintRow* rows, size_t rowCount, SolverBodies& bodies);
+// One Gauss-Seidel pass over the rows. Returns the largest impulse change.
+float SolveRows(ConstraintRow* rows, size_t rowCount, SolverBodies& bodies);
+// Unbounded rows between the same two bodies, at most g_maxBlockRows, can
+// be solved together, as joints need to stay stiff. The inverse of their
+// effective mass matrix is computed once per step.
+constexpr uint32_t g_maxBlockRows = 4;
+void ComputeBlockMass(const ConstraintRow* rows, uint32_t rowCount, float* mass);
+float SolveRowBlock(ConstraintRow* rows, uint32_t rowCount, const float* mass, SolverBodies& bodies);
+// The same with soft constraints, which ignores the bias of the rows. With
+// useBias the position error is pushed out at the rate of the softness,
+// otherwise only the velocity error is removed.
+float SolveRowBlockSoft(ConstraintRow* rows, uint32_t rowCount, const float* mass, SolverBodies& bodies, const Softness& softness, bool useBias);
\ No newline at end of file
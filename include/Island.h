@@ -0,0 +1,106 @@
+#pragma once
+
+#include "JointTree.h"
+#include "Solver.h"
+#include <cstddef>
+#include <cstdint>
+
+struct Arbiter;
+struct Joint;
+struct TaskExecutor;
+
+enum class IslandPass
+{
+    // Contact and joint impulses on the velocities.
+    Velocity,
+    // Split impulse contact correction on the pseudo-velocities.
+    Position
+};
+
+// A range of the colored constraints of a large island. No two
+// constraints of a color share a dynamic body, unless the color is serial.
+struct IslandColor
+{
+    uint32_t m_arbiterBegin;
+    uint32_t m_arbiterEnd;
+    uint32_t m_jointBegin;
+    uint32_t m_jointEnd;
+    bool m_isSerial;
+};
+
+// Constraints connected through dynamic bodies. Static bodies do not join
+// islands together since the solver never changes their velocities.
+struct Island
+{
+    uint32_t m_arbiterBegin;
+    uint32_t m_arbiterEnd;
+    uint32_t m_jointBegin;
+    uint32_t m_jointEnd;
+    uint32_t m_colorBegin;
+    uint32_t m_colorEnd;
+    uint32_t m_bodyBegin;
+    uint32_t m_bodyEnd;
+};
+
+// Splits the constraints into islands and solves independent islands on
+// different workers. Islands with more constraints than the coloring
+// threshold are split further by graph coloring and each color is solved
+// in parallel. Islands with more constraints than the Jacobi threshold
+// instead solve all their contacts at once against the velocities of the
+// previous iteration, each on a share of the body masses, and then add up
+// the velocity changes per body. Islands made only of joints that form a
+// tree can instead be solved exactly by a JointTree. Every island writes
+// to its own bodies only, so the results do not depend on which worker
+// solved what.
+struct IslandSolver
+{
+    explicit IslandSolver(Allocator* allocator);
+    // Sizes the scratch for this many solver bodies and constraints, so
+    // that Build and Solve do not grow it while staying within them.
+    void Reserve(size_t bodyCount, size_t arbiterCount, size_t jointCount);
+    void Build(Arbiter* const* arbiters, size_t arbiterCount, Joint* const* joints, size_t jointCount, const SolverBodies& bodies, uint32_t coloringThreshold, uint32_t jacobiThreshold, bool useJointTrees);
+    // Stops iterating an island once no impulse changed by more than the
+    // tolerance in an iteration. Returns the most iterations any island
+    // took and the largest residual left.
+    SolverStats Solve(TaskExecutor* executor, SolverBodies& bodies, uint32_t iterations, IslandPass pass, float tolerance);
+    void WarmStartPositions(const Island& island, SolverBodies& bodies);
+    SolverStats SolveIsland(const Island& island, SolverBodies& bodies, uint32_t iterations, IslandPass pass, float tolerance);
+    float SolveColor(const IslandColor& color, uint32_t begin, uint32_t end, SolverBodies& bodies, IslandPass pass);
+    SolverStats SolveJacobi(TaskExecutor* executor, const Island& island, SolverBodies& bodies, uint32_t iterations, float tolerance);
+    void ColorIsland(Island& island, const SolverBodies& bodies);
+    void PrepareJacobi(Island& island, const SolverBodies& bodies);
+    uint32_t FindRoot(uint32_t index);
+
+    Vector<Island> m_islands;
+    Vector<IslandColor> m_colors;
+    Vector<uint32_t> m_smallIslands;
+    Vector<uint32_t> m_largeIslands;
+    Vector<uint32_t> m_jacobiIslands;
+    // Islands solved by a joint tree, and the tree of each. The trees are
+    // kept across steps so that their elimination orders can be reused.
+    Vector<uint32_t> m_treeIslands;
+    Vector<uint32_t> m_islandTrees;
+    Vector<JointTree> m_jointTrees;
+    Vector<Arbiter*> m_arbiters;
+    Vector<Joint*> m_joints;
+    Vector<uint32_t> m_parents;
+    Vector<uint32_t> m_bodyIslands;
+    Vector<uint32_t> m_arbiterIslands;
+    Vector<uint32_t> m_jointIslands;
+    Vector<uint64_t> m_bodyColors;
+    Vector<uint32_t> m_constraintColors;
+    Vector<SolverStats> m_islandStats;
+    Vector<float> m_workerResiduals;
+    Vector<Arbiter*> m_coloredArbiters;
+    Vector<Joint*> m_coloredJoints;
+    // Number of contacts of each body in a Jacobi island, and the bodies of
+    // those islands with the offsets of their entries in m_jacobiDeltaIndices.
+    Vector<uint32_t> m_bodyConstraintCounts;
+    Vector<uint32_t> m_jacobiBodies;
+    Vector<uint32_t> m_jacobiOffsets;
+    Vector<uint32_t> m_jacobiDeltaIndices;
+    Vector<uint32_t> m_jacobiCursors;
+    Vector<uint32_t> m_bodySlots;
+    // Linear and angular velocity changes of both bodies of each arbiter.
+    Vector<glm::vec3> m_jacobiDeltas;
+};
\ No newline at end of file
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "Constraint.h"
 #include <glm/glm.hpp>
 
 struct Body;
@@ -10,15 +11,32 @@ enum class JointType
     Hinge
 };
 
+// A joint is solved only through the rows its PreStep writes, in every
+// solver, so a new joint type only has to fill them in.
 struct Joint
 {
+    virtual ~Joint() = default;
+
     JointType GetType() const
     {
         return m_type;
     }
 
+    Body* m_body1;
+    Body* m_body2;
+    uint32_t m_index1;
+    uint32_t m_index2;
+    float m_biasFactor;
+    float m_softness;
+    // Kept between steps so that their impulses warm start the next one.
+    ConstraintRow m_rows[g_maxBlockRows];
+    // Inverse effective mass of the rows, for solving them as a block.
+    float m_mass[g_maxBlockRows * g_maxBlockRows];
+    uint32_t m_rowCount;
+
 protected:
-    Joint(JointType type);
+    Joint(JointType type, uint32_t rowCount);
+    void SetBodies(Body* body1, Body* body2);
     JointType m_type;
 };
 
@@ -26,45 +44,22 @@ struct JointSpherical : Joint
 {
     JointSpherical();
     void Set(Body* body1, Body* body2, const glm::vec3& anchor);
-    void PreStep(float invElapsedTime);
-    void ApplyImpulse();
+    void PreStep(const SolverBodies& bodies, float invElapsedTime);
 
-    glm::mat3 m_M;
     glm::vec3 m_localAnchor1;
     glm::vec3 m_localAnchor2;
-    glm::vec3 m_r1;
-    glm::vec3 m_r2;
-    glm::vec3 m_bias;
-    glm::vec3 m_P;
-    Body* m_body1;
-    Body* m_body2;
-    float m_biasFactor;
-    float m_softness;
 };
 
 struct JointHinge : Joint
 {
     JointHinge();
     void Set(Body* body1, Body* body2, const glm::vec3& anchor, const glm::vec3& axis);
-    void PreStep(float invElapsedTime);
-    void ApplyImpulse();
+    void PreStep(const SolverBodies& bodies, float invElapsedTime);
 
-    glm::mat3 m_M;
-    float m_angularMass;
     glm::vec3 m_localAnchor1;
     glm::vec3 m_localAnchor2;
     glm::vec3 m_localAxis1;
     glm::vec3 m_localAxis2;
-    glm::vec3 m_r1;
-    glm::vec3 m_r2;
-    glm::vec3 m_a1;
-    glm::vec3 m_a2;
-    glm::vec3 m_bias;
-    float m_angularBias;
-    glm::vec3 m_P;
-    float m_angularImpulse;
-    Body* m_body1;
-    Body* m_body2;
-    float m_biasFactor;
-    float m_softness;
-};
\ No newline at end of file
+};
+
+void PreStepJoint(Joint* joint, const SolverBodies& bodies, float invElapsedTime);
\ No newline at end of file
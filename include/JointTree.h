@@ -0,0 +1,57 @@
+#pragma once
+
+#include "Allocator.h"
+#include "Constraint.h"
+#include <cstdint>
+
+struct Joint;
+
+// A node of the elimination tree. Either a dynamic body together with the
+// joints that tie it to static bodies, or a joint between two dynamic
+// bodies. Its unknowns are the body velocity changes followed by the
+// negated impulse changes of its joints.
+struct JointTreeNode
+{
+    uint32_t m_body;
+    uint32_t m_jointBegin;
+    uint32_t m_jointEnd;
+    uint32_t m_parent;
+    uint32_t m_size;
+    uint32_t m_rowBegin;
+    uint32_t m_blockOffset;
+    uint32_t m_couplingOffset;
+};
+
+// Direct solver for an island made only of joints whose bodies and joints
+// form a tree. The system [M J^T; J -S] is factored along the tree with
+// children eliminated before their parents, which causes no fill, so a
+// single pass gives the exact impulses in time linear in the number of
+// joints. The elimination order only depends on which joints connect
+// which bodies and is kept while they stay the same.
+struct JointTree
+{
+    explicit JointTree(Allocator* allocator);
+    bool Matches(Joint* const* joints, uint32_t jointCount) const;
+    // Returns false if the joints form a cycle.
+    bool Analyze(Joint* const* joints, uint32_t jointCount, const SolverBodies& bodies);
+    void Solve(SolverBodies& bodies);
+
+    Vector<Joint*> m_joints;
+    Vector<uint32_t> m_jointIndices;
+    bool m_isTree;
+    Vector<JointTreeNode> m_nodes;
+    // Joints in node order.
+    Vector<uint32_t> m_nodeJoints;
+    // The factored diagonal block of each node and its coupling to its
+    // parent, premultiplied by the inverse of the block, column by column.
+    Vector<float> m_values;
+    Vector<float> m_solution;
+    Vector<float> m_coupling;
+    Vector<uint32_t> m_bodies;
+    Vector<uint32_t> m_bodyOffsets;
+    Vector<uint32_t> m_bodyJoints;
+    Vector<uint32_t> m_stack;
+    Vector<uint32_t> m_order;
+    Vector<uint32_t> m_parentJoints;
+    Vector<uint32_t> m_bodyNodes;
+};
\ No newline at end of file
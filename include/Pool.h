@@ -0,0 +1,192 @@
+#pragma once
+
+#include "Allocator.h"
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+
+// Refers to an object in a Pool. Destroying the object moves its slot to
+// the next generation, so the handle stops resolving even after the slot
+// has been reused.
+template <typename T>
+struct Handle
+{
+    uint32_t m_index;
+    uint32_t m_generation;
+};
+
+template <typename T>
+constexpr Handle<T> NullHandle()
+{
+    return {0xFFFFFFFF, 0};
+}
+
+// Owns objects of T, or of types derived from it that fit in SlotSize
+// bytes, stored in chunks of k_chunkSize slots taken from the allocator.
+// Objects never move once created, and objects created one after another
+// sit next to each other. Chunks start on a cache line. Live slots have
+// odd generations and free slots even ones.
+template <typename T, size_t SlotSize = sizeof(T)>
+struct Pool
+{
+    static constexpr uint32_t k_chunkSize = 64;
+    static constexpr size_t k_chunkAlignment = 64;
+    static constexpr size_t k_slotStride = (SlotSize + alignof(std::max_align_t) - 1) / alignof(std::max_align_t) * alignof(std::max_align_t);
+
+    explicit Pool(Allocator* allocator);
+    Pool(const Pool&) = delete;
+    Pool& operator=(const Pool&) = delete;
+    ~Pool();
+
+    template <typename U>
+    Handle<T> Create();
+    void Destroy(Handle<T> handle);
+    void Clear();
+    T* Get(Handle<T> handle) const;
+    // Slots are numbered from 0 to GetSlotCount() - 1, and GetAt returns
+    // null for a free one.
+    uint32_t GetSlotCount() const;
+    T* GetAt(uint32_t index) const;
+    // Returns a null handle for objects that are not in the pool.
+    Handle<T> Find(const T* object) const;
+
+    Allocator* m_allocator;
+    Vector<unsigned char*> m_chunks;
+    Vector<T*> m_objects;
+    Vector<uint32_t> m_generations;
+    Vector<uint32_t> m_freeSlots;
+};
+
+template <typename T, size_t SlotSize>
+Pool<T, SlotSize>::Pool(Allocator* allocator)
+: m_allocator(allocator)
+, m_chunks(allocator)
+, m_objects(allocator)
+, m_generations(allocator)
+, m_freeSlots(allocator)
+{
+}
+
+template <typename T, size_t SlotSize>
+Pool<T, SlotSize>::~Pool()
+{
+    Clear();
+
+    for (size_t i = 0; i < m_chunks.size(); ++i)
+    {
+        m_allocator->Free(m_chunks[i], k_chunkSize * k_slotStride, k_chunkAlignment);
+    }
+}
+
+template <typename T, size_t SlotSize>
+template <typename U>
+Handle<T> Pool<T, SlotSize>::Create()
+{
+    static_assert(std::is_base_of<T, U>::value, "U must derive from T");
+    static_assert(std::has_virtual_destructor<T>::value || std::is_same<T, U>::value, "T must have a virtual destructor to destroy a U");
+    static_assert(sizeof(U) <= SlotSize, "U does not fit in a slot");
+    static_assert(alignof(U) <= alignof(std::max_align_t), "U is over-aligned");
+
+    uint32_t index;
+    if (!m_freeSlots.empty())
+    {
+        index = m_freeSlots.back();
+        m_freeSlots.pop_back();
+    }
+    else
+    {
+        index = static_cast<uint32_t>(m_objects.size());
+        if ((index % k_chunkSize) == 0)
+        {
+            m_chunks.push_back(static_cast<unsigned char*>(m_allocator->Allocate(k_chunkSize * k_slotStride, k_chunkAlignment)));
+        }
+
+        m_objects.push_back(nullptr);
+        m_generations.push_back(0);
+    }
+
+    unsigned char* slot = m_chunks[index / k_chunkSize] + (index % k_chunkSize) * k_slotStride;
+    m_objects[index] = new (slot) U();
+    ++m_generations[index];
+
+    return {index, m_generations[index]};
+}
+
+template <typename T, size_t SlotSize>
+void Pool<T, SlotSize>::Destroy(Handle<T> handle)
+{
+    T* object = Get(handle);
+    if (!object)
+    {
+        return;
+    }
+
+    object->~T();
+    m_objects[handle.m_index] = nullptr;
+    ++m_generations[handle.m_index];
+    m_freeSlots.push_back(handle.m_index);
+}
+
+template <typename T, size_t SlotSize>
+void Pool<T, SlotSize>::Clear()
+{
+    m_freeSlots.clear();
+
+    // Highest slots are pushed first so that they are reused last.
+    for (size_t i = m_objects.size(); i-- > 0;)
+    {
+        if (m_objects[i])
+        {
+            m_objects[i]->~T();
+            m_objects[i] = nullptr;
+            ++m_generations[i];
+        }
+
+        m_freeSlots.push_back(static_cast<uint32_t>(i));
+    }
+}
+
+template <typename T, size_t SlotSize>
+T* Pool<T, SlotSize>::Get(Handle<T> handle) const
+{
+    if ((handle.m_index < m_generations.size()) && (m_generations[handle.m_index] == handle.m_generation))
+    {
+        return m_objects[handle.m_index];
+    }
+
+    return nullptr;
+}
+
+template <typename T, size_t SlotSize>
+uint32_t Pool<T, SlotSize>::GetSlotCount() const
+{
+    return static_cast<uint32_t>(m_objects.size());
+}
+
+template <typename T, size_t SlotSize>
+T* Pool<T, SlotSize>::GetAt(uint32_t index) const
+{
+    return m_objects[index];
+}
+
+template <typename T, size_t SlotSize>
+Handle<T> Pool<T, SlotSize>::Find(const T* object) const
+{
+    const unsigned char* address = reinterpret_cast<const unsigned char*>(object);
+    for (size_t i = 0; i < m_chunks.size(); ++i)
+    {
+        if ((address >= m_chunks[i]) && (address < m_chunks[i] + k_chunkSize * k_slotStride))
+        {
+            const uint32_t index = static_cast<uint32_t>(i * k_chunkSize + (address - m_chunks[i]) / k_slotStride);
+            if ((index < m_objects.size()) && (m_objects[index] == object))
+            {
+                return {index, m_generations[index]};
+            }
+
+            break;
+        }
+    }
+
+    return NullHandle<T>();
+}
\ No newline at end of file
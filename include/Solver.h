@@ -0,0 +1,157 @@
+#pragma once
+
+#include "Allocator.h"
+#include "Collide.h"
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#if defined(__AVX__)
+constexpr size_t g_simdWidth = 8;
+#else
+constexpr size_t g_simdWidth = 4;
+#endif
+
+struct Arbiter;
+struct BodyState;
+
+enum class SolverType
+{
+    Sequential,
+    Wide,
+    // Jacobi iterations with mass splitting on every island.
+    Jacobi,
+    // Contacts and joints as generic constraint rows, solved in one loop.
+    Rows
+};
+
+// Coefficients of a soft constraint, derived from a stiffness in hertz and
+// a damping ratio for a given time step.
+struct Softness
+{
+    float m_biasRate;
+    float m_massScale;
+    float m_impulseScale;
+};
+
+Softness MakeSoftness(float hertz, float dampingRatio, float timeStep);
+
+// Iterations a solver pass ran in the last step and the largest impulse
+// change of its final iteration.
+struct SolverStats
+{
+    uint32_t m_iterations;
+    float m_residual;
+};
+
+// Velocities and mass properties of the bodies taking part in a solve,
+// staged into contiguous arrays so that constraints can refer to bodies by
+// index instead of chasing Body pointers on every iteration. One extra
+// slot with no mass is kept after the last body for unused SIMD lanes.
+struct SolverBodies
+{
+    explicit SolverBodies(Allocator* allocator);
+    // Copies the velocities and inverse masses. The world inverse inertias
+    // are left to World::IntegrateForces.
+    void Stage(const BodyState* states, size_t bodyCount);
+    void WriteBack(BodyState* states, size_t bodyCount) const;
+    // Used by the substepping solver, which integrates forces and positions
+    // itself on every substep.
+    void StageForces(const BodyState* states, size_t bodyCount, const glm::vec3& gravity);
+    void IntegrateVelocities(uint32_t begin, uint32_t end, float timeStep);
+    void IntegratePositions(uint32_t begin, uint32_t end, float timeStep);
+
+    // Static bodies are shared by constraints that may be solved on
+    // different threads, so their velocities are never written.
+    void SetVelocity(uint32_t index, const glm::vec3& velocity, const glm::vec3& angularVelocity)
+    {
+        if (m_invMasses[index] != 0.0f)
+        {
+            m_velocities[index] = velocity;
+            m_angularVelocities[index] = angularVelocity;
+        }
+    }
+
+    void SetPseudoVelocity(uint32_t index, const glm::vec3& velocity, const glm::vec3& angularVelocity)
+    {
+        if (m_invMasses[index] != 0.0f)
+        {
+            m_pseudoVelocities[index] = velocity;
+            m_pseudoAngularVelocities[index] = angularVelocity;
+        }
+    }
+
+    uint32_t GetNullIndex() const
+    {
+        return static_cast<uint32_t>(m_velocities.size() - 1);
+    }
+
+    Vector<glm::vec3> m_velocities;
+    Vector<glm::vec3> m_angularVelocities;
+    Vector<glm::vec3> m_pseudoVelocities;
+    Vector<glm::vec3> m_pseudoAngularVelocities;
+    Vector<float> m_invMasses;
+    Vector<glm::mat3> m_invIs;
+    Vector<glm::vec3> m_deltaPositions;
+    Vector<glm::quat> m_deltaRotations;
+    Vector<glm::vec3> m_accelerations;
+    Vector<glm::vec3> m_angularAccelerations;
+    Vector<float> m_linearDampings;
+    Vector<float> m_angularDampings;
+};
+
+// One Jacobian row (normal, tangent or bitangent) for every lane of a
+// contact batch, with the angular terms premultiplied by inverse inertia.
+struct ContactBatchRow
+{
+    float m_direction[3][g_simdWidth];
+    float m_angular1[3][g_simdWidth];
+    float m_angular2[3][g_simdWidth];
+    float m_response1[3][g_simdWidth];
+    float m_response2[3][g_simdWidth];
+    float m_mass[g_simdWidth];
+    float m_impulse[g_simdWidth];
+};
+
+// The same contact point slot of every lane of a contact batch.
+struct ContactBatchPoint
+{
+    Contact* m_contacts[g_simdWidth];
+    float m_bias[g_simdWidth];
+    ContactBatchRow m_rows[3];
+};
+
+// g_simdWidth arbiters that share no dynamic body, solved together.
+struct ContactBatch
+{
+    uint32_t m_index1[g_simdWidth];
+    uint32_t m_index2[g_simdWidth];
+    float m_invMass1[g_simdWidth];
+    float m_invMass2[g_simdWidth];
+    float m_staticFriction[g_simdWidth];
+    float m_dynamicFriction[g_simdWidth];
+    size_t m_pointCount;
+    ContactBatchPoint m_points[g_maxContactPoints];
+};
+
+// Contact solver that partitions arbiters into colors, so that no two
+// arbiters of a color share a dynamic body, and solves each color several
+// contact points at a time in SIMD lanes. Arbiters that do not fit in any
+// color are solved one by one.
+struct WideContactSolver
+{
+    explicit WideContactSolver(Allocator* allocator);
+    // Sizes the scratch for this many solver bodies and arbiters, so that
+    // Prepare does not grow it while staying within them.
+    void Reserve(size_t bodyCount, size_t arbiterCount);
+    void Prepare(Arbiter* const* arbiters, size_t arbiterCount, const SolverBodies& bodies);
+    float ApplyImpulses(SolverBodies& bodies);
+    void StoreImpulses() const;
+
+    Vector<ContactBatch> m_batches;
+    Vector<uint32_t> m_colorOffsets;
+    Vector<Arbiter*> m_overflow;
+    Vector<uint64_t> m_bodyColors;
+    Vector<uint32_t> m_arbiterColors;
+    Vector<uint32_t> m_colorCounts;
+    Vector<Arbiter*> m_sortedArbiters;
+};
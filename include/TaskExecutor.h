@@ -0,0 +1,83 @@
+#pragma once
+
+#include "Allocator.h"
+#include <cstdint>
+#include <vector>
+
+// Processes the items [begin, end) of a task. workerIndex is below the
+// executor's worker count and identifies the thread running the range, so
+// that tasks can write to per-worker buffers without locking.
+typedef void (*TaskFunction)(void* context, uint32_t begin, uint32_t end, uint32_t workerIndex);
+
+struct Task
+{
+    TaskFunction m_function;
+    void* m_context;
+    uint32_t m_count;
+    uint32_t m_grainSize;
+};
+
+struct TaskDependency
+{
+    uint32_t m_task;
+    uint32_t m_successor;
+};
+
+// Tasks that run over a range of items each, with the order between them
+// given by dependencies. Tasks without a path between them may run at the
+// same time.
+struct TaskGraph
+{
+    explicit TaskGraph(Allocator* allocator);
+    uint32_t AddTask(TaskFunction function, void* context, uint32_t count, uint32_t grainSize);
+    void AddDependency(uint32_t task, uint32_t successor);
+    void Clear();
+
+    Vector<Task> m_tasks;
+    Vector<TaskDependency> m_dependencies;
+};
+
+// Runs the parallel parts of a world step. Implement it on top of an
+// engine's job system, or use the built-in ThreadPool.
+struct TaskExecutor
+{
+    virtual ~TaskExecutor() {}
+    virtual uint32_t GetWorkerCount() const = 0;
+    // Splits [0, count) into ranges of at most grainSize items and returns
+    // once every range has been processed.
+    virtual void ParallelFor(uint32_t count, uint32_t grainSize, TaskFunction function, void* context) = 0;
+    // Returns once every task of the graph has run. The default runs the
+    // tasks one after another in dependency order, each with ParallelFor.
+    virtual void Run(const TaskGraph& graph);
+
+    std::vector<uint32_t> m_pendingDependencies;
+    std::vector<uint32_t> m_readyTasks;
+};
+
+// Runs everything on the calling thread.
+struct SerialTaskExecutor : TaskExecutor
+{
+    uint32_t GetWorkerCount() const override;
+    void ParallelFor(uint32_t count, uint32_t grainSize, TaskFunction function, void* context) override;
+};
+
+template <typename Function>
+void ParallelFor(TaskExecutor* executor, uint32_t count, uint32_t grainSize, const Function& function)
+{
+    TaskFunction trampoline = [](void* context, uint32_t begin, uint32_t end, uint32_t workerIndex)
+    {
+        (*static_cast<const Function*>(context))(begin, end, workerIndex);
+    };
+    executor->ParallelFor(count, grainSize, trampoline, const_cast<Function*>(&function));
+}
+
+// The function must outlive the graph's Run.
+template <typename Function>
+uint32_t AddTask(TaskGraph& graph, uint32_t count, uint32_t grainSize, const Function& function)
+{
+    TaskFunction trampoline = [](void* context, uint32_t begin, uint32_t end, uint32_t workerIndex)
+    {
+        (*static_cast<const Function*>(context))(begin, end, workerIndex);
+    };
+    return graph.AddTask(trampoline, const_cast<Function*>(&function), count, grainSize);
+}
\ No newline at end of file
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "TaskExecutor.h"
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+// Ranges of a ParallelFor handed to one worker. The owner takes ranges from
+// the front, idle workers steal from the back.
+struct WorkStealingQueue
+{
+    bool PopFront(uint32_t& range);
+    bool StealBack(uint32_t& range);
+
+    std::mutex m_mutex;
+    uint32_t m_begin;
+    uint32_t m_end;
+};
+
+// Task executor backed by its own threads. Each ParallelFor splits its
+// ranges evenly between the workers, which steal from each other once
+// their own share runs out. Run hands out the ranges of every task whose
+// dependencies are done, so independent tasks share the workers. The
+// thread calling ParallelFor or Run takes part in the work as worker 0.
+// Neither must be called from inside a task.
+struct ThreadPool : TaskExecutor
+{
+    // A thread count of zero uses one thread per hardware thread, the
+    // calling thread included.
+    explicit ThreadPool(uint32_t threadCount = 0);
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    uint32_t GetWorkerCount() const override;
+    void ParallelFor(uint32_t count, uint32_t grainSize, TaskFunction function, void* context) override;
+    void Run(const TaskGraph& graph) override;
+    void WorkerMain(uint32_t workerIndex);
+    void RunRanges(uint32_t workerIndex);
+    void RunGraph(uint32_t workerIndex);
+    // Both expect m_mutex to be held.
+    void MakeReady(uint32_t taskIndex);
+    void FinishTask(uint32_t taskIndex);
+
+    std::vector<std::thread> m_threads;
+    std::mutex m_mutex;
+    std::condition_variable m_wakeCondition;
+    std::condition_variable m_doneCondition;
+    TaskFunction m_function;
+    void* m_context;
+    uint32_t m_count;
+    uint32_t m_grainSize;
+    std::unique_ptr<WorkStealingQueue[]> m_queues;
+    uint32_t m_busyThreads;
+    uint64_t m_generation;
+    bool m_quit;
+
+    // The graph being run, if any, guarded by m_mutex. Ready tasks before
+    // m_readyBegin have handed out all their ranges.
+    const TaskGraph* m_graph;
+    std::condition_variable m_graphCondition;
+    std::vector<uint32_t> m_nextRanges;
+    std::vector<uint32_t> m_unfinishedRanges;
+    size_t m_readyBegin;
+    uint32_t m_unfinishedTasks;
+    uint32_t m_runningRanges;
+};
\ No newline at end of file
@@ -1,12 +1,30 @@
 #pragma once
 
 #include "Arbiter.h"
+#include "Allocator.h"
+#include "Articulation.h"
+#include "Body.h"
+#include "CommandBuffer.h"
+#include "Constraint.h"
+#include "Island.h"
+#include "Joint.h"
+#include "Pool.h"
+#include "TaskExecutor.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <future>
 #include <glm/glm.hpp>
+#include <mutex>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 
-struct Body;
-struct Joint;
+constexpr size_t k_shapeSlotSize = std::max({sizeof(ShapeBox), sizeof(ShapeSphere), sizeof(ShapeCapsule)});
+constexpr size_t k_jointSlotSize = std::max(sizeof(JointSpherical), sizeof(JointHinge));
+
+using ArbiterMap = std::unordered_map<uint64_t, Arbiter, std::hash<uint64_t>, std::equal_to<uint64_t>, StlAllocator<std::pair<const uint64_t, Arbiter>>>;
 
 struct CollisionResult
 {
@@ -31,24 +49,262 @@ struct WorldListener
     virtual void OnTriggerExit(TriggerResult* triggerResults, size_t triggerResultCount) = 0;
 };
 
+struct BodyTransform
+{
+    const Body* m_body;
+    glm::vec3 m_position;
+    glm::quat m_rotation;
+};
+
+enum class BodyWriteType
+{
+    Force,
+    Velocity
+};
+
+// A force or velocity change recorded while a step may be running, applied
+// at the start of the next step.
+struct BodyWrite
+{
+    Body* m_body;
+    BodyWriteType m_type;
+    glm::vec3 m_linear;
+    glm::vec3 m_angular;
+};
+
+struct ShapePair
+{
+    Shape* m_shape1;
+    Shape* m_shape2;
+    float m_margin;
+};
+
+// Scratch buffers of one task executor worker.
+struct WorldWorker
+{
+    explicit WorldWorker(Allocator* allocator);
+
+    Vector<BVHPair> m_bvhPairs;
+    Vector<BVHPair> m_bvhStack;
+    Vector<ShapePair> m_shapePairs;
+    Vector<Arbiter> m_arbiters;
+};
+
 struct World
 {
-    World(glm::vec3 gravity, uint32_t iterations);
+    // The allocator must outlive the world. Without one the world pools
+    // its allocations over the heap.
+    World(glm::vec3 gravity, uint32_t iterations, Allocator* allocator = nullptr);
+    ~World();
     void Clear();
     void Add(Body* body);
     void Remove(Body* body);
     void Add(Joint* joint);
     void Remove(Joint* joint);
+    // The link bodies of an articulation must be added as well.
+    void Add(Articulation* articulation);
+    void Remove(Articulation* articulation);
+    void RemoveBodies(Body* const* bodies, size_t bodyCount);
+    void RemoveJoints(Joint* const* joints, size_t jointCount);
+    // Objects created here are owned by the world and freed by Destroy or
+    // Clear. A body still has to be added to be simulated. Destroying it
+    // removes it and destroys its shapes and the joints of the world that
+    // hold it, or only removes those joints if the world did not create
+    // them. Articulations it is a link of are removed too. Joints that were
+    // never added are left to the caller. Not to be called during a step.
+    Handle<Body> CreateBody();
+    Handle<Shape> CreateShape(Handle<Body> body, ShapeType type);
+    Handle<Joint> CreateJoint(JointType type);
+    // Materials must outlive the shapes that use them. Changes to the values
+    // of a material created here reach the pair table at the start of the
+    // next step, or at once through UpdateMaterial.
+    Handle<Material> CreateMaterial();
+    void UpdateMaterial(Handle<Material> material);
+    // Looks up the pair table for materials created by this world and
+    // combines any others directly.
+    MaterialPair GetMaterialPair(const Material* material1, const Material* material2) const;
+    void Destroy(Handle<Body> body);
+    void Destroy(Handle<Shape> shape);
+    void Destroy(Handle<Joint> joint);
+    void Destroy(Handle<Material> material);
+    Body* Get(Handle<Body> body) const;
+    Shape* Get(Handle<Shape> shape) const;
+    Joint* Get(Handle<Joint> joint) const;
+    Material* Get(Handle<Material> material) const;
+    // Sizes the step's buffers for this many bodies, joints and touching
+    // shape pairs, so that steps staying within them do not allocate. The
+    // buffers otherwise grow to the largest step seen so far. Call again
+    // after changing the task executor.
+    void Reserve(uint32_t bodyCount, uint32_t jointCount, uint32_t pairCount);
+    void FlushRemovals();
+    void ApplyCommands();
     void Step(float elapsedTime);
-    void BroadPhase();
+    // Runs as many steps of m_fixedTimeStep as the real time passed since
+    // the last call allows, up to m_maxFixedSteps, and carries the rest of
+    // the time over. Returns the number of steps run. Do not mix with
+    // StepAsync.
+    uint32_t Advance(float elapsedTime);
+    // Blends the poses of the last two steps by how far the carried over
+    // time has got into the next step, for rendering between steps.
+    void InterpolateTransforms(float alpha);
+    const Vector<BodyTransform>& GetInterpolatedTransforms() const;
+    // Runs Step on a background thread. Steps queued before the previous
+    // one finished run in order.
+    std::future<void> StepAsync(float elapsedTime);
+    void AsyncMain();
+    // Safe to call from any thread, even while a step runs.
+    void ApplyForce(Body* body, const glm::vec3& force, const glm::vec3& torque);
+    void SetVelocity(Body* body, const glm::vec3& velocity, const glm::vec3& angularVelocity);
+    void ApplyBodyWrites();
+    void PublishTransforms();
+    // Body poses at the end of the last finished step, readable from any
+    // thread without locking. The array is left untouched until the next
+    // step has finished.
+    const Vector<BodyTransform>& GetTransforms() const;
+    // One scratch worker per worker of the task executor.
+    void ResizeWorkers();
+    // Points the bodies from the given index on at their entries of
+    // m_bodyStates, which move whenever the array grows or shrinks.
+    void LinkBodyStates(size_t begin);
+    // Combines again the materials whose values changed since their rows
+    // of the pair table were filled.
+    void UpdateMaterials();
+    void UpdateMaterialPairs(const Material* material);
+    void BroadPhase(float elapsedTime);
+    void FindPairs(uint32_t begin, uint32_t end, float elapsedTime, WorldWorker& worker);
+    void NarrowPhase(uint32_t begin, uint32_t end, WorldWorker& worker);
+    void UpdateArbiters();
+    void UpdateArbiter(Arbiter& newArb);
+    void IntegrateForces(uint32_t begin, uint32_t end, float elapsedTime);
+    void IntegrateVelocities(uint32_t begin, uint32_t end, float elapsedTime);
+    uint64_t ComputeStateHash() const;
+    void WarmStart();
+    void SolveSubSteps(float elapsedTime);
+    void SolveConstraintRows();
+    void SolvePseudoImpulses();
+    void IntegrateContinuous(Body* body, float elapsedTime);
+    float ComputeTimeOfImpact(Body* body, Body* other, const glm::vec3& position0, const glm::quat& rotation0, const glm::vec3& position1, const glm::quat& rotation1, uint32_t sampleCount);
+    bool TestOverlap(Body* body, const glm::vec3& position, const glm::quat& rotation, Body* other);
 
     glm::vec3 m_gravity;
     uint32_t m_iterations;
-    std::vector<Body*> m_bodies;
-    std::vector<Joint*> m_joints;
-    std::unordered_map<uint64_t, Arbiter> m_arbiters;
-    std::vector<WorldListener*> m_worldListeners;
-    std::vector<CollisionResult> m_onCollisions;
-    std::vector<TriggerResult> m_onTriggerEnters;
-    std::vector<TriggerResult> m_onTriggerExits;
+    // Creates contacts ahead of time for pairs that may touch within the
+    // step, so fast bodies cannot tunnel. Such contacts carry a positive
+    // separation and only stop the bodies from closing the gap further.
+    bool m_useSpeculativeContacts;
+    SolverType m_solverType;
+    // Solves the normal impulses of a manifold together instead of one
+    // point at a time, so box stacks need fewer iterations. Used by the
+    // sequential solver.
+    bool m_useBlockSolver;
+    // Resolves penetration with m_positionIterations passes on separate
+    // pseudo-velocities that move the bodies but are then discarded,
+    // instead of with a velocity bias that adds energy to the bodies.
+    bool m_useSplitImpulse;
+    uint32_t m_positionIterations;
+    // Ends the solver iterations early once no impulse changes by more
+    // than this in an iteration. Zero runs them all unless nothing moves.
+    float m_impulseTolerance;
+    SolverStats m_velocityStats;
+    SolverStats m_positionStats;
+    // Islands with more constraints than this are split by graph coloring
+    // so that a single large pile can use several threads.
+    uint32_t m_islandColoringThreshold;
+    // Islands with more constraints than this use Jacobi iterations with
+    // mass splitting instead, which spread over all workers however the
+    // island is connected but need more iterations to converge. Contacts
+    // in these islands skip the block solver, and their split impulse
+    // pass runs on one thread.
+    uint32_t m_islandJacobiThreshold;
+    // Solves islands made only of joints that form a tree, such as chains,
+    // bridges and ragdolls, exactly in one pass instead of iterating. Used
+    // by the sequential and Jacobi solvers.
+    bool m_useJointTrees;
+    // Makes the results bit-identical for any executor and thread count by
+    // ordering arbiters by key, and hashes the body states after each step
+    // into m_stateHash so that peers can compare them. Build with
+    // PHYSICS_DETERMINISTIC to also match across compilers' FMA choices.
+    bool m_deterministic;
+    uint64_t m_stateHash;
+    // When non-zero, each step is split into this many substeps with one
+    // biased and one relaxing velocity pass each, on soft contacts and
+    // joints, instead of m_iterations passes with Baumgarte bias.
+    uint32_t m_subStepCount;
+    // Passes of each kind per substep. One is usually enough; raise it for
+    // violent impacts of bodies with several contact points.
+    uint32_t m_subStepIterations;
+    float m_contactHertz;
+    float m_contactDampingRatio;
+    float m_jointHertz;
+    float m_jointDampingRatio;
+    float m_maxContactPushVelocity;
+    float m_fixedTimeStep;
+    // Time Advance cannot catch up on within this many steps is dropped,
+    // so that a slow frame does not make the next one slower still.
+    uint32_t m_maxFixedSteps;
+    float m_accumulator;
+    // The pooled objects and every container of the world and its solvers
+    // are allocated from here. The BVHs of bodies, which need not belong to
+    // a world, and the task executors' own scratch use the heap.
+    Allocator* m_allocator;
+    PoolAllocator m_defaultAllocator;
+    // Runs the parallel parts of the step. Points at a serial executor by
+    // default; set it to a ThreadPool or an engine's own executor to use
+    // several threads.
+    TaskExecutor* m_taskExecutor;
+    SerialTaskExecutor m_serialTaskExecutor;
+    Vector<WorldWorker> m_workers;
+    Vector<ShapePair> m_candidatePairs;
+    Vector<Arbiter*> m_newArbiters;
+    Vector<uint64_t> m_staleArbiterKeys;
+    TaskGraph m_taskGraph;
+    // Combined values of every two materials of the pool, indexed by
+    // their IDs, with m_materialTableSize entries per row.
+    Vector<MaterialPair> m_materialPairs;
+    // The values each material had when its rows were filled, by ID.
+    Vector<Material> m_materialValues;
+    uint32_t m_materialTableSize;
+    // Destroyed in reverse, so shapes go before the bodies they are on.
+    Pool<Material> m_materialPool;
+    Pool<Body> m_bodyPool;
+    Pool<Shape, k_shapeSlotSize> m_shapePool;
+    Pool<Joint, k_jointSlotSize> m_jointPool;
+    Vector<Body*> m_bodies;
+    Vector<BodyState> m_bodyStates;
+    Vector<Joint*> m_joints;
+    Vector<Articulation*> m_articulations;
+    ArbiterMap m_arbiters;
+    Vector<WorldListener*> m_worldListeners;
+    Vector<CollisionResult> m_onCollisions;
+    Vector<TriggerResult> m_onTriggerEnters;
+    Vector<TriggerResult> m_onTriggerExits;
+    Vector<BVHPair> m_shapePairs;
+    Vector<BVHPair> m_bvhStack;
+    Vector<Arbiter> m_timeOfImpactArbiters;
+    SolverBodies m_solverBodies;
+    Vector<Arbiter*> m_contactConstraints;
+    WideContactSolver m_wideContactSolver;
+    Vector<ConstraintRow> m_constraintRows;
+    Vector<uint32_t> m_constraintRowOffsets;
+    IslandSolver m_islandSolver;
+    uint32_t m_timestamp;
+    // Use this instead of Add/Remove and the body and shape setters from
+    // listener callbacks or while an asynchronous step runs.
+    CommandBuffer m_commandBuffer;
+    Vector<WorldCommand> m_appliedCommands;
+    Vector<Body*> m_pendingBodyRemovals;
+    Vector<Joint*> m_pendingJointRemovals;
+    Vector<Body*> m_removedBodies;
+    Vector<Joint*> m_removedJoints;
+    Vector<BodyTransform> m_transforms[2];
+    std::atomic<uint32_t> m_publishedTransforms;
+    Vector<BodyTransform> m_interpolatedTransforms;
+    std::mutex m_bodyWritesMutex;
+    Vector<BodyWrite> m_bodyWrites;
+    Vector<BodyWrite> m_appliedBodyWrites;
+    std::thread m_asyncThread;
+    std::mutex m_asyncMutex;
+    std::condition_variable m_asyncCondition;
+    std::deque<std::packaged_task<void()>> m_asyncSteps;
+    bool m_asyncQuit;
 };
\ No newline at end of file
@@ -29,14 +29,8 @@ namespace
     int demoIndex = 0;
     float timeStep = 1.0f / 60.0f;
 
-    Body bodies[200];
-    JointSpherical joints[100];
-
     Body* bomb = NULL;
 
-    int numBodies = 0;
-    int numJoints = 0;
-
     glm::vec3 gravity(0.0f, -9.81f, 0.0f);
     int iterations = 10;
     World world(gravity, iterations);
@@ -58,24 +52,24 @@ static void DrawText(int x, int y, const char* string)
     ImGui::End();
 }
 
-static void DrawShape(Body* body, Shape* shape)
+static void DrawShape(const BodyTransform& transform, Shape* shape)
 {
     if (shape->GetType() == ShapeType::Box)
     {
         ShapeBox* shapeBox = static_cast<ShapeBox*>(shape);
 
-        glm::mat3 R = glm::mat3_cast(body->m_rotation);
+        glm::mat3 R = glm::mat3_cast(transform.m_rotation);
 
-        glm::vec3 v1 = body->m_position + R * glm::vec3(-shapeBox->m_halfSize.x, -shapeBox->m_halfSize.y, -shapeBox->m_halfSize.z);
-        glm::vec3 v2 = body->m_position + R * glm::vec3(shapeBox->m_halfSize.x, -shapeBox->m_halfSize.y, -shapeBox->m_halfSize.z);
-        glm::vec3 v3 = body->m_position + R * glm::vec3(shapeBox->m_halfSize.x, shapeBox->m_halfSize.y, -shapeBox->m_halfSize.z);
-        glm::vec3 v4 = body->m_position + R * glm::vec3(-shapeBox->m_halfSize.x, shapeBox->m_halfSize.y, -shapeBox->m_halfSize.z);
-        glm::vec3 v5 = body->m_position + R * glm::vec3(-shapeBox->m_halfSize.x, -shapeBox->m_halfSize.y, shapeBox->m_halfSize.z);
-        glm::vec3 v6 = body->m_position + R * glm::vec3(shapeBox->m_halfSize.x, -shapeBox->m_halfSize.y, shapeBox->m_halfSize.z);
-        glm::vec3 v7 = body->m_position + R * glm::vec3(shapeBox->m_halfSize.x, shapeBox->m_halfSize.y, shapeBox->m_halfSize.z);
-        glm::vec3 v8 = body->m_position + R * glm::vec3(-shapeBox->m_halfSize.x, shapeBox->m_halfSize.y, shapeBox->m_halfSize.z);
+        glm::vec3 v1 = transform.m_position + R * glm::vec3(-shapeBox->m_halfSize.x, -shapeBox->m_halfSize.y, -shapeBox->m_halfSize.z);
+        glm::vec3 v2 = transform.m_position + R * glm::vec3(shapeBox->m_halfSize.x, -shapeBox->m_halfSize.y, -shapeBox->m_halfSize.z);
+        glm::vec3 v3 = transform.m_position + R * glm::vec3(shapeBox->m_halfSize.x, shapeBox->m_halfSize.y, -shapeBox->m_halfSize.z);
+        glm::vec3 v4 = transform.m_position + R * glm::vec3(-shapeBox->m_halfSize.x, shapeBox->m_halfSize.y, -shapeBox->m_halfSize.z);
+        glm::vec3 v5 = transform.m_position + R * glm::vec3(-shapeBox->m_halfSize.x, -shapeBox->m_halfSize.y, shapeBox->m_halfSize.z);
+        glm::vec3 v6 = transform.m_position + R * glm::vec3(shapeBox->m_halfSize.x, -shapeBox->m_halfSize.y, shapeBox->m_halfSize.z);
+        glm::vec3 v7 = transform.m_position + R * glm::vec3(shapeBox->m_halfSize.x, shapeBox->m_halfSize.y, shapeBox->m_halfSize.z);
+        glm::vec3 v8 = transform.m_position + R * glm::vec3(-shapeBox->m_halfSize.x, shapeBox->m_halfSize.y, shapeBox->m_halfSize.z);
 
-        if (body == bomb)
+        if (transform.m_body == bomb)
         {
             glColor3f(0.4f, 0.9f, 0.4f);
         }
@@ -129,11 +123,11 @@ static void DrawJoint(Joint* joint)
         Body* b1 = jointSpherical->m_body1;
         Body* b2 = jointSpherical->m_body2;
 
-        glm::vec3 x1 = b1->m_position;
-        glm::vec3 p1 = x1 + b1->m_rotation * jointSpherical->m_localAnchor1;
+        glm::vec3 x1 = b1->m_state->m_position;
+        glm::vec3 p1 = x1 + b1->m_state->m_rotation * jointSpherical->m_localAnchor1;
 
-        glm::vec3 x2 = b2->m_position;
-        glm::vec3 p2 = x2 + b2->m_rotation * jointSpherical->m_localAnchor2;
+        glm::vec3 x2 = b2->m_state->m_position;
+        glm::vec3 p2 = x2 + b2->m_state->m_rotation * jointSpherical->m_localAnchor2;
 
         glColor3f(0.5f, 0.5f, 0.8f);
         glBegin(GL_LINES);
@@ -145,161 +139,187 @@ static void DrawJoint(Joint* joint)
     }
 }
 
+// A body with a single box shape, owned by the world.
+static Body* CreateBody()
+{
+    Handle<Body> body = world.CreateBody();
+    Shape* shape = world.Get(world.CreateShape(body, ShapeType::Box));
+
+    // Shared by every body, and made again after the world is cleared.
+    static Handle<Material> material = NullHandle<Material>();
+    if (!world.Get(material))
+    {
+        material = world.CreateMaterial();
+
+        Material* m = world.Get(material);
+        m->m_staticFriction = 0.2f;
+        m->m_dynamicFriction = 0.2f;
+        m->m_restitution = 0.0f;
+        world.UpdateMaterial(material);
+    }
+    shape->m_material = world.Get(material);
+
+    return world.Get(body);
+}
+
+// Gives the body a material of its own with this friction.
+static void SetFriction(Body* body, float friction)
+{
+    Handle<Material> material = world.CreateMaterial();
+
+    Material* m = world.Get(material);
+    m->m_staticFriction = friction;
+    m->m_dynamicFriction = friction;
+    m->m_restitution = 0.0f;
+    world.UpdateMaterial(material);
+
+    body->m_shapes[0]->m_material = m;
+}
+
+static JointSpherical* CreateJoint()
+{
+    return static_cast<JointSpherical*>(world.Get(world.CreateJoint(JointType::Spherical)));
+}
+
 static void LaunchBomb()
 {
     if (!bomb)
     {
-        bomb = bodies + numBodies;
+        bomb = CreateBody();
         static_cast<ShapeBox*>(bomb->m_shapes[0])->Set(glm::vec3(0.5f, 0.5f, 0.5f));
         bomb->SetMass(50.0f);
+        bomb->m_state->m_useCCD = true;
         world.Add(bomb);
-        ++numBodies;
     }
 
-    bomb->m_position = glm::vec3(glm::linearRand(-15.0f, 15.0f), 15.0f, 0.0f);
-    bomb->m_rotation = glm::quat(glm::vec3(0.0f, 0.0f, glm::linearRand(-1.5f, 1.5f)));
-    bomb->m_velocity = -1.5f * bomb->m_position;
-    bomb->m_angularVelocity = glm::vec3(0.0f, 0.0f, glm::linearRand(-20.0f, 20.0f));
+    bomb->m_state->m_position = glm::vec3(glm::linearRand(-15.0f, 15.0f), 15.0f, 0.0f);
+    bomb->m_state->m_rotation = glm::quat(glm::vec3(0.0f, 0.0f, glm::linearRand(-1.5f, 1.5f)));
+    bomb->m_state->m_velocity = -1.5f * bomb->m_state->m_position;
+    bomb->m_state->m_angularVelocity = glm::vec3(0.0f, 0.0f, glm::linearRand(-20.0f, 20.0f));
 }
 
 // Single box
-static void Demo1(Body* b, JointSpherical* j)
+static void Demo1()
 {
+    Body* b = CreateBody();
     static_cast<ShapeBox*>(b->m_shapes[0])->Set(glm::vec3(50.0f, 10.0f, 10.0f));
     b->SetMass(std::numeric_limits<float>::infinity());
-    b->m_position = glm::vec3(0.0f, -static_cast<ShapeBox*>(b->m_shapes[0])->m_halfSize.y, 0.0f);
+    b->m_state->m_position = glm::vec3(0.0f, -static_cast<ShapeBox*>(b->m_shapes[0])->m_halfSize.y, 0.0f);
     world.Add(b);
-    ++b;
-    ++numBodies;
 
+    b = CreateBody();
     static_cast<ShapeBox*>(b->m_shapes[0])->Set(glm::vec3(0.5f, 0.5f, 0.5f));
     b->SetMass(200.0f);
-    b->m_position = glm::vec3(0.0f, 4.0f, 0.0f);
+    b->m_state->m_position = glm::vec3(0.0f, 4.0f, 0.0f);
     world.Add(b);
-    ++b;
-    ++numBodies;
 }
 
 // A simple pendulum
-static void Demo2(Body* b, JointSpherical* j)
+static void Demo2()
 {
-    Body* b1 = b + 0;
+    Body* b1 = CreateBody();
     static_cast<ShapeBox*>(b1->m_shapes[0])->Set(glm::vec3(50.0f, 10.0f, 10.0f));
     b1->SetMass(std::numeric_limits<float>::infinity());
-    b1->m_position = glm::vec3(0.0f, -static_cast<ShapeBox*>(b1->m_shapes[0])->m_halfSize.y, 0.0f);
-    b1->m_rotation = glm::quat(glm::vec3(0.0f, 0.0f, 0.0f));
+    b1->m_state->m_position = glm::vec3(0.0f, -static_cast<ShapeBox*>(b1->m_shapes[0])->m_halfSize.y, 0.0f);
+    b1->m_state->m_rotation = glm::quat(glm::vec3(0.0f, 0.0f, 0.0f));
     world.Add(b1);
 
-    Body* b2 = b + 1;
+    Body* b2 = CreateBody();
     static_cast<ShapeBox*>(b2->m_shapes[0])->Set(glm::vec3(0.5f, 0.5f, 0.5f));
     b2->SetMass(100.0f);
-    b2->m_position = glm::vec3(9.0f, 11.0f, 0.0f);
-    b2->m_rotation = glm::quat(glm::vec3(0.0f, 0.0f, 0.0f));
+    b2->m_state->m_position = glm::vec3(9.0f, 11.0f, 0.0f);
+    b2->m_state->m_rotation = glm::quat(glm::vec3(0.0f, 0.0f, 0.0f));
     world.Add(b2);
 
-    numBodies += 2;
-
+    JointSpherical* j = CreateJoint();
     j->Set(b1, b2, glm::vec3(0.0f, 11.0f, 0.0f));
     world.Add(j);
-
-    numJoints += 1;
 }
 
 // Varying friction coefficients
-static void Demo3(Body* b, JointSpherical* j)
+static void Demo3()
 {
+    Body* b = CreateBody();
     static_cast<ShapeBox*>(b->m_shapes[0])->Set(glm::vec3(50.0f, 10.0f, 10.0f));
     b->SetMass(std::numeric_limits<float>::infinity());
-    b->m_position = glm::vec3(0.0f, -static_cast<ShapeBox*>(b->m_shapes[0])->m_halfSize.y, 0.0f);
+    b->m_state->m_position = glm::vec3(0.0f, -static_cast<ShapeBox*>(b->m_shapes[0])->m_halfSize.y, 0.0f);
     world.Add(b);
-    ++b;
-    ++numBodies;
 
+    b = CreateBody();
     static_cast<ShapeBox*>(b->m_shapes[0])->Set(glm::vec3(6.5f, 0.125f, 0.125f));
     b->SetMass(std::numeric_limits<float>::infinity());
-    b->m_position = glm::vec3(-2.0f, 11.0f, 0.0f);
-    b->m_rotation = glm::quat(glm::vec3(0.0f, 0.0f, -0.25f));
+    b->m_state->m_position = glm::vec3(-2.0f, 11.0f, 0.0f);
+    b->m_state->m_rotation = glm::quat(glm::vec3(0.0f, 0.0f, -0.25f));
     world.Add(b);
-    ++b;
-    ++numBodies;
 
+    b = CreateBody();
     static_cast<ShapeBox*>(b->m_shapes[0])->Set(glm::vec3(0.125f, 0.5f, 0.5f));
     b->SetMass(std::numeric_limits<float>::infinity());
-    b->m_position = glm::vec3(5.25f, 9.5f, 0.0f);
+    b->m_state->m_position = glm::vec3(5.25f, 9.5f, 0.0f);
     world.Add(b);
-    ++b;
-    ++numBodies;
 
+    b = CreateBody();
     static_cast<ShapeBox*>(b->m_shapes[0])->Set(glm::vec3(6.5f, 0.125f, 0.125f));
     b->SetMass(std::numeric_limits<float>::infinity());
-    b->m_position = glm::vec3(2.0f, 7.0f, 0.0f);
-    b->m_rotation = glm::quat(glm::vec3(0.0f, 0.0f, 0.25f));
+    b->m_state->m_position = glm::vec3(2.0f, 7.0f, 0.0f);
+    b->m_state->m_rotation = glm::quat(glm::vec3(0.0f, 0.0f, 0.25f));
     world.Add(b);
-    ++b;
-    ++numBodies;
 
+    b = CreateBody();
     static_cast<ShapeBox*>(b->m_shapes[0])->Set(glm::vec3(0.125f, 0.5f, 0.5f));
     b->SetMass(std::numeric_limits<float>::infinity());
-    b->m_position = glm::vec3(-5.25f, 5.5f, 0.0f);
+    b->m_state->m_position = glm::vec3(-5.25f, 5.5f, 0.0f);
     world.Add(b);
-    ++b;
-    ++numBodies;
 
+    b = CreateBody();
     static_cast<ShapeBox*>(b->m_shapes[0])->Set(glm::vec3(6.5f, 0.125f, 0.125f));
     b->SetMass(std::numeric_limits<float>::infinity());
-    b->m_position = glm::vec3(-2.0f, 3.0f, 0.0f);
-    b->m_rotation = glm::quat(glm::vec3(0.0f, 0.0f, -0.25f));
+    b->m_state->m_position = glm::vec3(-2.0f, 3.0f, 0.0f);
+    b->m_state->m_rotation = glm::quat(glm::vec3(0.0f, 0.0f, -0.25f));
     world.Add(b);
-    ++b;
-    ++numBodies;
 
     float friction[5] = {0.75f, 0.5f, 0.35f, 0.1f, 0.0f};
     for (int i = 0; i < 5; ++i)
     {
+        b = CreateBody();
         static_cast<ShapeBox*>(b->m_shapes[0])->Set(glm::vec3(0.25f, 0.25f, 0.25f));
         b->SetMass(25.0f);
-        b->m_shapes[0]->m_material->m_staticFriction = friction[i];
-        b->m_shapes[0]->m_material->m_dynamicFriction = friction[i];
-        b->m_position = glm::vec3(-7.5f + 2.0f * i, 14.0f, 0.0f);
+        SetFriction(b, friction[i]);
+        b->m_state->m_position = glm::vec3(-7.5f + 2.0f * i, 14.0f, 0.0f);
         world.Add(b);
-        ++b;
-        ++numBodies;
     }
 }
 
 // A vertical stack
-static void Demo4(Body* b, JointSpherical* j)
+static void Demo4()
 {
+    Body* b = CreateBody();
     static_cast<ShapeBox*>(b->m_shapes[0])->Set(glm::vec3(50.0f, 10.0f, 10.0f));
     b->SetMass(std::numeric_limits<float>::infinity());
-    b->m_position = glm::vec3(0.0f, -static_cast<ShapeBox*>(b->m_shapes[0])->m_halfSize.y, 0.0f);
-    b->m_rotation = glm::quat(glm::vec3(0.0f, 0.0f, 0.0f));
+    b->m_state->m_position = glm::vec3(0.0f, -static_cast<ShapeBox*>(b->m_shapes[0])->m_halfSize.y, 0.0f);
+    b->m_state->m_rotation = glm::quat(glm::vec3(0.0f, 0.0f, 0.0f));
     world.Add(b);
-    ++b;
-    ++numBodies;
 
     for (int i = 0; i < 10; ++i)
     {
+        b = CreateBody();
         static_cast<ShapeBox*>(b->m_shapes[0])->Set(glm::vec3(0.5f, 0.5f, 0.5f));
         b->SetMass(1.0f);
         float x = glm::linearRand(-0.1f, 0.1f);
-        b->m_position = glm::vec3(x, 0.51f + 1.05f * i, 0.0f);
+        b->m_state->m_position = glm::vec3(x, 0.51f + 1.05f * i, 0.0f);
         world.Add(b);
-        ++b;
-        ++numBodies;
     }
 }
 
 // A pyramid
-static void Demo5(Body* b, JointSpherical* j)
+static void Demo5()
 {
+    Body* b = CreateBody();
     static_cast<ShapeBox*>(b->m_shapes[0])->Set(glm::vec3(50.0f, 10.0f, 10.0f));
     b->SetMass(std::numeric_limits<float>::infinity());
-    b->m_position = glm::vec3(0.0f, -static_cast<ShapeBox*>(b->m_shapes[0])->m_halfSize.y, 0.0f);
-    b->m_rotation = glm::quat(glm::vec3(0.0f, 0.0f, 0.0f));
+    b->m_state->m_position = glm::vec3(0.0f, -static_cast<ShapeBox*>(b->m_shapes[0])->m_halfSize.y, 0.0f);
+    b->m_state->m_rotation = glm::quat(glm::vec3(0.0f, 0.0f, 0.0f));
     world.Add(b);
-    ++b;
-    ++numBodies;
 
     glm::vec3 x(-6.0f, 0.75f, 0.0f);
     glm::vec3 y;
@@ -310,12 +330,11 @@ static void Demo5(Body* b, JointSpherical* j)
 
         for (int j = i; j < 12; ++j)
         {
+            b = CreateBody();
             static_cast<ShapeBox*>(b->m_shapes[0])->Set(glm::vec3(0.5f, 0.5f, 0.5f));
             b->SetMass(10.0f);
-            b->m_position = y;
+            b->m_state->m_position = y;
             world.Add(b);
-            ++b;
-            ++numBodies;
 
             y += glm::vec3(1.125f, 0.0f, 0.0f);
         }
@@ -325,68 +344,66 @@ static void Demo5(Body* b, JointSpherical* j)
 }
 
 // A teeter
-static void Demo6(Body* b, JointSpherical* j)
+static void Demo6()
 {
-    Body* b1 = b + 0;
+    Body* b1 = CreateBody();
     static_cast<ShapeBox*>(b1->m_shapes[0])->Set(glm::vec3(50.0f, 10.0f, 10.0f));
     b1->SetMass(std::numeric_limits<float>::infinity());
-    b1->m_position = glm::vec3(0.0f, -static_cast<ShapeBox*>(b1->m_shapes[0])->m_halfSize.y, 0.0f);
+    b1->m_state->m_position = glm::vec3(0.0f, -static_cast<ShapeBox*>(b1->m_shapes[0])->m_halfSize.y, 0.0f);
     world.Add(b1);
 
-    Body* b2 = b + 1;
+    Body* b2 = CreateBody();
     static_cast<ShapeBox*>(b2->m_shapes[0])->Set(glm::vec3(6.0f, 0.125f, 0.125f));
     b2->SetMass(100.0f);
-    b2->m_position = glm::vec3(0.0f, 1.0f, 0.0f);
+    b2->m_state->m_position = glm::vec3(0.0f, 1.0f, 0.0f);
     world.Add(b2);
 
-    Body* b3 = b + 2;
+    Body* b3 = CreateBody();
     static_cast<ShapeBox*>(b3->m_shapes[0])->Set(glm::vec3(0.25f, 0.25f, 0.25f));
     b3->SetMass(25.0f);
-    b3->m_position = glm::vec3(-5.0f, 2.0f, 0.0f);
+    b3->m_state->m_position = glm::vec3(-5.0f, 2.0f, 0.0f);
     world.Add(b3);
 
-    Body* b4 = b + 3;
+    Body* b4 = CreateBody();
     static_cast<ShapeBox*>(b4->m_shapes[0])->Set(glm::vec3(0.25f, 0.25f, 0.25f));
     b4->SetMass(25.0f);
-    b4->m_position = glm::vec3(-5.5f, 2.0f, 0.0f);
+    b4->m_state->m_position = glm::vec3(-5.5f, 2.0f, 0.0f);
     world.Add(b4);
 
-    Body* b5 = b + 4;
+    Body* b5 = CreateBody();
     static_cast<ShapeBox*>(b5->m_shapes[0])->Set(glm::vec3(0.5f, 0.5f, 0.5f));
     b5->SetMass(100.0f);
-    b5->m_position = glm::vec3(5.5f, 15.0f, 0.0f);
+    b5->m_state->m_position = glm::vec3(5.5f, 15.0f, 0.0f);
     world.Add(b5);
 
-    numBodies += 5;
-
+    JointSpherical* j = CreateJoint();
     j->Set(b1, b2, glm::vec3(0.0f, 1.0f, 0.0f));
     world.Add(j);
-
-    numJoints += 1;
 }
 
 // A suspension bridge
-static void Demo7(Body* b, JointSpherical* j)
+static void Demo7()
 {
+    Body* b = CreateBody();
     static_cast<ShapeBox*>(b->m_shapes[0])->Set(glm::vec3(50.0f, 10.0f, 10.0f));
     b->SetMass(std::numeric_limits<float>::infinity());
-    b->m_position = glm::vec3(0.0f, -static_cast<ShapeBox*>(b->m_shapes[0])->m_halfSize.y, 0.0f);
-    b->m_rotation = glm::quat(glm::vec3(0.0f, 0.0f, 0.0f));
+    b->m_state->m_position = glm::vec3(0.0f, -static_cast<ShapeBox*>(b->m_shapes[0])->m_halfSize.y, 0.0f);
+    b->m_state->m_rotation = glm::quat(glm::vec3(0.0f, 0.0f, 0.0f));
     world.Add(b);
-    ++b;
-    ++numBodies;
 
+    Body* ground = b;
     const int numPlanks = 15;
+    Body* planks[numPlanks];
     float mass = 50.0f;
 
     for (int i = 0; i < numPlanks; ++i)
     {
+        b = CreateBody();
         static_cast<ShapeBox*>(b->m_shapes[0])->Set(glm::vec3(0.5f, 0.125f, 0.125f));
         b->SetMass(mass);
-        b->m_position = glm::vec3(-8.5f + 1.25f * i, 5.0f, 0.0f);
+        b->m_state->m_position = glm::vec3(-8.5f + 1.25f * i, 5.0f, 0.0f);
         world.Add(b);
-        ++b;
-        ++numBodies;
+        planks[i] = b;
     }
 
     // Tuning
@@ -406,138 +423,123 @@ static void Demo7(Body* b, JointSpherical* j)
     float softness = 1.0f / (d + timeStep * k);
     float biasFactor = timeStep * k / (d + timeStep * k);
 
+    Body* b1 = ground;
     for (int i = 0; i < numPlanks; ++i)
     {
-        j->Set(bodies + i, bodies + i + 1, glm::vec3(-9.125f + 1.25f * i, 5.0f, 0.0f));
+        JointSpherical* j = CreateJoint();
+        j->Set(b1, planks[i], glm::vec3(-9.125f + 1.25f * i, 5.0f, 0.0f));
         j->m_softness = softness;
         j->m_biasFactor = biasFactor;
 
         world.Add(j);
-        ++j;
-        ++numJoints;
+
+        b1 = planks[i];
     }
 
-    j->Set(bodies + numPlanks, bodies, glm::vec3(-9.125f + 1.25f * numPlanks, 5.0f, 0.0f));
+    JointSpherical* j = CreateJoint();
+    j->Set(b1, ground, glm::vec3(-9.125f + 1.25f * numPlanks, 5.0f, 0.0f));
     j->m_softness = softness;
     j->m_biasFactor = biasFactor;
     world.Add(j);
-    ++j;
-    ++numJoints;
 }
 
 // Dominos
-static void Demo8(Body* b, JointSpherical* j)
+static void Demo8()
 {
+    Body* b = CreateBody();
     Body* b1 = b;
     static_cast<ShapeBox*>(b->m_shapes[0])->Set(glm::vec3(50.0f, 10.0f, 10.0f));
     b->SetMass(std::numeric_limits<float>::infinity());
-    b->m_position = glm::vec3(0.0f, -static_cast<ShapeBox*>(b->m_shapes[0])->m_halfSize.y, 0.0f);
+    b->m_state->m_position = glm::vec3(0.0f, -static_cast<ShapeBox*>(b->m_shapes[0])->m_halfSize.y, 0.0f);
     world.Add(b);
-    ++b;
-    ++numBodies;
 
+    b = CreateBody();
     static_cast<ShapeBox*>(b->m_shapes[0])->Set(glm::vec3(6.0f, 0.25f, 0.25f));
     b->SetMass(std::numeric_limits<float>::infinity());
-    b->m_position = glm::vec3(-1.5f, 10.0f, 0.0f);
+    b->m_state->m_position = glm::vec3(-1.5f, 10.0f, 0.0f);
     world.Add(b);
-    ++b;
-    ++numBodies;
 
     for (int i = 0; i < 10; ++i)
     {
+        b = CreateBody();
         static_cast<ShapeBox*>(b->m_shapes[0])->Set(glm::vec3(0.1f, 1.0f, 1.0f));
         b->SetMass(10.0f);
-        b->m_position = glm::vec3(-6.0f + 1.0f * i, 11.125f, 0.0f);
-        b->m_shapes[0]->m_material->m_staticFriction = 0.1f;
-        b->m_shapes[0]->m_material->m_dynamicFriction = 0.1f;
+        b->m_state->m_position = glm::vec3(-6.0f + 1.0f * i, 11.125f, 0.0f);
+        SetFriction(b, 0.1f);
         world.Add(b);
-        ++b;
-        ++numBodies;
     }
 
+    b = CreateBody();
     static_cast<ShapeBox*>(b->m_shapes[0])->Set(glm::vec3(7.0f, 0.25f, 0.25f));
     b->SetMass(std::numeric_limits<float>::infinity());
-    b->m_position = glm::vec3(1.0f, 6.0f, 0.0f);
-    b->m_rotation = glm::quat(glm::vec3(0.0f, 0.0f, 0.3f));
+    b->m_state->m_position = glm::vec3(1.0f, 6.0f, 0.0f);
+    b->m_state->m_rotation = glm::quat(glm::vec3(0.0f, 0.0f, 0.3f));
     world.Add(b);
-    ++b;
-    ++numBodies;
 
+    b = CreateBody();
     Body* b2 = b;
     static_cast<ShapeBox*>(b->m_shapes[0])->Set(glm::vec3(0.25f, 1.5f, 1.5f));
     b->SetMass(std::numeric_limits<float>::infinity());
-    b->m_position = glm::vec3(-7.0f, 4.0f, 0.0f);
+    b->m_state->m_position = glm::vec3(-7.0f, 4.0f, 0.0f);
     world.Add(b);
-    ++b;
-    ++numBodies;
 
+    b = CreateBody();
     Body* b3 = b;
     static_cast<ShapeBox*>(b->m_shapes[0])->Set(glm::vec3(6.0f, 0.125f, 0.125f));
     b->SetMass(20.0f);
-    b->m_position = glm::vec3(-0.9f, 1.0f, 0.0f);
+    b->m_state->m_position = glm::vec3(-0.9f, 1.0f, 0.0f);
     world.Add(b);
-    ++b;
-    ++numBodies;
 
+    JointSpherical* j = CreateJoint();
     j->Set(b1, b3, glm::vec3(-2.0f, 1.0f, 0.0f));
     world.Add(j);
-    ++j;
-    ++numJoints;
 
+    b = CreateBody();
     Body* b4 = b;
     static_cast<ShapeBox*>(b->m_shapes[0])->Set(glm::vec3(0.25f, 0.25f, 0.25f));
     b->SetMass(10.0f);
-    b->m_position = glm::vec3(-10.0f, 15.0f, 0.0f);
+    b->m_state->m_position = glm::vec3(-10.0f, 15.0f, 0.0f);
     world.Add(b);
-    ++b;
-    ++numBodies;
 
+    j = CreateJoint();
     j->Set(b2, b4, glm::vec3(-7.0f, 15.0f, 0.0f));
     world.Add(j);
-    ++j;
-    ++numJoints;
 
+    b = CreateBody();
     Body* b5 = b;
     static_cast<ShapeBox*>(b->m_shapes[0])->Set(glm::vec3(1.0f, 1.0f, 1.0f));
     b->SetMass(20.0f);
-    b->m_position = glm::vec3(6.0f, 2.5f, 0.0f);
-    b->m_shapes[0]->m_material->m_staticFriction = 0.1f;
-    b->m_shapes[0]->m_material->m_dynamicFriction = 0.1f;
+    b->m_state->m_position = glm::vec3(6.0f, 2.5f, 0.0f);
+    SetFriction(b, 0.1f);
     world.Add(b);
-    ++b;
-    ++numBodies;
 
+    j = CreateJoint();
     j->Set(b1, b5, glm::vec3(6.0f, 2.6f, 0.0f));
     world.Add(j);
-    ++j;
-    ++numJoints;
 
+    b = CreateBody();
     Body* b6 = b;
     static_cast<ShapeBox*>(b->m_shapes[0])->Set(glm::vec3(1.0f, 0.1f, 0.1f));
     b->SetMass(10.0f);
-    b->m_position = glm::vec3(6.0f, 3.6f, 0.0f);
+    b->m_state->m_position = glm::vec3(6.0f, 3.6f, 0.0f);
     world.Add(b);
-    ++b;
-    ++numBodies;
 
+    j = CreateJoint();
     j->Set(b5, b6, glm::vec3(7.0f, 3.5f, 0.0f));
     world.Add(j);
-    ++j;
-    ++numJoints;
 }
 
 // A multi-pendulum
-static void Demo9(Body* b, JointSpherical* j)
+static void Demo9()
 {
+    Body* b = CreateBody();
     static_cast<ShapeBox*>(b->m_shapes[0])->Set(glm::vec3(50.0f, 10.0f, 10.0f));
     b->SetMass(std::numeric_limits<float>::infinity());
-    b->m_position = glm::vec3(0.0f, -static_cast<ShapeBox*>(b->m_shapes[0])->m_halfSize.y, 0.0f);
-    b->m_rotation = glm::quat(glm::vec3(0.0f, 0.0f, 0.0f));
+    b->m_state->m_position = glm::vec3(0.0f, -static_cast<ShapeBox*>(b->m_shapes[0])->m_halfSize.y, 0.0f);
+    b->m_state->m_rotation = glm::quat(glm::vec3(0.0f, 0.0f, 0.0f));
     world.Add(b);
 
     Body* b1 = b;
-    ++b;
-    ++numBodies;
 
     float mass = 10.0f;
 
@@ -562,27 +564,25 @@ static void Demo9(Body* b, JointSpherical* j)
 
     for (int i = 0; i < 15; ++i)
     {
+        b = CreateBody();
         glm::vec3 x(0.5f + i, y, 0.0f);
         static_cast<ShapeBox*>(b->m_shapes[0])->Set(glm::vec3(0.375f, 0.125f, 0.375f));
         b->SetMass(mass);
-        b->m_position = x;
-        b->m_rotation = glm::quat(glm::vec3(0.0f, 0.0f, 0.0f));
+        b->m_state->m_position = x;
+        b->m_state->m_rotation = glm::quat(glm::vec3(0.0f, 0.0f, 0.0f));
         world.Add(b);
 
+        JointSpherical* j = CreateJoint();
         j->Set(b1, b, glm::vec3(float(i), y, 0.0f));
         j->m_softness = softness;
         j->m_biasFactor = biasFactor;
         world.Add(j);
 
         b1 = b;
-        ++b;
-        ++numBodies;
-        ++j;
-        ++numJoints;
     }
 }
 
-void (*demos[])(Body* b, JointSpherical* j) = {Demo1, Demo2, Demo3, Demo4, Demo5, Demo6, Demo7, Demo8, Demo9};
+void (*demos[])() = {Demo1, Demo2, Demo3, Demo4, Demo5, Demo6, Demo7, Demo8, Demo9};
 const char* demoStrings[] = {
     "Demo 1: A Single Box",
     "Demo 2: Simple Pendulum",
@@ -596,27 +596,12 @@ const char* demoStrings[] = {
 
 static void InitDemo(int index)
 {
-    for (int i = 0; i < numBodies; ++i)
-    {
-        Body* body = bodies + i;
-        body->m_position = glm::vec3(0.0f, 0.0f, 0.0f);
-        body->m_rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
-        body->m_velocity = glm::vec3(0.0f, 0.0f, 0.0f);
-        body->m_angularVelocity = glm::vec3(0.0f, 0.0f, 0.0f);
-        body->m_force = glm::vec3(0.0f, 0.0f, 0.0f);
-        body->m_torque = glm::vec3(0.0f, 0.0f, 0.0f);
-        static_cast<ShapeBox*>(body->m_shapes[0])->m_material->m_staticFriction = 0.2f;
-        static_cast<ShapeBox*>(body->m_shapes[0])->m_material->m_dynamicFriction = 0.2f;
-        static_cast<ShapeBox*>(body->m_shapes[0])->m_material->m_restitution = 0.0f;
-    }
-
+    // Clearing the world destroys the objects it created.
     world.Clear();
-    numBodies = 0;
-    numJoints = 0;
     bomb = NULL;
 
     demoIndex = index;
-    demos[index](bodies, joints);
+    demos[index]();
 }
 
 static void Keyboard(GLFWwindow* window, int key, int scancode, int action, int mods)
@@ -722,19 +707,11 @@ int main(int, char**)
     glm::mat4 projection = glm::perspective(glm::radians(60.0f), float(width) / float(height), 0.1f, 100.0f);
     glLoadMatrixf(glm::value_ptr(projection));
 
-    for (int i = 0; i < 200; ++i)
-    {
-        Body* body = bodies + i;
-        ShapeBox* shapeBox = new ShapeBox;
-        shapeBox->m_material = new Material;
-        shapeBox->m_material->m_staticFriction = 0.2f;
-        shapeBox->m_material->m_dynamicFriction = 0.2f;
-        shapeBox->m_material->m_restitution = 0.0f;
-        body->AddShape(shapeBox);
-    }
-
     InitDemo(0);
 
+    world.m_fixedTimeStep = timeStep;
+    double lastTime = glfwGetTime();
+
     while (!glfwWindowShouldClose(mainWindow))
     {
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -755,20 +732,23 @@ int main(int, char**)
         glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 20.0f, 50.0f), glm::vec3(0.0f, 20.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
         glLoadMatrixf(glm::value_ptr(view));
 
-        world.Step(timeStep);
+        double time = glfwGetTime();
+        world.Advance(float(time - lastTime));
+        lastTime = time;
 
-        for (int i = 0; i < numBodies; ++i)
+        const Vector<BodyTransform>& transforms = world.GetInterpolatedTransforms();
+        for (size_t i = 0; i < transforms.size(); ++i)
         {
-            Body* body = bodies + i;
+            const Body* body = transforms[i].m_body;
             for (size_t s = 0; s < body->m_shapes.size(); ++s)
             {
-                DrawShape(body, body->m_shapes[s]);
+                DrawShape(transforms[i], body->m_shapes[s]);
             }
         }
 
-        for (int i = 0; i < numJoints; ++i)
+        for (size_t i = 0; i < world.m_joints.size(); ++i)
         {
-            DrawJoint(joints + i);
+            DrawJoint(world.m_joints[i]);
         }
 
         glPointSize(4.0f);
@@ -778,7 +758,7 @@ int main(int, char**)
         for (const auto& iter : world.m_arbiters)
         {
             const Arbiter& arbiter = iter.second;
-            for (int i = 0; i < arbiter.m_contactCount; ++i)
+            for (size_t i = 0; i < arbiter.m_contactCount; ++i)
             {
                 glm::vec3 p = arbiter.m_contacts[i].m_position;
                 glVertex3f(p.x, p.y, p.z);
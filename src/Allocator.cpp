@@ -0,0 +1,219 @@
+#include "Allocator.h"
+#include <new>
+
+constexpr size_t k_blockAlignment = 64;
+// Keeps the memory after a block header on the block alignment.
+constexpr size_t k_blockHeaderSize = k_blockAlignment;
+
+static_assert(sizeof(ArenaBlock) <= k_blockHeaderSize, "ArenaBlock does not fit in its header");
+
+unsigned char* AlignUp(unsigned char* pointer, size_t alignment)
+{
+    const uintptr_t address = reinterpret_cast<uintptr_t>(pointer);
+    return pointer + (((address + alignment - 1) & ~(alignment - 1)) - address);
+}
+
+ArenaBlock* AllocateBlock(Allocator* parent, size_t size, ArenaBlock* next)
+{
+    ArenaBlock* block = static_cast<ArenaBlock*>(parent->Allocate(size, k_blockAlignment));
+    block->m_next = next;
+    block->m_size = size;
+    return block;
+}
+
+void FreeBlocks(Allocator* parent, ArenaBlock* block)
+{
+    while (block)
+    {
+        ArenaBlock* next = block->m_next;
+        parent->Free(block, block->m_size, k_blockAlignment);
+        block = next;
+    }
+}
+
+void* HeapAllocator::Allocate(size_t size, size_t alignment)
+{
+    return ::operator new(size, std::align_val_t(alignment));
+}
+
+void HeapAllocator::Free(void* memory, size_t, size_t alignment)
+{
+    ::operator delete(memory, std::align_val_t(alignment));
+}
+
+Allocator* GetHeapAllocator()
+{
+    static HeapAllocator heapAllocator;
+    return &heapAllocator;
+}
+
+ArenaAllocator::ArenaAllocator(size_t blockSize, Allocator* parent)
+: m_parent(parent)
+, m_blockSize(blockSize)
+, m_blocks(nullptr)
+, m_cursor(nullptr)
+, m_end(nullptr)
+{
+}
+
+ArenaAllocator::~ArenaAllocator()
+{
+    FreeBlocks(m_parent, m_blocks);
+}
+
+void* ArenaAllocator::Allocate(size_t size, size_t alignment)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    unsigned char* memory = AlignUp(m_cursor, alignment);
+    if (!m_cursor || (memory + size > m_end))
+    {
+        size_t blockSize = k_blockHeaderSize + size + alignment;
+        if (blockSize < m_blockSize)
+        {
+            blockSize = m_blockSize;
+        }
+
+        m_blocks = AllocateBlock(m_parent, blockSize, m_blocks);
+        m_cursor = reinterpret_cast<unsigned char*>(m_blocks) + k_blockHeaderSize;
+        m_end = reinterpret_cast<unsigned char*>(m_blocks) + blockSize;
+        memory = AlignUp(m_cursor, alignment);
+    }
+
+    m_cursor = memory + size;
+    return memory;
+}
+
+void ArenaAllocator::Free(void*, size_t, size_t)
+{
+}
+
+void ArenaAllocator::Reset()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    FreeBlocks(m_parent, m_blocks);
+    m_blocks = nullptr;
+    m_cursor = nullptr;
+    m_end = nullptr;
+}
+
+// Returns k_sizeClassCount for allocations that go to the parent.
+size_t GetSizeClass(size_t size, size_t alignment)
+{
+    if (alignment > k_blockAlignment)
+    {
+        return PoolAllocator::k_sizeClassCount;
+    }
+
+    if (size < alignment)
+    {
+        size = alignment;
+    }
+
+    size_t sizeClass = 0;
+    for (size_t classSize = PoolAllocator::k_minSize; classSize < size; classSize *= 2)
+    {
+        ++sizeClass;
+    }
+
+    return (sizeClass < PoolAllocator::k_sizeClassCount) ? sizeClass : PoolAllocator::k_sizeClassCount;
+}
+
+// Takes a new slot of the size class from the current block, or from a new
+// one. The pool must be locked.
+void* CutSlot(PoolAllocator& pool, size_t sizeClass)
+{
+    // Every size is a power of two, so aligning to it, up to the block
+    // alignment, covers any alignment that maps to its class.
+    const size_t classSize = PoolAllocator::k_minSize << sizeClass;
+    unsigned char* slot = AlignUp(pool.m_cursor, (classSize < k_blockAlignment) ? classSize : k_blockAlignment);
+    if (!pool.m_cursor || (slot + classSize > pool.m_end))
+    {
+        pool.m_blocks = AllocateBlock(pool.m_parent, PoolAllocator::k_blockSize, pool.m_blocks);
+        pool.m_cursor = reinterpret_cast<unsigned char*>(pool.m_blocks) + k_blockHeaderSize;
+        pool.m_end = reinterpret_cast<unsigned char*>(pool.m_blocks) + PoolAllocator::k_blockSize;
+        slot = pool.m_cursor;
+    }
+
+    pool.m_cursor = slot + classSize;
+    return slot;
+}
+
+PoolAllocator::PoolAllocator(Allocator* parent)
+: m_parent(parent)
+, m_blocks(nullptr)
+, m_cursor(nullptr)
+, m_end(nullptr)
+, m_freeLists{}
+{
+}
+
+PoolAllocator::~PoolAllocator()
+{
+    FreeBlocks(m_parent, m_blocks);
+}
+
+void* PoolAllocator::Allocate(size_t size, size_t alignment)
+{
+    const size_t sizeClass = GetSizeClass(size, alignment);
+    if (sizeClass == k_sizeClassCount)
+    {
+        return m_parent->Allocate(size, alignment);
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    void* memory = m_freeLists[sizeClass];
+    if (memory)
+    {
+        m_freeLists[sizeClass] = *static_cast<void**>(memory);
+        return memory;
+    }
+
+    return CutSlot(*this, sizeClass);
+}
+
+void PoolAllocator::Free(void* memory, size_t size, size_t alignment)
+{
+    if (!memory)
+    {
+        return;
+    }
+
+    const size_t sizeClass = GetSizeClass(size, alignment);
+    if (sizeClass == k_sizeClassCount)
+    {
+        m_parent->Free(memory, size, alignment);
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    *static_cast<void**>(memory) = m_freeLists[sizeClass];
+    m_freeLists[sizeClass] = memory;
+}
+
+void PoolAllocator::Reserve(size_t size, size_t alignment, size_t count)
+{
+    const size_t sizeClass = GetSizeClass(size, alignment);
+    if (sizeClass == k_sizeClassCount)
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    size_t freeCount = 0;
+    for (void* memory = m_freeLists[sizeClass]; memory && (freeCount < count); memory = *static_cast<void**>(memory))
+    {
+        ++freeCount;
+    }
+
+    for (; freeCount < count; ++freeCount)
+    {
+        void* memory = CutSlot(*this, sizeClass);
+        *static_cast<void**>(memory) = m_freeLists[sizeClass];
+        m_freeLists[sizeClass] = memory;
+    }
+}
\ No newline at end of file
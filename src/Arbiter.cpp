@@ -1,9 +1,8 @@
 #include "Arbiter.h"
 #include "Body.h"
+#include "Constraint.h"
 #include "World.h"
 
-constexpr float velocityThreshold = 1.0f;
-
 void ComputeBasis(const glm::vec3& a, glm::vec3& b, glm::vec3& c)
 {
     // Suppose vector a has all equal components and is a unit vector:
@@ -21,7 +20,7 @@ void ComputeBasis(const glm::vec3& a, glm::vec3& b, glm::vec3& c)
     c = glm::cross(a, b);
 }
 
-Arbiter::Arbiter(Shape* shape1, Shape* shape2)
+Arbiter::Arbiter(Shape* shape1, Shape* shape2, float margin, const MaterialPair& materialPair)
 {
     Shape* lowestShape;
     Shape* highestShape;
@@ -35,81 +34,21 @@ Arbiter::Arbiter(Shape* shape1, Shape* shape2)
         lowestShape = shape2;
         highestShape = shape1;
     }
+    m_shape1 = lowestShape;
+    m_shape2 = highestShape;
     m_body1 = lowestShape->m_owner;
     m_body2 = highestShape->m_owner;
     m_isTrigger = shape1->IsTrigger() || shape2->IsTrigger();
+    m_timestamp = 0;
+    m_index1 = 0;
+    m_index2 = 0;
+    m_useBlockSolver = false;
 
-    m_contactCount = Collide(m_contacts, m_body1, lowestShape, m_body2, highestShape);
-
-    const CombineMode effectiveFrictionCombineMode = std::max(lowestShape->m_material->m_frictionCombineMode, highestShape->m_material->m_frictionCombineMode);
-    switch (effectiveFrictionCombineMode)
-    {
-        case CombineMode::Average:
-        {
-            m_staticFriction = (lowestShape->m_material->m_staticFriction + highestShape->m_material->m_staticFriction) * 0.5f;
-            m_dynamicFriction = (lowestShape->m_material->m_dynamicFriction + highestShape->m_material->m_dynamicFriction) * 0.5f;
-            break;
-        }
+    m_contactCount = Collide(m_contacts, m_body1, lowestShape, m_body2, highestShape, margin);
 
-        case CombineMode::Minimum:
-        {
-            m_staticFriction = std::min(lowestShape->m_material->m_staticFriction, highestShape->m_material->m_staticFriction);
-            m_dynamicFriction = std::min(lowestShape->m_material->m_dynamicFriction, highestShape->m_material->m_dynamicFriction);
-            break;
-        }
-
-        case CombineMode::Multiply:
-        {
-            m_staticFriction = lowestShape->m_material->m_staticFriction * highestShape->m_material->m_staticFriction;
-            m_dynamicFriction = lowestShape->m_material->m_dynamicFriction * highestShape->m_material->m_dynamicFriction;
-            break;
-        }
-
-        case CombineMode::Maximum:
-        {
-            m_staticFriction = std::max(lowestShape->m_material->m_staticFriction, highestShape->m_material->m_staticFriction);
-            m_dynamicFriction = std::max(lowestShape->m_material->m_dynamicFriction, highestShape->m_material->m_dynamicFriction);
-            break;
-        }
-
-        default:
-        {
-            assert(false);
-        }
-    }
-
-    const CombineMode effectiveRestitutionCombineMode = std::max(lowestShape->m_material->m_restitutionCombineMode, highestShape->m_material->m_restitutionCombineMode);
-    switch (effectiveRestitutionCombineMode)
-    {
-        case CombineMode::Average:
-        {
-            m_restitution = (lowestShape->m_material->m_restitution + highestShape->m_material->m_restitution) * 0.5f;
-            break;
-        }
-
-        case CombineMode::Minimum:
-        {
-            m_restitution = std::min(lowestShape->m_material->m_restitution, highestShape->m_material->m_restitution);
-            break;
-        }
-
-        case CombineMode::Multiply:
-        {
-            m_restitution = lowestShape->m_material->m_restitution * highestShape->m_material->m_restitution;
-            break;
-        }
-
-        case CombineMode::Maximum:
-        {
-            m_restitution = std::max(lowestShape->m_material->m_restitution, highestShape->m_material->m_restitution);
-            break;
-        }
-
-        default:
-        {
-            assert(false);
-        }
-    }
+    m_staticFriction = materialPair.m_staticFriction;
+    m_dynamicFriction = materialPair.m_dynamicFriction;
+    m_restitution = materialPair.m_restitution;
 }
 
 void Arbiter::Update(Contact* contacts, size_t contactCount, Contact* newContacts, size_t& newContactCount)
@@ -140,6 +79,7 @@ void Arbiter::Update(Contact* contacts, size_t contactCount, Contact* newContact
             c->m_Pn = cOld->m_Pn;
             c->m_Pt = cOld->m_Pt;
             c->m_Pb = cOld->m_Pb;
+            c->m_Pp = cOld->m_Pp;
         }
         else
         {
@@ -158,153 +98,717 @@ void Arbiter::Update(Contact* contacts, size_t contactCount, Contact* newContact
     m_contactCount = contactCount;
 }
 
-void Arbiter::PreStep(float invElapsedTime)
+void Arbiter::PreStep(const SolverBodies& bodies, float invElapsedTime, bool useBlockSolver, bool useSplitImpulse)
 {
     if (m_isTrigger)
     {
         return;
     }
 
+    m_index1 = m_body1->m_solverIndex;
+    m_index2 = m_body2->m_solverIndex;
+
+    const glm::vec3& v1 = bodies.m_velocities[m_index1];
+    const glm::vec3& w1 = bodies.m_angularVelocities[m_index1];
+    const glm::vec3& v2 = bodies.m_velocities[m_index2];
+    const glm::vec3& w2 = bodies.m_angularVelocities[m_index2];
+    const float invMass1 = bodies.m_invMasses[m_index1];
+    const float invMass2 = bodies.m_invMasses[m_index2];
+    const glm::mat3& invI1 = bodies.m_invIs[m_index1];
+    const glm::mat3& invI2 = bodies.m_invIs[m_index2];
+
     for (size_t i = 0; i < m_contactCount; ++i)
     {
         Contact* c = m_contacts + i;
 
-        glm::vec3 r1 = c->m_position - m_body1->m_position;
-        glm::vec3 r2 = c->m_position - m_body2->m_position;
+        c->m_r1 = c->m_position - m_body1->m_state->m_position;
+        c->m_r2 = c->m_position - m_body2->m_state->m_position;
+        const glm::vec3& r1 = c->m_r1;
+        const glm::vec3& r2 = c->m_r2;
 
         glm::vec3 rn1 = glm::cross(r1, c->m_normal);
         glm::vec3 rn2 = glm::cross(r2, c->m_normal);
-        float kNormal = m_body1->m_invMass + m_body2->m_invMass;
-        kNormal += glm::dot(rn1, m_body1->m_invI * rn1);
-        kNormal += glm::dot(rn2, m_body2->m_invI * rn2);
+        float kNormal = invMass1 + invMass2;
+        kNormal += glm::dot(rn1, invI1 * rn1);
+        kNormal += glm::dot(rn2, invI2 * rn2);
         c->m_massNormal = 1.0f / kNormal;
 
-        glm::vec3 tangent;
-        glm::vec3 bitangent;
-        ComputeBasis(c->m_normal, tangent, bitangent);
+        ComputeBasis(c->m_normal, c->m_tangent, c->m_bitangent);
 
-        glm::vec3 rt1 = glm::cross(r1, tangent);
-        glm::vec3 rt2 = glm::cross(r2, tangent);
-        float kTangent = m_body1->m_invMass + m_body2->m_invMass;
-        kTangent += glm::dot(rt1, m_body1->m_invI * rt1);
-        kTangent += glm::dot(rt2, m_body2->m_invI * rt2);
+        glm::vec3 rt1 = glm::cross(r1, c->m_tangent);
+        glm::vec3 rt2 = glm::cross(r2, c->m_tangent);
+        float kTangent = invMass1 + invMass2;
+        kTangent += glm::dot(rt1, invI1 * rt1);
+        kTangent += glm::dot(rt2, invI2 * rt2);
         c->m_massTangent = 1.0f / kTangent;
 
-        glm::vec3 rb1 = glm::cross(r1, bitangent);
-        glm::vec3 rb2 = glm::cross(r2, bitangent);
-        float kBitangent = m_body1->m_invMass + m_body2->m_invMass;
-        kBitangent += glm::dot(rb1, m_body1->m_invI * rb1);
-        kBitangent += glm::dot(rb2, m_body2->m_invI * rb2);
+        glm::vec3 rb1 = glm::cross(r1, c->m_bitangent);
+        glm::vec3 rb2 = glm::cross(r2, c->m_bitangent);
+        float kBitangent = invMass1 + invMass2;
+        kBitangent += glm::dot(rb1, invI1 * rb1);
+        kBitangent += glm::dot(rb2, invI2 * rb2);
         c->m_massBitangent = 1.0f / kBitangent;
 
-        constexpr float k_biasFactor = 0.1f;
-        constexpr float k_allowedPenetration = 0.01f;
-        c->m_bias = -k_biasFactor * invElapsedTime * glm::min(0.0f, c->m_separation + k_allowedPenetration);
-
-        glm::vec3 dv = m_body2->m_velocity + glm::cross(m_body2->m_angularVelocity, r2) - m_body1->m_velocity - glm::cross(m_body1->m_angularVelocity, r1);
+        glm::vec3 dv = v2 + glm::cross(w2, r2) - v1 - glm::cross(w1, r1);
         float vn = glm::dot(dv, c->m_normal);
-        if (vn < -velocityThreshold)
+        c->m_relativeVelocity = vn;
+        c->m_adjustedSeparation = c->m_separation - glm::dot(r2 - r1, c->m_normal);
+        c->m_positionBias = 0.0f;
+        if (!useSplitImpulse)
         {
-            c->m_bias -= m_restitution * vn;
+            c->m_Pp = 0.0f;
         }
 
-        glm::vec3 P = (c->m_Pn * c->m_normal) + (c->m_Pt * tangent) + (c->m_Pb * bitangent);
+        if (c->m_separation > 0.0f)
+        {
+            // Speculative contact: the bodies may close the gap during this
+            // step but not go any further.
+            c->m_bias = -c->m_separation * invElapsedTime;
+        }
+        else
+        {
+            constexpr float k_biasFactor = 0.1f;
+            constexpr float k_splitBiasFactor = 0.2f;
+            constexpr float k_allowedPenetration = 0.01f;
+            const float penetration = glm::min(0.0f, c->m_separation + k_allowedPenetration);
+            if (useSplitImpulse)
+            {
+                c->m_bias = 0.0f;
+                c->m_positionBias = -k_splitBiasFactor * invElapsedTime * penetration;
+            }
+            else
+            {
+                c->m_bias = -k_biasFactor * invElapsedTime * penetration;
+            }
 
-        m_body1->m_velocity -= m_body1->m_invMass * P;
-        m_body1->m_angularVelocity -= m_body1->m_invI * glm::cross(r1, P);
+            if (vn < -g_velocityThreshold)
+            {
+                c->m_bias -= m_restitution * vn;
+            }
+        }
+    }
 
-        m_body2->m_velocity += m_body2->m_invMass * P;
-        m_body2->m_angularVelocity += m_body2->m_invI * glm::cross(r2, P);
+    m_useBlockSolver = useBlockSolver && (m_contactCount > 1);
+    if (m_useBlockSolver)
+    {
+        for (size_t i = 0; i < m_contactCount; ++i)
+        {
+            const Contact* ci = m_contacts + i;
+            glm::vec3 rn1i = glm::cross(ci->m_r1, ci->m_normal);
+            glm::vec3 rn2i = glm::cross(ci->m_r2, ci->m_normal);
+            for (size_t j = i; j < m_contactCount; ++j)
+            {
+                const Contact* cj = m_contacts + j;
+                glm::vec3 rn1j = glm::cross(cj->m_r1, cj->m_normal);
+                glm::vec3 rn2j = glm::cross(cj->m_r2, cj->m_normal);
+                float k = (invMass1 + invMass2) * glm::dot(ci->m_normal, cj->m_normal);
+                k += glm::dot(rn1i, invI1 * rn1j);
+                k += glm::dot(rn2i, invI2 * rn2j);
+                m_normalCoupling[i][j] = k;
+                m_normalCoupling[j][i] = k;
+            }
+        }
     }
 }
 
-void Arbiter::ApplyImpulse()
+void Arbiter::WarmStart(SolverBodies& bodies) const
 {
     if (m_isTrigger)
     {
         return;
     }
 
+    glm::vec3 v1 = bodies.m_velocities[m_index1];
+    glm::vec3 w1 = bodies.m_angularVelocities[m_index1];
+    glm::vec3 v2 = bodies.m_velocities[m_index2];
+    glm::vec3 w2 = bodies.m_angularVelocities[m_index2];
+    const float invMass1 = bodies.m_invMasses[m_index1];
+    const float invMass2 = bodies.m_invMasses[m_index2];
+    const glm::mat3& invI1 = bodies.m_invIs[m_index1];
+    const glm::mat3& invI2 = bodies.m_invIs[m_index2];
+
+    for (size_t i = 0; i < m_contactCount; ++i)
+    {
+        const Contact* c = m_contacts + i;
+        glm::vec3 P = (c->m_Pn * c->m_normal) + (c->m_Pt * c->m_tangent) + (c->m_Pb * c->m_bitangent);
+
+        v1 -= invMass1 * P;
+        w1 -= invI1 * glm::cross(c->m_r1, P);
+
+        v2 += invMass2 * P;
+        w2 += invI2 * glm::cross(c->m_r2, P);
+    }
+
+    bodies.SetVelocity(m_index1, v1, w1);
+    bodies.SetVelocity(m_index2, v2, w2);
+}
+
+void Arbiter::WarmStartPseudoImpulse(SolverBodies& bodies) const
+{
+    if (m_isTrigger)
+    {
+        return;
+    }
+
+    glm::vec3 v1 = bodies.m_pseudoVelocities[m_index1];
+    glm::vec3 w1 = bodies.m_pseudoAngularVelocities[m_index1];
+    glm::vec3 v2 = bodies.m_pseudoVelocities[m_index2];
+    glm::vec3 w2 = bodies.m_pseudoAngularVelocities[m_index2];
+    const float invMass1 = bodies.m_invMasses[m_index1];
+    const float invMass2 = bodies.m_invMasses[m_index2];
+    const glm::mat3& invI1 = bodies.m_invIs[m_index1];
+    const glm::mat3& invI2 = bodies.m_invIs[m_index2];
+
+    for (size_t i = 0; i < m_contactCount; ++i)
+    {
+        const Contact* c = m_contacts + i;
+        glm::vec3 Pp = c->m_Pp * c->m_normal;
+
+        v1 -= invMass1 * Pp;
+        w1 -= invI1 * glm::cross(c->m_r1, Pp);
+
+        v2 += invMass2 * Pp;
+        w2 += invI2 * glm::cross(c->m_r2, Pp);
+    }
+
+    bodies.SetPseudoVelocity(m_index1, v1, w1);
+    bodies.SetPseudoVelocity(m_index2, v2, w2);
+}
+
+float Arbiter::ApplyPseudoImpulse(SolverBodies& bodies)
+{
+    if (m_isTrigger)
+    {
+        return 0.0f;
+    }
+
+    glm::vec3 v1 = bodies.m_pseudoVelocities[m_index1];
+    glm::vec3 w1 = bodies.m_pseudoAngularVelocities[m_index1];
+    glm::vec3 v2 = bodies.m_pseudoVelocities[m_index2];
+    glm::vec3 w2 = bodies.m_pseudoAngularVelocities[m_index2];
+    const float invMass1 = bodies.m_invMasses[m_index1];
+    const float invMass2 = bodies.m_invMasses[m_index2];
+    const glm::mat3& invI1 = bodies.m_invIs[m_index1];
+    const glm::mat3& invI2 = bodies.m_invIs[m_index2];
+    float residual = 0.0f;
+
     for (size_t i = 0; i < m_contactCount; ++i)
     {
         Contact* c = m_contacts + i;
 
-        c->m_r1 = c->m_position - m_body1->m_position;
-        c->m_r2 = c->m_position - m_body2->m_position;
+        glm::vec3 dv = v2 + glm::cross(w2, c->m_r2) - v1 - glm::cross(w1, c->m_r1);
+        float vn = glm::dot(dv, c->m_normal);
+        float dPp = c->m_massNormal * (-vn + c->m_positionBias);
+
+        float Pp0 = c->m_Pp;
+        c->m_Pp = glm::max(Pp0 + dPp, 0.0f);
+        dPp = c->m_Pp - Pp0;
+        residual = glm::max(residual, std::abs(dPp));
+
+        glm::vec3 Pp = dPp * c->m_normal;
+
+        v1 -= invMass1 * Pp;
+        w1 -= invI1 * glm::cross(c->m_r1, Pp);
+
+        v2 += invMass2 * Pp;
+        w2 += invI2 * glm::cross(c->m_r2, Pp);
+    }
+
+    bodies.SetPseudoVelocity(m_index1, v1, w1);
+    bodies.SetPseudoVelocity(m_index2, v2, w2);
+
+    return residual;
+}
+
+float Arbiter::ApplyFriction(Contact* c, float massTangent, float massBitangent, float invMass1, float invMass2, const glm::mat3& invI1, const glm::mat3& invI2, glm::vec3& v1, glm::vec3& w1, glm::vec3& v2, glm::vec3& w2) const
+{
+    // Relative velocity at contact.
+    glm::vec3 dv = v2 + glm::cross(w2, c->m_r2) - v1 - glm::cross(w1, c->m_r1);
+
+    float vt = glm::dot(dv, c->m_tangent);
+    float dPt = massTangent * (-vt);
+
+    float effectiveFriction = (std::abs(vt) < g_velocityThreshold) ? m_staticFriction : m_dynamicFriction;
+
+    // Compute friction impulse.
+    float maxPt = effectiveFriction * c->m_Pn;
+
+    // Clamp friction.
+    float oldTangentImpulse = c->m_Pt;
+    c->m_Pt = glm::clamp(oldTangentImpulse + dPt, -maxPt, maxPt);
+    dPt = c->m_Pt - oldTangentImpulse;
 
-        // Relative velocity at contact.
-        glm::vec3 dv = m_body2->m_velocity + glm::cross(m_body2->m_angularVelocity, c->m_r2) - m_body1->m_velocity - glm::cross(m_body1->m_angularVelocity, c->m_r1);
+    // Apply contact impulse.
+    glm::vec3 Pt = dPt * c->m_tangent;
 
-        // Compute normal impulse.
+    v1 -= invMass1 * Pt;
+    w1 -= invI1 * glm::cross(c->m_r1, Pt);
+
+    v2 += invMass2 * Pt;
+    w2 += invI2 * glm::cross(c->m_r2, Pt);
+
+    // Relative velocity at contact.
+    dv = v2 + glm::cross(w2, c->m_r2) - v1 - glm::cross(w1, c->m_r1);
+
+    float vb = glm::dot(dv, c->m_bitangent);
+    float dPb = massBitangent * (-vb);
+
+    effectiveFriction = (std::abs(vb) < g_velocityThreshold) ? m_staticFriction : m_dynamicFriction;
+
+    // Compute friction impulse.
+    float maxPb = effectiveFriction * c->m_Pn;
+
+    // Clamp friction.
+    float oldBitangentImpulse = c->m_Pb;
+    c->m_Pb = glm::clamp(oldBitangentImpulse + dPb, -maxPb, maxPb);
+    dPb = c->m_Pb - oldBitangentImpulse;
+
+    // Apply contact impulse.
+    glm::vec3 Pb = dPb * c->m_bitangent;
+
+    v1 -= invMass1 * Pb;
+    w1 -= invI1 * glm::cross(c->m_r1, Pb);
+
+    v2 += invMass2 * Pb;
+    w2 += invI2 * glm::cross(c->m_r2, Pb);
+
+    return glm::max(std::abs(dPt), std::abs(dPb));
+}
+
+bool SolveContactLCP(const float k[g_maxContactPoints][g_maxContactPoints], const float* b, size_t count, float* x)
+{
+    // Finds x >= 0 with w = k x + b >= 0 and x[i] w[i] = 0 by trying every
+    // set of active contacts, the largest sets first. Sets whose matrix is
+    // close to singular, such as all four corners of a box face, are
+    // skipped.
+    constexpr float k_minPivot = 1.0e-3f;
+    const uint32_t setCount = 1u << count;
+
+    for (size_t activeCount = count + 1; activeCount-- > 0;)
+    {
+        for (uint32_t set = 0; set < setCount; ++set)
+        {
+            size_t active[g_maxContactPoints];
+            size_t n = 0;
+            for (size_t i = 0; i < count; ++i)
+            {
+                if (set & (1u << i))
+                {
+                    active[n++] = i;
+                }
+            }
+
+            if (n != activeCount)
+            {
+                continue;
+            }
+
+            // Solve the active rows by Gaussian elimination with partial
+            // pivoting.
+            float a[g_maxContactPoints][g_maxContactPoints + 1];
+            for (size_t i = 0; i < n; ++i)
+            {
+                for (size_t j = 0; j < n; ++j)
+                {
+                    a[i][j] = k[active[i]][active[j]];
+                }
+                a[i][n] = -b[active[i]];
+            }
+
+            bool singular = false;
+            for (size_t i = 0; i < n; ++i)
+            {
+                size_t pivot = i;
+                for (size_t j = i + 1; j < n; ++j)
+                {
+                    if (std::abs(a[j][i]) > std::abs(a[pivot][i]))
+                    {
+                        pivot = j;
+                    }
+                }
+
+                if (std::abs(a[pivot][i]) < k_minPivot * k[active[i]][active[i]])
+                {
+                    singular = true;
+                    break;
+                }
+
+                if (pivot != i)
+                {
+                    for (size_t j = i; j <= n; ++j)
+                    {
+                        std::swap(a[i][j], a[pivot][j]);
+                    }
+                }
+
+                for (size_t j = i + 1; j < n; ++j)
+                {
+                    const float f = a[j][i] / a[i][i];
+                    for (size_t l = i; l <= n; ++l)
+                    {
+                        a[j][l] -= f * a[i][l];
+                    }
+                }
+            }
+
+            if (singular)
+            {
+                continue;
+            }
+
+            float y[g_maxContactPoints] = {};
+            for (size_t i = n; i-- > 0;)
+            {
+                float sum = a[i][n];
+                for (size_t j = i + 1; j < n; ++j)
+                {
+                    sum -= a[i][j] * y[active[j]];
+                }
+                y[active[i]] = sum / a[i][i];
+            }
+
+            bool valid = true;
+            for (size_t i = 0; (i < count) && valid; ++i)
+            {
+                if (set & (1u << i))
+                {
+                    valid = (y[i] >= 0.0f);
+                }
+                else
+                {
+                    float w = b[i];
+                    for (size_t j = 0; j < count; ++j)
+                    {
+                        w += k[i][j] * y[j];
+                    }
+                    valid = (w >= 0.0f);
+                }
+            }
+
+            if (valid)
+            {
+                for (size_t i = 0; i < count; ++i)
+                {
+                    x[i] = y[i];
+                }
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+bool Arbiter::ApplyNormalBlock(float invMass1, float invMass2, const glm::mat3& invI1, const glm::mat3& invI2, glm::vec3& v1, glm::vec3& w1, glm::vec3& v2, glm::vec3& w2, float& residual)
+{
+    // Solve for the total impulses, so that w = k (x - Pn) + vn - bias.
+    float b[g_maxContactPoints];
+    for (size_t i = 0; i < m_contactCount; ++i)
+    {
+        const Contact* c = m_contacts + i;
+        glm::vec3 dv = v2 + glm::cross(w2, c->m_r2) - v1 - glm::cross(w1, c->m_r1);
+        b[i] = glm::dot(dv, c->m_normal) - c->m_bias;
+    }
+
+    for (size_t i = 0; i < m_contactCount; ++i)
+    {
+        for (size_t j = 0; j < m_contactCount; ++j)
+        {
+            b[i] -= m_normalCoupling[i][j] * m_contacts[j].m_Pn;
+        }
+    }
+
+    float x[g_maxContactPoints];
+    if (!SolveContactLCP(m_normalCoupling, b, m_contactCount, x))
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < m_contactCount; ++i)
+    {
+        Contact* c = m_contacts + i;
+        glm::vec3 Pn = (x[i] - c->m_Pn) * c->m_normal;
+        residual = glm::max(residual, std::abs(x[i] - c->m_Pn));
+        c->m_Pn = x[i];
+
+        v1 -= invMass1 * Pn;
+        w1 -= invI1 * glm::cross(c->m_r1, Pn);
+
+        v2 += invMass2 * Pn;
+        w2 += invI2 * glm::cross(c->m_r2, Pn);
+    }
+
+    return true;
+}
+
+float Arbiter::ApplyImpulse(SolverBodies& bodies)
+{
+    if (m_isTrigger)
+    {
+        return 0.0f;
+    }
+
+    glm::vec3 v1 = bodies.m_velocities[m_index1];
+    glm::vec3 w1 = bodies.m_angularVelocities[m_index1];
+    glm::vec3 v2 = bodies.m_velocities[m_index2];
+    glm::vec3 w2 = bodies.m_angularVelocities[m_index2];
+    const float invMass1 = bodies.m_invMasses[m_index1];
+    const float invMass2 = bodies.m_invMasses[m_index2];
+    const glm::mat3& invI1 = bodies.m_invIs[m_index1];
+    const glm::mat3& invI2 = bodies.m_invIs[m_index2];
+
+    // Falls back to one contact at a time if the block has no solution.
+    float residual = 0.0f;
+    const bool blockSolved = m_useBlockSolver && ApplyNormalBlock(invMass1, invMass2, invI1, invI2, v1, w1, v2, w2, residual);
+
+    for (size_t i = 0; i < m_contactCount; ++i)
+    {
+        Contact* c = m_contacts + i;
+
+        if (!blockSolved)
+        {
+            // Relative velocity at contact.
+            glm::vec3 dv = v2 + glm::cross(w2, c->m_r2) - v1 - glm::cross(w1, c->m_r1);
+
+            // Compute normal impulse.
+            float vn = glm::dot(dv, c->m_normal);
+            float dPn = c->m_massNormal * (-vn + c->m_bias);
+
+            // Clamp the accumulated impulse.
+            float Pn0 = c->m_Pn;
+            c->m_Pn = glm::max(Pn0 + dPn, 0.0f);
+            dPn = c->m_Pn - Pn0;
+            residual = glm::max(residual, std::abs(dPn));
+
+            // Apply contact impulse.
+            glm::vec3 Pn = dPn * c->m_normal;
+
+            v1 -= invMass1 * Pn;
+            w1 -= invI1 * glm::cross(c->m_r1, Pn);
+
+            v2 += invMass2 * Pn;
+            w2 += invI2 * glm::cross(c->m_r2, Pn);
+        }
+
+        residual = glm::max(residual, ApplyFriction(c, c->m_massTangent, c->m_massBitangent, invMass1, invMass2, invI1, invI2, v1, w1, v2, w2));
+    }
+
+    bodies.SetVelocity(m_index1, v1, w1);
+    bodies.SetVelocity(m_index2, v2, w2);
+
+    return residual;
+}
+
+float Arbiter::ApplyImpulseMassSplit(const SolverBodies& bodies, float share1, float share2, glm::vec3* velocityDeltas)
+{
+    // Each constraint of a body acts on its own copy of the body, which
+    // has 1/share of its mass. The caller averages the copies afterwards,
+    // which adds up to applying the impulses to the real body.
+    const glm::vec3 v10 = bodies.m_velocities[m_index1];
+    const glm::vec3 w10 = bodies.m_angularVelocities[m_index1];
+    const glm::vec3 v20 = bodies.m_velocities[m_index2];
+    const glm::vec3 w20 = bodies.m_angularVelocities[m_index2];
+    glm::vec3 v1 = v10;
+    glm::vec3 w1 = w10;
+    glm::vec3 v2 = v20;
+    glm::vec3 w2 = w20;
+    const float invMass1 = share1 * bodies.m_invMasses[m_index1];
+    const float invMass2 = share2 * bodies.m_invMasses[m_index2];
+    const glm::mat3 invI1 = share1 * bodies.m_invIs[m_index1];
+    const glm::mat3 invI2 = share2 * bodies.m_invIs[m_index2];
+    float residual = 0.0f;
+
+    for (size_t i = 0; i < m_contactCount; ++i)
+    {
+        Contact* c = m_contacts + i;
+
+        glm::vec3 rn1 = glm::cross(c->m_r1, c->m_normal);
+        glm::vec3 rn2 = glm::cross(c->m_r2, c->m_normal);
+        float massNormal = 1.0f / (invMass1 + invMass2 + glm::dot(rn1, invI1 * rn1) + glm::dot(rn2, invI2 * rn2));
+
+        glm::vec3 rt1 = glm::cross(c->m_r1, c->m_tangent);
+        glm::vec3 rt2 = glm::cross(c->m_r2, c->m_tangent);
+        float massTangent = 1.0f / (invMass1 + invMass2 + glm::dot(rt1, invI1 * rt1) + glm::dot(rt2, invI2 * rt2));
+
+        glm::vec3 rb1 = glm::cross(c->m_r1, c->m_bitangent);
+        glm::vec3 rb2 = glm::cross(c->m_r2, c->m_bitangent);
+        float massBitangent = 1.0f / (invMass1 + invMass2 + glm::dot(rb1, invI1 * rb1) + glm::dot(rb2, invI2 * rb2));
+
+        glm::vec3 dv = v2 + glm::cross(w2, c->m_r2) - v1 - glm::cross(w1, c->m_r1);
         float vn = glm::dot(dv, c->m_normal);
-        float dPn = c->m_massNormal * (-vn + c->m_bias);
+        float dPn = massNormal * (-vn + c->m_bias);
 
-        // Clamp the accumulated impulse.
         float Pn0 = c->m_Pn;
         c->m_Pn = glm::max(Pn0 + dPn, 0.0f);
         dPn = c->m_Pn - Pn0;
+        residual = glm::max(residual, std::abs(dPn));
 
-        // Apply contact impulse.
         glm::vec3 Pn = dPn * c->m_normal;
 
-        m_body1->m_velocity -= m_body1->m_invMass * Pn;
-        m_body1->m_angularVelocity -= m_body1->m_invI * glm::cross(c->m_r1, Pn);
+        v1 -= invMass1 * Pn;
+        w1 -= invI1 * glm::cross(c->m_r1, Pn);
 
-        m_body2->m_velocity += m_body2->m_invMass * Pn;
-        m_body2->m_angularVelocity += m_body2->m_invI * glm::cross(c->m_r2, Pn);
+        v2 += invMass2 * Pn;
+        w2 += invI2 * glm::cross(c->m_r2, Pn);
 
-        glm::vec3 tangent;
-        glm::vec3 bitangent;
-        ComputeBasis(c->m_normal, tangent, bitangent);
+        residual = glm::max(residual, ApplyFriction(c, massTangent, massBitangent, invMass1, invMass2, invI1, invI2, v1, w1, v2, w2));
+    }
 
-        // Relative velocity at contact.
-        dv = m_body2->m_velocity + glm::cross(m_body2->m_angularVelocity, c->m_r2) - m_body1->m_velocity - glm::cross(m_body1->m_angularVelocity, c->m_r1);
+    velocityDeltas[0] = (v1 - v10) / share1;
+    velocityDeltas[1] = (w1 - w10) / share1;
+    velocityDeltas[2] = (v2 - v20) / share2;
+    velocityDeltas[3] = (w2 - w20) / share2;
 
-        float vt = glm::dot(dv, tangent);
-        float dPt = c->m_massTangent * (-vt);
+    return residual;
+}
 
-        float effectiveFriction = (std::abs(vt) < velocityThreshold) ? m_staticFriction : m_dynamicFriction;
+float Arbiter::SolveSoft(SolverBodies& bodies, const Softness& softness, float invSubStep, float maxPushVelocity, bool useBias)
+{
+    if (m_isTrigger)
+    {
+        return 0.0f;
+    }
 
-        // Compute friction impulse.
-        float maxPt = effectiveFriction * c->m_Pn;
+    glm::vec3 v1 = bodies.m_velocities[m_index1];
+    glm::vec3 w1 = bodies.m_angularVelocities[m_index1];
+    glm::vec3 v2 = bodies.m_velocities[m_index2];
+    glm::vec3 w2 = bodies.m_angularVelocities[m_index2];
+    const float invMass1 = bodies.m_invMasses[m_index1];
+    const float invMass2 = bodies.m_invMasses[m_index2];
+    const glm::mat3& invI1 = bodies.m_invIs[m_index1];
+    const glm::mat3& invI2 = bodies.m_invIs[m_index2];
+    const glm::vec3 dp = bodies.m_deltaPositions[m_index2] - bodies.m_deltaPositions[m_index1];
+    const glm::quat& q1 = bodies.m_deltaRotations[m_index1];
+    const glm::quat& q2 = bodies.m_deltaRotations[m_index2];
+    float residual = 0.0f;
 
-        // Clamp friction.
-        float oldTangentImpulse = c->m_Pt;
-        c->m_Pt = glm::clamp(oldTangentImpulse + dPt, -maxPt, maxPt);
-        dPt = c->m_Pt - oldTangentImpulse;
+    for (size_t i = 0; i < m_contactCount; ++i)
+    {
+        Contact* c = m_contacts + i;
 
-        // Apply contact impulse.
-        glm::vec3 Pt = dPt * tangent;
+        // Current separation from the motion of the bodies since the
+        // contact was found.
+        const glm::vec3 d = dp + (q2 * c->m_r2) - (q1 * c->m_r1);
+        const float separation = glm::dot(d, c->m_normal) + c->m_adjustedSeparation;
 
-        m_body1->m_velocity -= m_body1->m_invMass * Pt;
-        m_body1->m_angularVelocity -= m_body1->m_invI * glm::cross(c->m_r1, Pt);
+        float bias = 0.0f;
+        float massScale = 1.0f;
+        float impulseScale = 0.0f;
+        if (separation > 0.0f)
+        {
+            // Speculative: close the gap but no further.
+            bias = separation * invSubStep;
+        }
+        else if (useBias)
+        {
+            bias = glm::max(softness.m_biasRate * separation, -maxPushVelocity);
+            massScale = softness.m_massScale;
+            impulseScale = softness.m_impulseScale;
+        }
 
-        m_body2->m_velocity += m_body2->m_invMass * Pt;
-        m_body2->m_angularVelocity += m_body2->m_invI * glm::cross(c->m_r2, Pt);
+        glm::vec3 dv = v2 + glm::cross(w2, c->m_r2) - v1 - glm::cross(w1, c->m_r1);
+        float vn = glm::dot(dv, c->m_normal);
+        float dPn = -c->m_massNormal * massScale * (vn + bias) - impulseScale * c->m_Pn;
 
-        // Relative velocity at contact.
-        dv = m_body2->m_velocity + glm::cross(m_body2->m_angularVelocity, c->m_r2) - m_body1->m_velocity - glm::cross(m_body1->m_angularVelocity, c->m_r1);
+        float Pn0 = c->m_Pn;
+        c->m_Pn = glm::max(Pn0 + dPn, 0.0f);
+        dPn = c->m_Pn - Pn0;
+        residual = glm::max(residual, std::abs(dPn));
+
+        glm::vec3 Pn = dPn * c->m_normal;
+
+        v1 -= invMass1 * Pn;
+        w1 -= invI1 * glm::cross(c->m_r1, Pn);
+
+        v2 += invMass2 * Pn;
+        w2 += invI2 * glm::cross(c->m_r2, Pn);
+
+        residual = glm::max(residual, ApplyFriction(c, c->m_massTangent, c->m_massBitangent, invMass1, invMass2, invI1, invI2, v1, w1, v2, w2));
+    }
 
-        float vb = glm::dot(dv, bitangent);
-        float dPb = c->m_massBitangent * (-vb);
+    bodies.SetVelocity(m_index1, v1, w1);
+    bodies.SetVelocity(m_index2, v2, w2);
 
-        effectiveFriction = (std::abs(vb) < velocityThreshold) ? m_staticFriction : m_dynamicFriction;
+    return residual;
+}
 
-        // Compute friction impulse.
-        float maxPb = effectiveFriction * c->m_Pn;
+void Arbiter::BuildRows(const SolverBodies& bodies, ConstraintRow* rows) const
+{
+    for (size_t i = 0; i < m_contactCount; ++i)
+    {
+        const Contact* c = m_contacts + i;
+        ConstraintRow* row = rows + 3 * i;
 
-        // Clamp friction.
-        float oldBitangentImpulse = c->m_Pb;
-        c->m_Pb = glm::clamp(oldBitangentImpulse + dPb, -maxPb, maxPb);
-        dPb = c->m_Pb - oldBitangentImpulse;
+        InitRow(row[0], bodies, m_index1, m_index2, c->m_normal, -glm::cross(c->m_r1, c->m_normal), glm::cross(c->m_r2, c->m_normal), c->m_bias, 0.0f, c->m_Pn);
+        row[0].m_lower = 0.0f;
 
-        // Apply contact impulse.
-        glm::vec3 Pb = dPb * bitangent;
+        InitRow(row[1], bodies, m_index1, m_index2, c->m_tangent, -glm::cross(c->m_r1, c->m_tangent), glm::cross(c->m_r2, c->m_tangent), 0.0f, 0.0f, c->m_Pt);
+        row[1].m_normalOffset = 1;
 
-        m_body1->m_velocity -= m_body1->m_invMass * Pb;
-        m_body1->m_angularVelocity -= m_body1->m_invI * glm::cross(c->m_r1, Pb);
+        InitRow(row[2], bodies, m_index1, m_index2, c->m_bitangent, -glm::cross(c->m_r1, c->m_bitangent), glm::cross(c->m_r2, c->m_bitangent), 0.0f, 0.0f, c->m_Pb);
+        row[2].m_normalOffset = 2;
 
-        m_body2->m_velocity += m_body2->m_invMass * Pb;
-        m_body2->m_angularVelocity += m_body2->m_invI * glm::cross(c->m_r2, Pb);
+        for (int j = 1; j < 3; ++j)
+        {
+            row[j].m_staticFriction = m_staticFriction;
+            row[j].m_dynamicFriction = m_dynamicFriction;
+        }
     }
+}
+
+void Arbiter::StoreRows(const ConstraintRow* rows)
+{
+    for (size_t i = 0; i < m_contactCount; ++i)
+    {
+        Contact* c = m_contacts + i;
+        c->m_Pn = rows[3 * i].m_impulse;
+        c->m_Pt = rows[3 * i + 1].m_impulse;
+        c->m_Pb = rows[3 * i + 2].m_impulse;
+    }
+}
+
+void Arbiter::ApplyRestitution(SolverBodies& bodies)
+{
+    if (m_isTrigger || (m_restitution == 0.0f))
+    {
+        return;
+    }
+
+    glm::vec3 v1 = bodies.m_velocities[m_index1];
+    glm::vec3 w1 = bodies.m_angularVelocities[m_index1];
+    glm::vec3 v2 = bodies.m_velocities[m_index2];
+    glm::vec3 w2 = bodies.m_angularVelocities[m_index2];
+    const float invMass1 = bodies.m_invMasses[m_index1];
+    const float invMass2 = bodies.m_invMasses[m_index2];
+    const glm::mat3& invI1 = bodies.m_invIs[m_index1];
+    const glm::mat3& invI2 = bodies.m_invIs[m_index2];
+
+    for (size_t i = 0; i < m_contactCount; ++i)
+    {
+        Contact* c = m_contacts + i;
+
+        if ((c->m_relativeVelocity > -g_velocityThreshold) || (c->m_Pn == 0.0f))
+        {
+            continue;
+        }
+
+        glm::vec3 dv = v2 + glm::cross(w2, c->m_r2) - v1 - glm::cross(w1, c->m_r1);
+        float vn = glm::dot(dv, c->m_normal);
+        float dPn = -c->m_massNormal * (vn + m_restitution * c->m_relativeVelocity);
+
+        float Pn0 = c->m_Pn;
+        c->m_Pn = glm::max(Pn0 + dPn, 0.0f);
+        dPn = c->m_Pn - Pn0;
+
+        glm::vec3 Pn = dPn * c->m_normal;
+
+        v1 -= invMass1 * Pn;
+        w1 -= invI1 * glm::cross(c->m_r1, Pn);
+
+        v2 += invMass2 * Pn;
+        w2 += invI2 * glm::cross(c->m_r2, Pn);
+    }
+
+    bodies.SetVelocity(m_index1, v1, w1);
+    bodies.SetVelocity(m_index2, v2, w2);
 }
\ No newline at end of file
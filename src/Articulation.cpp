@@ -0,0 +1,355 @@
+#include "Articulation.h"
+#include "Body.h"
+
+glm::mat3 Skew(const glm::vec3& v)
+{
+    // Skew(v) * x == cross(v, x).
+    return glm::mat3(
+        0.0f, v.z, -v.y,
+        -v.z, 0.0f, v.x,
+        v.y, -v.x, 0.0f
+    );
+}
+
+SpatialVector operator+(const SpatialVector& a, const SpatialVector& b)
+{
+    return {a.m_angular + b.m_angular, a.m_linear + b.m_linear};
+}
+
+SpatialVector operator*(const SpatialMatrix& m, const SpatialVector& v)
+{
+    return {m.m_a * v.m_angular + m.m_b * v.m_linear, m.m_c * v.m_angular + m.m_d * v.m_linear};
+}
+
+SpatialVector SolveSpatial(const SpatialMatrix& m, const SpatialVector& v)
+{
+    // Block elimination through the Schur complement of the mass block.
+    const glm::mat3 invD = glm::inverse(m.m_d);
+    const glm::vec3 angular = glm::inverse(m.m_a - m.m_b * invD * m.m_c) * (v.m_angular - m.m_b * (invD * v.m_linear));
+    return {angular, invD * (v.m_linear - m.m_c * angular)};
+}
+
+Articulation::Articulation()
+: m_velocitySubSteps(4)
+, m_jointDamping(0.05f)
+, m_maxJointVelocity(100.0f)
+, m_timeStep(0.0f)
+, m_isPinned(false)
+, m_pinAnchor(0.0f, 0.0f, 0.0f)
+{
+}
+
+uint32_t Articulation::AddLink(Body* body, uint32_t parent, const glm::vec3& anchor)
+{
+    assert((parent == g_invalidLink) == m_links.empty());
+    assert((parent == g_invalidLink) || (parent < m_links.size()));
+
+    ArticulationLink link = {};
+    link.m_body = body;
+    link.m_parent = parent;
+    link.m_childAnchor = glm::conjugate(body->m_state->m_rotation) * (anchor - body->m_state->m_position);
+    if (parent != g_invalidLink)
+    {
+        const Body* parentBody = m_links[parent].m_body;
+        link.m_parentAnchor = glm::conjugate(parentBody->m_state->m_rotation) * (anchor - parentBody->m_state->m_position);
+    }
+
+    body->m_articulation = this;
+    body->m_linkIndex = static_cast<uint32_t>(m_links.size());
+    m_links.push_back(link);
+    return body->m_linkIndex;
+}
+
+void Articulation::PinRoot(const glm::vec3& anchor)
+{
+    ArticulationLink& root = m_links[0];
+    root.m_childAnchor = glm::conjugate(root.m_body->m_state->m_rotation) * (anchor - root.m_body->m_state->m_position);
+    m_isPinned = true;
+    m_pinAnchor = anchor;
+}
+
+void Articulation::PreStep(float elapsedTime)
+{
+    // The joint velocities are read back from the bodies so that velocity
+    // changes made between steps carry over.
+    for (size_t i = 0; i < m_links.size(); ++i)
+    {
+        ArticulationLink& link = m_links[i];
+        link.m_jointVelocity = link.m_body->m_state->m_angularVelocity;
+        if (link.m_parent != g_invalidLink)
+        {
+            link.m_jointVelocity -= m_links[link.m_parent].m_body->m_state->m_angularVelocity;
+        }
+    }
+    UpdateVelocities();
+    ComputeInertias();
+    m_timeStep = elapsedTime;
+
+    for (size_t i = 0; i < m_links.size(); ++i)
+    {
+        ArticulationLink& link = m_links[i];
+        link.m_savedVelocity = link.m_body->m_state->m_velocity;
+        link.m_savedAngularVelocity = link.m_body->m_state->m_angularVelocity;
+    }
+}
+
+void Articulation::ApplyImpulses()
+{
+    for (size_t i = 0; i < m_links.size(); ++i)
+    {
+        ArticulationLink& link = m_links[i];
+        const Body* b = link.m_body;
+
+        // The impulses the solver applied to the link as a free body, about
+        // the world origin.
+        const glm::vec3 impulse = b->m_mass * (b->m_state->m_velocity - link.m_savedVelocity);
+        const glm::vec3 angularImpulse = glm::inverse(RotateDiagonal(b->m_state->m_rotation, b->m_state->m_invI)) * (b->m_state->m_angularVelocity - link.m_savedAngularVelocity);
+        link.m_force.m_angular = -(angularImpulse + glm::cross(b->m_state->m_position, impulse));
+        link.m_force.m_linear = -impulse;
+    }
+
+    ComputeAccelerations(true);
+
+    for (size_t i = 0; i < m_links.size(); ++i)
+    {
+        ArticulationLink& link = m_links[i];
+        if ((link.m_parent == g_invalidLink) && !m_isPinned)
+        {
+            Body* b = link.m_body;
+            const glm::vec3 angularVelocity = link.m_acceleration.m_angular;
+            b->m_state->m_velocity = link.m_savedVelocity + link.m_acceleration.m_linear + glm::cross(angularVelocity, b->m_state->m_position);
+            b->m_state->m_angularVelocity = link.m_savedAngularVelocity + angularVelocity;
+        }
+        else
+        {
+            link.m_jointVelocity += link.m_jointAcceleration;
+        }
+    }
+    UpdateVelocities();
+
+    // Velocity-dependent forces. They grow with the square of the joint
+    // velocities, so fast chains gain energy unless these are integrated in
+    // smaller steps.
+    const float timeStep = m_timeStep / static_cast<float>(m_velocitySubSteps);
+    for (uint32_t i = 0; i < m_velocitySubSteps; ++i)
+    {
+        ComputeVelocityForces();
+        ComputeAccelerations(false);
+
+        for (size_t j = 0; j < m_links.size(); ++j)
+        {
+            ArticulationLink& link = m_links[j];
+            if ((link.m_parent == g_invalidLink) && !m_isPinned)
+            {
+                Body* b = link.m_body;
+                const glm::vec3 angularAcceleration = link.m_acceleration.m_angular;
+                const glm::vec3 acceleration = link.m_acceleration.m_linear + glm::cross(angularAcceleration, b->m_state->m_position) + glm::cross(b->m_state->m_angularVelocity, b->m_state->m_velocity);
+                b->m_state->m_velocity += timeStep * acceleration;
+                b->m_state->m_angularVelocity += timeStep * angularAcceleration;
+            }
+            else
+            {
+                link.m_jointVelocity += timeStep * link.m_jointAcceleration;
+            }
+        }
+        UpdateVelocities();
+    }
+
+    const float damping = 1.0f / (1.0f + m_timeStep * m_jointDamping);
+    for (size_t i = 0; i < m_links.size(); ++i)
+    {
+        ArticulationLink& link = m_links[i];
+        link.m_jointVelocity *= damping;
+
+        const float speed = glm::length(link.m_jointVelocity);
+        if (speed > m_maxJointVelocity)
+        {
+            link.m_jointVelocity *= m_maxJointVelocity / speed;
+        }
+    }
+    UpdateVelocities();
+}
+
+void Articulation::UpdatePositions()
+{
+    for (size_t i = 0; i < m_links.size(); ++i)
+    {
+        ArticulationLink& link = m_links[i];
+        Body* b = link.m_body;
+
+        if (link.m_parent != g_invalidLink)
+        {
+            const Body* parentBody = m_links[link.m_parent].m_body;
+            b->m_state->m_position = parentBody->m_state->m_position + parentBody->m_state->m_rotation * link.m_parentAnchor - b->m_state->m_rotation * link.m_childAnchor;
+        }
+        else if (m_isPinned)
+        {
+            b->m_state->m_position = m_pinAnchor - b->m_state->m_rotation * link.m_childAnchor;
+        }
+    }
+}
+
+void Articulation::UpdateVelocities()
+{
+    for (size_t i = 0; i < m_links.size(); ++i)
+    {
+        ArticulationLink& link = m_links[i];
+        Body* b = link.m_body;
+
+        if (link.m_parent != g_invalidLink)
+        {
+            const Body* parentBody = m_links[link.m_parent].m_body;
+            const glm::vec3 pivot = parentBody->m_state->m_position + parentBody->m_state->m_rotation * link.m_parentAnchor;
+            const glm::vec3 pivotVelocity = parentBody->m_state->m_velocity + glm::cross(parentBody->m_state->m_angularVelocity, pivot - parentBody->m_state->m_position);
+            b->m_state->m_angularVelocity = parentBody->m_state->m_angularVelocity + link.m_jointVelocity;
+            b->m_state->m_velocity = pivotVelocity + glm::cross(b->m_state->m_angularVelocity, b->m_state->m_position - pivot);
+        }
+        else if (m_isPinned)
+        {
+            b->m_state->m_angularVelocity = link.m_jointVelocity;
+            b->m_state->m_velocity = glm::cross(b->m_state->m_angularVelocity, b->m_state->m_position - m_pinAnchor);
+        }
+    }
+}
+
+void Articulation::ComputeInertias()
+{
+    for (size_t i = 0; i < m_links.size(); ++i)
+    {
+        ArticulationLink& link = m_links[i];
+        const Body* b = link.m_body;
+
+        if (link.m_parent != g_invalidLink)
+        {
+            const Body* parentBody = m_links[link.m_parent].m_body;
+            link.m_pivot = parentBody->m_state->m_position + parentBody->m_state->m_rotation * link.m_parentAnchor;
+        }
+        else
+        {
+            link.m_pivot = m_pinAnchor;
+        }
+
+        // Rigid body inertia about the world origin.
+        const glm::mat3 I = RotateDiagonal(b->m_state->m_rotation, 1.0f / b->m_state->m_invI);
+        const glm::mat3 C = Skew(b->m_state->m_position);
+        link.m_inertia.m_a = I + b->m_mass * C * glm::transpose(C);
+        link.m_inertia.m_b = b->m_mass * C;
+        link.m_inertia.m_c = b->m_mass * glm::transpose(C);
+        link.m_inertia.m_d = glm::mat3(b->m_mass);
+    }
+
+    // Articulated inertias, from the leaves to the root. A ball joint at
+    // pivot p has the motion subspace S = [1; Skew(p)].
+    for (size_t i = m_links.size(); i-- > 0;)
+    {
+        ArticulationLink& link = m_links[i];
+        if ((link.m_parent == g_invalidLink) && !m_isPinned)
+        {
+            continue;
+        }
+
+        const SpatialMatrix& I = link.m_inertia;
+        const glm::mat3 P = Skew(link.m_pivot);
+        link.m_Ut = I.m_a + I.m_b * P;
+        link.m_Ub = I.m_c + I.m_d * P;
+        link.m_invD = glm::inverse(link.m_Ut - P * link.m_Ub);
+
+        if (link.m_parent != g_invalidLink)
+        {
+            SpatialMatrix& parentInertia = m_links[link.m_parent].m_inertia;
+            const glm::mat3 UtInvD = link.m_Ut * link.m_invD;
+            const glm::mat3 UbInvD = link.m_Ub * link.m_invD;
+            parentInertia.m_a += I.m_a - UtInvD * glm::transpose(link.m_Ut);
+            parentInertia.m_b += I.m_b - UtInvD * glm::transpose(link.m_Ub);
+            parentInertia.m_c += I.m_c - UbInvD * glm::transpose(link.m_Ut);
+            parentInertia.m_d += I.m_d - UbInvD * glm::transpose(link.m_Ub);
+        }
+    }
+}
+
+void Articulation::ComputeVelocityForces()
+{
+    for (size_t i = 0; i < m_links.size(); ++i)
+    {
+        ArticulationLink& link = m_links[i];
+        const Body* b = link.m_body;
+
+        link.m_velocity = {b->m_state->m_angularVelocity, b->m_state->m_velocity + glm::cross(b->m_state->m_position, b->m_state->m_angularVelocity)};
+
+        // The velocity product force of the link, without the gyroscopic
+        // torque that free bodies do not get either. Integrated explicitly
+        // it makes thin links spinning about their long axis blow up.
+        const glm::vec3 momentum = b->m_mass * glm::cross(b->m_state->m_angularVelocity, b->m_state->m_velocity);
+        link.m_force.m_angular = glm::cross(b->m_state->m_position, momentum);
+        link.m_force.m_linear = momentum;
+
+        // Acceleration of the joint frame that comes from the parent moving
+        // the pivot.
+        link.m_bias = {glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 0.0f)};
+        if (link.m_parent != g_invalidLink)
+        {
+            const SpatialVector& parentVelocity = m_links[link.m_parent].m_velocity;
+            const glm::vec3 pivotVelocity = parentVelocity.m_linear + glm::cross(parentVelocity.m_angular, link.m_pivot);
+            link.m_bias.m_linear = glm::cross(pivotVelocity, link.m_jointVelocity);
+        }
+    }
+}
+
+void Articulation::ComputeAccelerations(bool isImpulse)
+{
+    // With isImpulse the link forces are impulses and the results are
+    // velocity changes, with no velocity-dependent terms.
+    for (size_t i = m_links.size(); i-- > 0;)
+    {
+        ArticulationLink& link = m_links[i];
+        if ((link.m_parent == g_invalidLink) && !m_isPinned)
+        {
+            continue;
+        }
+
+        link.m_u = -(link.m_force.m_angular - glm::cross(link.m_pivot, link.m_force.m_linear));
+
+        if (link.m_parent != g_invalidLink)
+        {
+            const glm::vec3 invDu = link.m_invD * link.m_u;
+            SpatialVector force = {link.m_force.m_angular + link.m_Ut * invDu, link.m_force.m_linear + link.m_Ub * invDu};
+            if (!isImpulse)
+            {
+                // The inertia the link passes on to its parent, times the
+                // bias of the joint.
+                const glm::vec3& c = link.m_bias.m_linear;
+                force.m_angular += link.m_inertia.m_b * c - link.m_Ut * (link.m_invD * (glm::transpose(link.m_Ub) * c));
+                force.m_linear += link.m_inertia.m_d * c - link.m_Ub * (link.m_invD * (glm::transpose(link.m_Ub) * c));
+            }
+
+            SpatialVector& parentForce = m_links[link.m_parent].m_force;
+            parentForce = parentForce + force;
+        }
+    }
+
+    for (size_t i = 0; i < m_links.size(); ++i)
+    {
+        ArticulationLink& link = m_links[i];
+
+        if ((link.m_parent == g_invalidLink) && !m_isPinned)
+        {
+            const SpatialVector force = {-link.m_force.m_angular, -link.m_force.m_linear};
+            link.m_acceleration = SolveSpatial(link.m_inertia, force);
+            continue;
+        }
+
+        SpatialVector acceleration = {glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 0.0f)};
+        if (link.m_parent != g_invalidLink)
+        {
+            acceleration = m_links[link.m_parent].m_acceleration;
+        }
+        if (!isImpulse)
+        {
+            acceleration = acceleration + link.m_bias;
+        }
+
+        link.m_jointAcceleration = link.m_invD * (link.m_u - glm::transpose(link.m_Ut) * acceleration.m_angular - glm::transpose(link.m_Ub) * acceleration.m_linear);
+        link.m_acceleration.m_angular = acceleration.m_angular + link.m_jointAcceleration;
+        link.m_acceleration.m_linear = acceleration.m_linear + glm::cross(link.m_pivot, link.m_jointAcceleration);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,157 @@
+#include "BVH.h"
+#include <algorithm>
+
+bool Overlap(const AABB& a, const AABB& b)
+{
+    return (a.m_min.x <= b.m_max.x) && (a.m_max.x >= b.m_min.x) &&
+           (a.m_min.y <= b.m_max.y) && (a.m_max.y >= b.m_min.y) &&
+           (a.m_min.z <= b.m_max.z) && (a.m_max.z >= b.m_min.z);
+}
+
+AABB Merge(const AABB& a, const AABB& b)
+{
+    return AABB(glm::min(a.m_min, b.m_min), glm::max(a.m_max, b.m_max));
+}
+
+AABB Fatten(const AABB& aabb, float margin)
+{
+    const glm::vec3 m = glm::vec3(margin, margin, margin);
+    return AABB(aabb.m_min - m, aabb.m_max + m);
+}
+
+AABB TransformAABB(const AABB& aabb, const glm::vec3& position, const glm::quat& rotation)
+{
+    const glm::mat3 R = glm::mat3_cast(rotation);
+    const glm::mat3 absR = glm::mat3(glm::abs(R[0]), glm::abs(R[1]), glm::abs(R[2]));
+    const glm::vec3 center = position + R * aabb.GetCenter();
+    const glm::vec3 halfExtents = absR * aabb.GetHalfExtents();
+    return AABB(center - halfExtents, center + halfExtents);
+}
+
+void BuildBVHNode(BVH& bvh, const AABB* leafAABBs, uint32_t nodeIndex, uint32_t first, uint32_t count)
+{
+    AABB bounds = leafAABBs[bvh.m_leaves[first]];
+    AABB centroidBounds = AABB(bounds.GetCenter(), bounds.GetCenter());
+    for (uint32_t i = first + 1; i < first + count; ++i)
+    {
+        const AABB& leafAABB = leafAABBs[bvh.m_leaves[i]];
+        bounds = Merge(bounds, leafAABB);
+        centroidBounds = Merge(centroidBounds, AABB(leafAABB.GetCenter(), leafAABB.GetCenter()));
+    }
+
+    bvh.m_nodes[nodeIndex].m_aabb = bounds;
+
+    if (count == 1)
+    {
+        bvh.m_nodes[nodeIndex].m_first = first;
+        bvh.m_nodes[nodeIndex].m_count = count;
+        return;
+    }
+
+    // Median split along the axis with the largest centroid spread.
+    const glm::vec3 spread = centroidBounds.m_max - centroidBounds.m_min;
+    int axis = 0;
+    if (spread.y > spread[axis])
+    {
+        axis = 1;
+    }
+    if (spread.z > spread[axis])
+    {
+        axis = 2;
+    }
+
+    const uint32_t middle = first + count / 2;
+    std::nth_element(bvh.m_leaves.begin() + first, bvh.m_leaves.begin() + middle, bvh.m_leaves.begin() + first + count, [leafAABBs, axis](uint32_t a, uint32_t b)
+    {
+        return leafAABBs[a].GetCenter()[axis] < leafAABBs[b].GetCenter()[axis];
+    });
+
+    const uint32_t childIndex = static_cast<uint32_t>(bvh.m_nodes.size());
+    bvh.m_nodes.resize(bvh.m_nodes.size() + 2);
+    bvh.m_nodes[nodeIndex].m_first = childIndex;
+    bvh.m_nodes[nodeIndex].m_count = 0;
+
+    BuildBVHNode(bvh, leafAABBs, childIndex, first, middle - first);
+    BuildBVHNode(bvh, leafAABBs, childIndex + 1, middle, first + count - middle);
+}
+
+void BVH::Build(const AABB* leafAABBs, size_t leafCount)
+{
+    m_nodes.clear();
+    m_leaves.resize(leafCount);
+
+    if (leafCount == 0)
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < leafCount; ++i)
+    {
+        m_leaves[i] = static_cast<uint32_t>(i);
+    }
+
+    m_nodes.reserve(2 * leafCount - 1);
+    m_nodes.resize(1);
+    BuildBVHNode(*this, leafAABBs, 0, 0, static_cast<uint32_t>(leafCount));
+}
+
+void QueryPairs(const BVH& bvh1, const glm::vec3& position1, const glm::quat& rotation1, const BVH& bvh2, const glm::vec3& position2, const glm::quat& rotation2, float margin, Vector<BVHPair>& pairs, Vector<BVHPair>& stack)
+{
+    if (bvh1.IsEmpty() || bvh2.IsEmpty())
+    {
+        return;
+    }
+
+    // Traverse in the local space of bvh1 so that only the nodes of bvh2
+    // need to be transformed.
+    const glm::quat invRotation1 = glm::conjugate(rotation1);
+    const glm::quat relativeRotation = invRotation1 * rotation2;
+    const glm::vec3 relativePosition = invRotation1 * (position2 - position1);
+
+    stack.clear();
+    stack.push_back({0, 0});
+
+    while (!stack.empty())
+    {
+        const BVHPair nodePair = stack.back();
+        stack.pop_back();
+
+        const BVHNode& node1 = bvh1.m_nodes[nodePair.m_index1];
+        const BVHNode& node2 = bvh2.m_nodes[nodePair.m_index2];
+
+        const AABB aabb1 = Fatten(node1.m_aabb, margin);
+        const AABB aabb2 = TransformAABB(node2.m_aabb, relativePosition, relativeRotation);
+        if (!Overlap(aabb1, aabb2))
+        {
+            continue;
+        }
+
+        if (node1.IsLeaf() && node2.IsLeaf())
+        {
+            for (uint32_t i = 0; i < node1.m_count; ++i)
+            {
+                for (uint32_t j = 0; j < node2.m_count; ++j)
+                {
+                    pairs.push_back({bvh1.m_leaves[node1.m_first + i], bvh2.m_leaves[node2.m_first + j]});
+                }
+            }
+            continue;
+        }
+
+        // Descend into the larger node first so the boxes stay balanced.
+        const glm::vec3 extents1 = node1.m_aabb.GetHalfExtents();
+        const glm::vec3 extents2 = node2.m_aabb.GetHalfExtents();
+        const bool descend1 = node2.IsLeaf() || (!node1.IsLeaf() && (extents1.x * extents1.y * extents1.z >= extents2.x * extents2.y * extents2.z));
+
+        if (descend1)
+        {
+            stack.push_back({node1.m_first, nodePair.m_index2});
+            stack.push_back({node1.m_first + 1, nodePair.m_index2});
+        }
+        else
+        {
+            stack.push_back({nodePair.m_index1, node2.m_first});
+            stack.push_back({nodePair.m_index1, node2.m_first + 1});
+        }
+    }
+}
\ No newline at end of file
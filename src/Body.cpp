@@ -1,5 +1,7 @@
 #include "Body.h"
+#include <algorithm>
 #include <atomic>
+#include <cassert>
 
 std::atomic<uint32_t> g_counter;
 
@@ -9,14 +11,126 @@ Material::Material()
 , m_restitution(0.0f)
 , m_frictionCombineMode(CombineMode::Average)
 , m_restitutionCombineMode(CombineMode::Average)
+, m_world(nullptr)
+, m_id(g_invalidMaterialID)
 {
 }
 
+Material::Material(const Material& other)
+: m_staticFriction(other.m_staticFriction)
+, m_dynamicFriction(other.m_dynamicFriction)
+, m_restitution(other.m_restitution)
+, m_frictionCombineMode(other.m_frictionCombineMode)
+, m_restitutionCombineMode(other.m_restitutionCombineMode)
+, m_world(nullptr)
+, m_id(g_invalidMaterialID)
+{
+}
+
+Material& Material::operator=(const Material& other)
+{
+    m_staticFriction = other.m_staticFriction;
+    m_dynamicFriction = other.m_dynamicFriction;
+    m_restitution = other.m_restitution;
+    m_frictionCombineMode = other.m_frictionCombineMode;
+    m_restitutionCombineMode = other.m_restitutionCombineMode;
+    return *this;
+}
+
+MaterialPair CombineMaterials(const Material& material1, const Material& material2)
+{
+    MaterialPair pair;
+
+    const CombineMode effectiveFrictionCombineMode = std::max(material1.m_frictionCombineMode, material2.m_frictionCombineMode);
+    switch (effectiveFrictionCombineMode)
+    {
+        case CombineMode::Average:
+        {
+            pair.m_staticFriction = (material1.m_staticFriction + material2.m_staticFriction) * 0.5f;
+            pair.m_dynamicFriction = (material1.m_dynamicFriction + material2.m_dynamicFriction) * 0.5f;
+            break;
+        }
+
+        case CombineMode::Minimum:
+        {
+            pair.m_staticFriction = std::min(material1.m_staticFriction, material2.m_staticFriction);
+            pair.m_dynamicFriction = std::min(material1.m_dynamicFriction, material2.m_dynamicFriction);
+            break;
+        }
+
+        case CombineMode::Multiply:
+        {
+            pair.m_staticFriction = material1.m_staticFriction * material2.m_staticFriction;
+            pair.m_dynamicFriction = material1.m_dynamicFriction * material2.m_dynamicFriction;
+            break;
+        }
+
+        case CombineMode::Maximum:
+        {
+            pair.m_staticFriction = std::max(material1.m_staticFriction, material2.m_staticFriction);
+            pair.m_dynamicFriction = std::max(material1.m_dynamicFriction, material2.m_dynamicFriction);
+            break;
+        }
+
+        default:
+        {
+            assert(false);
+        }
+    }
+
+    const CombineMode effectiveRestitutionCombineMode = std::max(material1.m_restitutionCombineMode, material2.m_restitutionCombineMode);
+    switch (effectiveRestitutionCombineMode)
+    {
+        case CombineMode::Average:
+        {
+            pair.m_restitution = (material1.m_restitution + material2.m_restitution) * 0.5f;
+            break;
+        }
+
+        case CombineMode::Minimum:
+        {
+            pair.m_restitution = std::min(material1.m_restitution, material2.m_restitution);
+            break;
+        }
+
+        case CombineMode::Multiply:
+        {
+            pair.m_restitution = material1.m_restitution * material2.m_restitution;
+            break;
+        }
+
+        case CombineMode::Maximum:
+        {
+            pair.m_restitution = std::max(material1.m_restitution, material2.m_restitution);
+            break;
+        }
+
+        default:
+        {
+            assert(false);
+        }
+    }
+
+    return pair;
+}
+
 Shape::~Shape()
 {
     if (m_owner)
     {
         m_owner->m_shapes.erase(std::find(m_owner->m_shapes.begin(), m_owner->m_shapes.end(), this));
+        m_owner->m_bvhDirty = true;
+    }
+}
+
+void Shape::SetTransform(const glm::vec3& position, const glm::quat& rotation)
+{
+    m_position = position;
+    m_rotation = rotation;
+
+    if (m_owner)
+    {
+        m_owner->m_bvhDirty = true;
     }
 }
 
@@ -54,9 +168,15 @@ void ShapeBox::Set(const glm::vec3& halfSize)
     if (m_owner)
     {
         m_owner->ComputeInvI();
+        m_owner->m_bvhDirty = true;
     }
 }
 
+AABB ShapeBox::ComputeAABB() const
+{
+    return AABB(-m_halfSize, m_halfSize);
+}
+
 glm::vec3 ShapeBox::ComputeI(float mass) const
 {
     glm::vec3 s = 2.0f * m_halfSize;
@@ -80,9 +200,15 @@ void ShapeSphere::Set(float radius)
     if (m_owner)
     {
         m_owner->ComputeInvI();
+        m_owner->m_bvhDirty = true;
     }
 }
 
+AABB ShapeSphere::ComputeAABB() const
+{
+    return AABB(glm::vec3(-m_radius, -m_radius, -m_radius), glm::vec3(m_radius, m_radius, m_radius));
+}
+
 glm::vec3 ShapeSphere::ComputeI(float mass) const
 {
     float v = 1.0f / ((2.0f / 5.0f) * mass * m_radius * m_radius);
@@ -104,9 +230,16 @@ void ShapeCapsule::Set(float radius, float halfHeight)
     if (m_owner)
     {
         m_owner->ComputeInvI();
+        m_owner->m_bvhDirty = true;
     }
 }
 
+AABB ShapeCapsule::ComputeAABB() const
+{
+    const glm::vec3 halfExtents = glm::vec3(m_radius, m_halfHeight + m_radius, m_radius);
+    return AABB(-halfExtents, halfExtents);
+}
+
 glm::vec3 ShapeCapsule::ComputeI(float mass) const
 {
     float volumeCylinder = glm::pi<float>() * m_radius * m_radius * (2.0f * m_halfHeight);
@@ -127,21 +260,34 @@ glm::vec3 ShapeCapsule::ComputeI(float mass) const
     return glm::vec3(Ixz, Iy, Ixz);
 }
 
+glm::mat3 RotateDiagonal(const glm::quat& rotation, const glm::vec3& diagonal)
+{
+    const glm::mat3 R = glm::mat3_cast(rotation);
+    const glm::mat3 RD(diagonal.x * R[0], diagonal.y * R[1], diagonal.z * R[2]);
+    return RD * glm::transpose(R);
+}
+
 Body::Body()
 {
     userData = nullptr;
-    m_position = glm::vec3(0.0f, 0.0f, 0.0f);
-    m_rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
-    m_velocity = glm::vec3(0.0f, 0.0f, 0.0f);
-    m_angularVelocity = glm::vec3(0.0f, 0.0f, 0.0f);
-    m_force = glm::vec3(0.0f, 0.0f, 0.0f);
-    m_torque = glm::vec3(0.0f, 0.0f, 0.0f);
+    m_state = &m_localState;
+    m_state->m_position = glm::vec3(0.0f, 0.0f, 0.0f);
+    m_state->m_invMass = 0.0f;
+    m_state->m_rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+    m_state->m_velocity = glm::vec3(0.0f, 0.0f, 0.0f);
+    m_state->m_linearDamping = 0.0f;
+    m_state->m_angularVelocity = glm::vec3(0.0f, 0.0f, 0.0f);
+    m_state->m_angularDamping = 0.0f;
+    m_state->m_force = glm::vec3(0.0f, 0.0f, 0.0f);
+    m_state->m_torque = glm::vec3(0.0f, 0.0f, 0.0f);
+    m_state->m_invI = glm::vec3(0.0f, 0.0f, 0.0f);
+    m_state->m_useGravity = true;
+    m_state->m_useCCD = false;
     m_mass = std::numeric_limits<float>::infinity();
-    m_invMass = 0.0f;
-    m_linearDamping = 0.0f;
-    m_angularDamping = 0.0f;
-    m_useGravity = true;
-    m_invI = glm::mat3(0.0f);
+    m_bvhDirty = true;
+    m_solverIndex = 0;
+    m_articulation = nullptr;
+    m_linkIndex = 0;
 }
 
 Body::~Body()
@@ -157,24 +303,25 @@ void Body::SetMass(float mass)
     m_mass = mass;
     if ((m_mass > 0.0f) && (m_mass < std::numeric_limits<float>::infinity()))
     {
-        m_invMass = 1.0f / m_mass;
+        m_state->m_invMass = 1.0f / m_mass;
     }
     else
     {
-        m_invMass = 0.0f;
+        m_state->m_invMass = 0.0f;
     }
     ComputeInvI();
 }
 
 void Body::AddForce(const glm::vec3& force)
 {
-    m_force += force;
+    m_state->m_force += force;
 }
 
 void Body::AddShape(Shape* shape)
 {
     shape->m_owner = this;
     m_shapes.push_back(shape);
+    m_bvhDirty = true;
 }
 
 void Body::ComputeInvI()
@@ -215,13 +362,55 @@ void Body::ComputeInvI()
                 }
             }
         }
-        m_invI = glm::mat3(
-            glm::vec3((I.x > 0.0f) ? 1.0f / I.x : 0.0f, 0.0f, 0.0f),
-            glm::vec3(0.0f, (I.y > 0.0f) ? 1.0f / I.y : 0.0f, 0.0f),
-            glm::vec3(0.0f, 0.0f, (I.z > 0.0f) ? 1.0f / I.z : 0.0f));
+        m_state->m_invI = glm::vec3((I.x > 0.0f) ? 1.0f / I.x : 0.0f, (I.y > 0.0f) ? 1.0f / I.y : 0.0f, (I.z > 0.0f) ? 1.0f / I.z : 0.0f);
     }
     else
     {
-        m_invI = glm::mat3(0.0f);
+        m_state->m_invI = glm::vec3(0.0f, 0.0f, 0.0f);
+    }
+}
+
+void Body::UpdateBVH()
+{
+    if (!m_bvhDirty)
+    {
+        return;
+    }
+
+    m_shapeAABBs.resize(m_shapes.size());
+    for (size_t i = 0; i < m_shapes.size(); ++i)
+    {
+        const Shape* s = m_shapes[i];
+
+        AABB shapeAABB;
+        switch (s->GetType())
+        {
+            case ShapeType::Box:
+            {
+                shapeAABB = static_cast<const ShapeBox*>(s)->ComputeAABB();
+                break;
+            }
+
+            case ShapeType::Sphere:
+            {
+                shapeAABB = static_cast<const ShapeSphere*>(s)->ComputeAABB();
+                break;
+            }
+
+            case ShapeType::Capsule:
+            {
+                shapeAABB = static_cast<const ShapeCapsule*>(s)->ComputeAABB();
+                break;
+            }
+
+            default:
+            {
+                assert(false);
+            }
+        }
+        m_shapeAABBs[i] = TransformAABB(shapeAABB, s->m_position, s->m_rotation);
     }
+
+    m_bvh.Build(m_shapeAABBs.data(), m_shapeAABBs.size());
+    m_bvhDirty = false;
 }
\ No newline at end of file
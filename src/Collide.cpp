@@ -47,15 +47,23 @@ void ProjectOBB(const glm::vec3* corners, const glm::vec3& axis, float* minProj,
     }
 }
 
-void ClipPointsPlane(const glm::vec3* points, const glm::vec3& planeNormal, float planeOffset, size_t* indices, size_t* indexCount)
+void ClipPointsPlane(const glm::vec3* points, const glm::vec3& planeNormal, float planeOffset, float margin, size_t* indices, size_t* indexCount)
 {
     *indexCount = 0;
     for (size_t i = 0; i < 8; ++i)
     {
         float distanceToPlane = glm::dot(points[i], planeNormal) - planeOffset;
-        if (distanceToPlane <= 0.0f)
+        if (distanceToPlane <= margin)
         {
-            indices[*indexCount] = i;
+            // Keep the points sorted deepest first, so that callers can
+            // truncate to the most relevant ones.
+            size_t j = *indexCount;
+            while ((j > 0) && (glm::dot(points[indices[j - 1]], planeNormal) - planeOffset > distanceToPlane))
+            {
+                indices[j] = indices[j - 1];
+                --j;
+            }
+            indices[j] = i;
             ++(*indexCount);
         }
     }
@@ -125,7 +133,7 @@ void ComputeClosestPointsOnEdges(const glm::vec3& p1, const glm::vec3& q1, const
     c2 = p2 + d2 * t;
 }
 
-void SeparatingAxisTheorem(const OBB& obb1, const OBB& obb2, size_t maxCollisionInfo, CollisionInfo* collisionInfos, size_t* count)
+void SeparatingAxisTheorem(const OBB& obb1, const OBB& obb2, float margin, size_t maxCollisionInfo, CollisionInfo* collisionInfos, size_t* count)
 {
     *count = 0;
 
@@ -189,12 +197,16 @@ void SeparatingAxisTheorem(const OBB& obb1, const OBB& obb2, size_t maxCollision
         ProjectOBB(obb2Corners, axis, &minProj2, &maxProj2);
 
         float overlap = std::min(maxProj1, maxProj2) - std::max(minProj1, minProj2);
-        if (overlap <= 0.0f)
+        if (overlap <= -margin)
         {
             return;
         }
 
-        if (overlap < minSeparation)
+        // Edge axes must win by a clear margin, otherwise nearly aligned
+        // boxes flip between face and edge contacts from step to step.
+        constexpr float k_edgeAxisTolerance = 0.005f;
+        const float biasedOverlap = (i < 6) ? overlap : overlap + k_edgeAxisTolerance;
+        if (biasedOverlap < minSeparation)
         {
             minSeparation = overlap;
             collisionNormal = axis;
@@ -216,18 +228,14 @@ void SeparatingAxisTheorem(const OBB& obb1, const OBB& obb2, size_t maxCollision
         const glm::vec3* incidentCorners = (bestAxisIndex < 3) ? obb2Corners : obb1Corners;
 
         size_t referenceAxisIndex = bestAxisIndex % 3;
-        glm::vec3 referenceFaceNormal = referenceBox.m_rotation[referenceAxisIndex];
-        if (bestAxisIndex >= 3)
-        {
-            referenceFaceNormal = -referenceFaceNormal;
-        }
+        glm::vec3 referenceFaceNormal = (bestAxisIndex < 3) ? collisionNormal : -collisionNormal;
 
         glm::vec3 faceCenter = referenceBox.m_center + referenceFaceNormal * referenceBox.m_halfExtents[referenceAxisIndex];
         float planeOffset = glm::dot(faceCenter, referenceFaceNormal);
 
         size_t indices[8];
         size_t indexCount;
-        ClipPointsPlane(incidentCorners, referenceFaceNormal, planeOffset, indices, &indexCount);
+        ClipPointsPlane(incidentCorners, referenceFaceNormal, planeOffset, margin, indices, &indexCount);
 
         const size_t clampedIndexCount = std::min(indexCount, maxCollisionInfo);
         for (size_t i = 0; i < clampedIndexCount; ++i)
@@ -235,7 +243,7 @@ void SeparatingAxisTheorem(const OBB& obb1, const OBB& obb2, size_t maxCollision
             CollisionInfo& collisionInfo = collisionInfos[*count];
             collisionInfo.m_position = incidentCorners[indices[i]];
             collisionInfo.m_normal = collisionNormal;
-            collisionInfo.m_separation = minSeparation;
+            collisionInfo.m_separation = glm::dot(incidentCorners[indices[i]], referenceFaceNormal) - planeOffset;
             collisionInfo.m_feature = referenceAxisIndex * 10 + indices[i];
             ++(*count);
         }
@@ -262,13 +270,13 @@ void SeparatingAxisTheorem(const OBB& obb1, const OBB& obb2, size_t maxCollision
         CollisionInfo& collisionInfo = collisionInfos[*count];
         collisionInfo.m_position = (closestPoint1 + closestPoint2) * 0.5f;
         collisionInfo.m_normal = collisionNormal;
-        collisionInfo.m_separation = minSeparation;
+        collisionInfo.m_separation = -minSeparation;
         collisionInfo.m_feature = edge1Index * 10 + edge2Index * 100;
         ++(*count);
     }
 }
 
-size_t CollideBoxBox(Contact* contacts, glm::vec3 positionShape1, glm::quat rotationShape1, Shape* shape1, glm::vec3 positionShape2, glm::quat rotationShape2, Shape* shape2)
+size_t CollideBoxBox(Contact* contacts, glm::vec3 positionShape1, glm::quat rotationShape1, Shape* shape1, glm::vec3 positionShape2, glm::quat rotationShape2, Shape* shape2, float margin)
 {
     ShapeBox* shapeBox1 = static_cast<ShapeBox*>(shape1);
     ShapeBox* shapeBox2 = static_cast<ShapeBox*>(shape2);
@@ -278,7 +286,7 @@ size_t CollideBoxBox(Contact* contacts, glm::vec3 positionShape1, glm::quat rota
 
     CollisionInfo collisionInfos[g_maxContactPoints];
     size_t count;
-    SeparatingAxisTheorem(obb1, obb2, g_maxContactPoints, collisionInfos, &count);
+    SeparatingAxisTheorem(obb1, obb2, margin, g_maxContactPoints, collisionInfos, &count);
 
     for (size_t i = 0; i < count; ++i)
     {
@@ -291,7 +299,7 @@ size_t CollideBoxBox(Contact* contacts, glm::vec3 positionShape1, glm::quat rota
     return count;
 }
 
-size_t CollideBoxSphere(Contact* contacts, glm::vec3 positionShape1, glm::quat rotationShape1, Shape* shape1, glm::vec3 positionShape2, glm::quat rotationShape2, Shape* shape2)
+size_t CollideBoxSphere(Contact* contacts, glm::vec3 positionShape1, glm::quat rotationShape1, Shape* shape1, glm::vec3 positionShape2, glm::quat rotationShape2, Shape* shape2, float /*margin*/)
 {
     ShapeBox* shapeBox = static_cast<ShapeBox*>(shape1);
     ShapeSphere* shapeSphere = static_cast<ShapeSphere*>(shape2);
@@ -299,7 +307,7 @@ size_t CollideBoxSphere(Contact* contacts, glm::vec3 positionShape1, glm::quat r
     return 0;
 }
 
-size_t CollideBoxCapsule(Contact* contacts, glm::vec3 positionShape1, glm::quat rotationShape1, Shape* shape1, glm::vec3 positionShape2, glm::quat rotationShape2, Shape* shape2)
+size_t CollideBoxCapsule(Contact* contacts, glm::vec3 positionShape1, glm::quat rotationShape1, Shape* shape1, glm::vec3 positionShape2, glm::quat rotationShape2, Shape* shape2, float /*margin*/)
 {
     ShapeBox* shapeBox = static_cast<ShapeBox*>(shape1);
     ShapeCapsule* shapeCapsule = static_cast<ShapeCapsule*>(shape2);
@@ -307,7 +315,7 @@ size_t CollideBoxCapsule(Contact* contacts, glm::vec3 positionShape1, glm::quat
     return 0;
 }
 
-size_t CollideSphereSphere(Contact* contacts, glm::vec3 positionShape1, glm::quat rotationShape1, Shape* shape1, glm::vec3 positionShape2, glm::quat rotationShape2, Shape* shape2)
+size_t CollideSphereSphere(Contact* contacts, glm::vec3 positionShape1, glm::quat rotationShape1, Shape* shape1, glm::vec3 positionShape2, glm::quat rotationShape2, Shape* shape2, float margin)
 {
     ShapeSphere* shapeSphere1 = static_cast<ShapeSphere*>(shape1);
     ShapeSphere* shapeSphere2 = static_cast<ShapeSphere*>(shape2);
@@ -316,20 +324,20 @@ size_t CollideSphereSphere(Contact* contacts, glm::vec3 positionShape1, glm::qua
     const float shape1ToShape2Length = glm::length(shape1ToShape2);
 
     const float overlap = shape1ToShape2Length - shapeSphere1->m_radius - shapeSphere2->m_radius;
-    if (overlap > 0.0f)
+    if (overlap > margin)
     {
         return 0;
     }
 
     contacts[0].m_normal = (shape1ToShape2Length > 0.0f) ? shape1ToShape2 * (1.0f / shape1ToShape2Length) : glm::vec3(0.0f, 1.0f, 0.0f);
     contacts[0].m_position = positionShape1 + contacts[0].m_normal * (shapeSphere1->m_radius + (overlap * 0.5f));
-    contacts[0].m_separation = -overlap;
+    contacts[0].m_separation = overlap;
     contacts[0].m_feature = 0;
 
     return 1;
 }
 
-size_t CollideSphereCapsule(Contact* contacts, glm::vec3 positionShape1, glm::quat rotationShape1, Shape* shape1, glm::vec3 positionShape2, glm::quat rotationShape2, Shape* shape2)
+size_t CollideSphereCapsule(Contact* contacts, glm::vec3 positionShape1, glm::quat rotationShape1, Shape* shape1, glm::vec3 positionShape2, glm::quat rotationShape2, Shape* shape2, float /*margin*/)
 {
     ShapeSphere* shapeSphere = static_cast<ShapeSphere*>(shape1);
     ShapeCapsule* shapeCapsule = static_cast<ShapeCapsule*>(shape2);
@@ -337,7 +345,7 @@ size_t CollideSphereCapsule(Contact* contacts, glm::vec3 positionShape1, glm::qu
     return 0;
 }
 
-size_t CollideCapsuleCapsule(Contact* contacts, glm::vec3 positionShape1, glm::quat rotationShape1, Shape* shape1, glm::vec3 positionShape2, glm::quat rotationShape2, Shape* shape2)
+size_t CollideCapsuleCapsule(Contact* contacts, glm::vec3 positionShape1, glm::quat rotationShape1, Shape* shape1, glm::vec3 positionShape2, glm::quat rotationShape2, Shape* shape2, float /*margin*/)
 {
     ShapeCapsule* shapeCapsule1 = static_cast<ShapeCapsule*>(shape1);
     ShapeCapsule* shapeCapsule2 = static_cast<ShapeCapsule*>(shape2);
@@ -345,38 +353,51 @@ size_t CollideCapsuleCapsule(Contact* contacts, glm::vec3 positionShape1, glm::q
     return 0;
 }
 
-size_t Collide(Contact* contacts, Body* body1, Shape* shape1, Body* body2, Shape* shape2)
+typedef size_t (*CollideFunction)(Contact* contacts, glm::vec3 positionShape1, glm::quat rotationShape1, Shape* shape1, glm::vec3 positionShape2, glm::quat rotationShape2, Shape* shape2, float margin);
+
+size_t Collide(Contact* contacts, Body* body1, Shape* shape1, Body* body2, Shape* shape2, float margin)
+{
+    return Collide(contacts, body1->m_state->m_position, body1->m_state->m_rotation, shape1, body2->m_state->m_position, body2->m_state->m_rotation, shape2, margin);
+}
+
+size_t Collide(Contact* contacts, const glm::vec3& positionBody1, const glm::quat& rotationBody1, Shape* shape1, const glm::vec3& positionBody2, const glm::quat& rotationBody2, Shape* shape2, float margin)
 {
     constexpr size_t shapeCount = static_cast<size_t>(ShapeType::Count);
-    static const std::function<size_t(Contact*, glm::vec3, glm::quat, Shape*, glm::vec3, glm::quat, Shape*)> collisionMatrix[shapeCount][shapeCount]
+    static const CollideFunction collisionMatrix[shapeCount][shapeCount]
     {
         {CollideBoxBox, CollideBoxSphere,    CollideBoxCapsule},
         {nullptr,       CollideSphereSphere, CollideSphereCapsule},
         {nullptr,       nullptr,             CollideCapsuleCapsule}
     };
-    Body* lowestBody;
+    glm::vec3 lowestPosition;
+    glm::quat lowestRotation;
     Shape* lowestShape;
-    Body* highestBody;
+    glm::vec3 highestPosition;
+    glm::quat highestRotation;
     Shape* highestShape;
     if (shape1->GetType() <= shape2->GetType())
     {
-        lowestBody = body1;
+        lowestPosition = positionBody1;
+        lowestRotation = rotationBody1;
         lowestShape = shape1;
-        highestBody = body2;
+        highestPosition = positionBody2;
+        highestRotation = rotationBody2;
         highestShape = shape2;
     }
     else
     {
-        lowestBody = body2;
+        lowestPosition = positionBody2;
+        lowestRotation = rotationBody2;
         lowestShape = shape2;
-        highestBody = body1;
+        highestPosition = positionBody1;
+        highestRotation = rotationBody1;
         highestShape = shape1;
     }
     const size_t shape1Type = static_cast<size_t>(lowestShape->GetType());
     const size_t shape2Type = static_cast<size_t>(highestShape->GetType());
-    const glm::vec3 worldPositionShape1 = (lowestBody->m_rotation * lowestShape->m_position) + lowestBody->m_position;
-    const glm::vec3 worldPositionShape2 = (highestBody->m_rotation * highestShape->m_position) + highestBody->m_position;
-    const glm::quat worldRotationShape1 = lowestBody->m_rotation * lowestShape->m_rotation;
-    const glm::quat worldRotationShape2 = highestBody->m_rotation * highestShape->m_rotation;
-    return collisionMatrix[shape1Type][shape2Type](contacts, worldPositionShape1, worldRotationShape1, lowestShape, worldPositionShape2, worldRotationShape2, highestShape);
+    const glm::vec3 worldPositionShape1 = (lowestRotation * lowestShape->m_position) + lowestPosition;
+    const glm::vec3 worldPositionShape2 = (highestRotation * highestShape->m_position) + highestPosition;
+    const glm::quat worldRotationShape1 = lowestRotation * lowestShape->m_rotation;
+    const glm::quat worldRotationShape2 = highestRotation * highestShape->m_rotation;
+    return collisionMatrix[shape1Type][shape2Type](contacts, worldPositionShape1, worldRotationShape1, lowestShape, worldPositionShape2, worldRotationShape2, highestShape, margin);
 }
\ No newline at end of file
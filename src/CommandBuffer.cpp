@@ -0,0 +1,78 @@
+#include "CommandBuffer.h"
+#include "Body.h"
+
+CommandBuffer::CommandBuffer(Allocator* allocator)
+: m_commands(allocator)
+{
+}
+
+void CommandBuffer::AddBody(Body* body)
+{
+    Record(WorldCommandType::AddBody, body, nullptr, nullptr, glm::vec3(0.0f));
+}
+
+void CommandBuffer::RemoveBody(Body* body)
+{
+    Record(WorldCommandType::RemoveBody, body, nullptr, nullptr, glm::vec3(0.0f));
+}
+
+void CommandBuffer::AddJoint(Joint* joint)
+{
+    Record(WorldCommandType::AddJoint, nullptr, joint, nullptr, glm::vec3(0.0f));
+}
+
+void CommandBuffer::RemoveJoint(Joint* joint)
+{
+    Record(WorldCommandType::RemoveJoint, nullptr, joint, nullptr, glm::vec3(0.0f));
+}
+
+void CommandBuffer::AddShape(Body* body, Shape* shape)
+{
+    Record(WorldCommandType::AddShape, body, nullptr, shape, glm::vec3(0.0f));
+}
+
+void CommandBuffer::SetBox(ShapeBox* shape, const glm::vec3& halfSize)
+{
+    Record(WorldCommandType::SetBox, nullptr, nullptr, static_cast<Shape*>(shape), halfSize);
+}
+
+void CommandBuffer::SetSphere(ShapeSphere* shape, float radius)
+{
+    Record(WorldCommandType::SetSphere, nullptr, nullptr, static_cast<Shape*>(shape), glm::vec3(radius, 0.0f, 0.0f));
+}
+
+void CommandBuffer::SetCapsule(ShapeCapsule* shape, float radius, float halfHeight)
+{
+    Record(WorldCommandType::SetCapsule, nullptr, nullptr, static_cast<Shape*>(shape), glm::vec3(radius, halfHeight, 0.0f));
+}
+
+void CommandBuffer::SetIsTrigger(Shape* shape, bool isTrigger)
+{
+    Record(WorldCommandType::SetIsTrigger, nullptr, nullptr, shape, glm::vec3(isTrigger ? 1.0f : 0.0f, 0.0f, 0.0f));
+}
+
+void CommandBuffer::SetMass(Body* body, float mass)
+{
+    Record(WorldCommandType::SetMass, body, nullptr, nullptr, glm::vec3(mass, 0.0f, 0.0f));
+}
+
+void CommandBuffer::Record(WorldCommandType type, Body* body, Joint* joint, Shape* shape, const glm::vec3& values)
+{
+    WorldCommand command;
+    command.m_type = type;
+    command.m_body = body;
+    command.m_joint = joint;
+    command.m_shape = shape;
+    command.m_values = values;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_commands.push_back(command);
+}
+
+void CommandBuffer::Swap(Vector<WorldCommand>& commands)
+{
+    commands.clear();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_commands.swap(commands);
+}
\ No newline at end of file
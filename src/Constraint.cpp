@@ -0,0 +1,271 @@
+#include "Constraint.h"
+#include "Arbiter.h"
+#include <algorithm>
+#include <cassert>
+#include <limits>
+
+void InitRow(ConstraintRow& row, const SolverBodies& bodies, uint32_t index1, uint32_t index2, const glm::vec3& linear, const glm::vec3& angular1, const glm::vec3& angular2, float bias, float softness, float impulse)
+{
+    row.m_linear = linear;
+    row.m_angular1 = angular1;
+    row.m_angular2 = angular2;
+    row.m_response1 = bodies.m_invIs[index1] * angular1;
+    row.m_response2 = bodies.m_invIs[index2] * angular2;
+    row.m_invMass1 = bodies.m_invMasses[index1];
+    row.m_invMass2 = bodies.m_invMasses[index2];
+
+    float k = (row.m_invMass1 + row.m_invMass2) * glm::dot(linear, linear);
+    k += glm::dot(angular1, row.m_response1);
+    k += glm::dot(angular2, row.m_response2);
+    k += softness;
+    row.m_mass = (k > 0.0f) ? 1.0f / k : 0.0f;
+
+    row.m_bias = bias;
+    row.m_separation = 0.0f;
+    row.m_softness = softness;
+    row.m_lower = -std::numeric_limits<float>::infinity();
+    row.m_upper = std::numeric_limits<float>::infinity();
+    row.m_normalOffset = 0;
+    row.m_staticFriction = 0.0f;
+    row.m_dynamicFriction = 0.0f;
+    row.m_impulse = impulse;
+    row.m_index1 = index1;
+    row.m_index2 = index2;
+}
+
+void InitPointRows(ConstraintRow* rows, const SolverBodies& bodies, uint32_t index1, uint32_t index2, const glm::vec3& r1, const glm::vec3& r2, const glm::vec3& separation, float biasRate, float softness)
+{
+    for (int i = 0; i < 3; ++i)
+    {
+        glm::vec3 axis(0.0f, 0.0f, 0.0f);
+        axis[i] = 1.0f;
+        InitRow(rows[i], bodies, index1, index2, axis, -glm::cross(r1, axis), glm::cross(r2, axis), biasRate * separation[i], softness, rows[i].m_impulse);
+        rows[i].m_separation = separation[i];
+    }
+}
+
+void WarmStartRows(const ConstraintRow* rows, size_t rowCount, SolverBodies& bodies)
+{
+    for (size_t i = 0; i < rowCount; ++i)
+    {
+        const ConstraintRow& row = rows[i];
+
+        bodies.m_velocities[row.m_index1] -= (row.m_invMass1 * row.m_impulse) * row.m_linear;
+        bodies.m_angularVelocities[row.m_index1] += row.m_impulse * row.m_response1;
+
+        bodies.m_velocities[row.m_index2] += (row.m_invMass2 * row.m_impulse) * row.m_linear;
+        bodies.m_angularVelocities[row.m_index2] += row.m_impulse * row.m_response2;
+    }
+}
+
+float SolveRows(ConstraintRow* rows, size_t rowCount, SolverBodies& bodies)
+{
+    float residual = 0.0f;
+
+    for (size_t i = 0; i < rowCount; ++i)
+    {
+        ConstraintRow& row = rows[i];
+
+        glm::vec3 v1 = bodies.m_velocities[row.m_index1];
+        glm::vec3 w1 = bodies.m_angularVelocities[row.m_index1];
+        glm::vec3 v2 = bodies.m_velocities[row.m_index2];
+        glm::vec3 w2 = bodies.m_angularVelocities[row.m_index2];
+
+        float jv = glm::dot(row.m_linear, v2 - v1) + glm::dot(row.m_angular1, w1) + glm::dot(row.m_angular2, w2);
+        float lambda = row.m_mass * (row.m_bias - jv - row.m_softness * row.m_impulse);
+
+        if (row.m_normalOffset != 0)
+        {
+            const float friction = (std::abs(jv) < g_velocityThreshold) ? row.m_staticFriction : row.m_dynamicFriction;
+            row.m_upper = friction * rows[i - row.m_normalOffset].m_impulse;
+            row.m_lower = -row.m_upper;
+        }
+
+        float oldImpulse = row.m_impulse;
+        row.m_impulse = glm::clamp(oldImpulse + lambda, row.m_lower, row.m_upper);
+        lambda = row.m_impulse - oldImpulse;
+        residual = glm::max(residual, std::abs(lambda));
+
+        bodies.SetVelocity(row.m_index1, v1 - (row.m_invMass1 * lambda) * row.m_linear, w1 + lambda * row.m_response1);
+        bodies.SetVelocity(row.m_index2, v2 + (row.m_invMass2 * lambda) * row.m_linear, w2 + lambda * row.m_response2);
+    }
+
+    return residual;
+}
+
+// Gaussian elimination with partial pivoting. A singular block, such as
+// one between two static bodies, gives a zero solution.
+void SolveBlock(float* block, uint32_t n, float* x)
+{
+    for (uint32_t c = 0; c < n; ++c)
+    {
+        uint32_t pivot = c;
+        for (uint32_t r = c + 1; r < n; ++r)
+        {
+            if (std::abs(block[r * n + c]) > std::abs(block[pivot * n + c]))
+            {
+                pivot = r;
+            }
+        }
+
+        if (block[pivot * n + c] == 0.0f)
+        {
+            std::fill(x, x + n, 0.0f);
+            return;
+        }
+
+        if (pivot != c)
+        {
+            for (uint32_t k = 0; k < n; ++k)
+            {
+                std::swap(block[c * n + k], block[pivot * n + k]);
+            }
+            std::swap(x[c], x[pivot]);
+        }
+
+        for (uint32_t r = c + 1; r < n; ++r)
+        {
+            const float factor = block[r * n + c] / block[c * n + c];
+            for (uint32_t k = c; k < n; ++k)
+            {
+                block[r * n + k] -= factor * block[c * n + k];
+            }
+            x[r] -= factor * x[c];
+        }
+    }
+
+    for (uint32_t c = n; c-- > 0;)
+    {
+        for (uint32_t k = c + 1; k < n; ++k)
+        {
+            x[c] -= block[c * n + k] * x[k];
+        }
+        x[c] /= block[c * n + c];
+    }
+}
+
+void ComputeBlockMass(const ConstraintRow* rows, uint32_t rowCount, float* mass)
+{
+    assert(rowCount <= g_maxBlockRows);
+
+    float block[g_maxBlockRows * g_maxBlockRows];
+    for (uint32_t i = 0; i < rowCount; ++i)
+    {
+        for (uint32_t j = 0; j < rowCount; ++j)
+        {
+            float k = (rows[i].m_invMass1 + rows[i].m_invMass2) * glm::dot(rows[i].m_linear, rows[j].m_linear);
+            k += glm::dot(rows[i].m_angular1, rows[j].m_response1);
+            k += glm::dot(rows[i].m_angular2, rows[j].m_response2);
+            block[i * rowCount + j] = k;
+        }
+        block[i * rowCount + i] += rows[i].m_softness;
+    }
+
+    for (uint32_t c = 0; c < rowCount; ++c)
+    {
+        float factored[g_maxBlockRows * g_maxBlockRows];
+        float column[g_maxBlockRows] = {};
+        std::copy(block, block + rowCount * rowCount, factored);
+        column[c] = 1.0f;
+        SolveBlock(factored, rowCount, column);
+        for (uint32_t r = 0; r < rowCount; ++r)
+        {
+            mass[r * rowCount + c] = column[r];
+        }
+    }
+}
+
+float ApplyBlockImpulses(const ConstraintRow* rows, uint32_t rowCount, const float* lambdas, SolverBodies& bodies)
+{
+    const uint32_t index1 = rows[0].m_index1;
+    const uint32_t index2 = rows[0].m_index2;
+    glm::vec3 v1 = bodies.m_velocities[index1];
+    glm::vec3 w1 = bodies.m_angularVelocities[index1];
+    glm::vec3 v2 = bodies.m_velocities[index2];
+    glm::vec3 w2 = bodies.m_angularVelocities[index2];
+    float residual = 0.0f;
+
+    for (uint32_t i = 0; i < rowCount; ++i)
+    {
+        const ConstraintRow& row = rows[i];
+        v1 -= (row.m_invMass1 * lambdas[i]) * row.m_linear;
+        w1 += lambdas[i] * row.m_response1;
+        v2 += (row.m_invMass2 * lambdas[i]) * row.m_linear;
+        w2 += lambdas[i] * row.m_response2;
+        residual = glm::max(residual, std::abs(lambdas[i]));
+    }
+
+    bodies.SetVelocity(index1, v1, w1);
+    bodies.SetVelocity(index2, v2, w2);
+
+    return residual;
+}
+
+float ComputeJV(const ConstraintRow& row, const SolverBodies& bodies)
+{
+    return glm::dot(row.m_linear, bodies.m_velocities[row.m_index2] - bodies.m_velocities[row.m_index1]) + glm::dot(row.m_angular1, bodies.m_angularVelocities[row.m_index1]) + glm::dot(row.m_angular2, bodies.m_angularVelocities[row.m_index2]);
+}
+
+void MultiplyBlockMass(const float* mass, uint32_t rowCount, const float* x, float* y)
+{
+    for (uint32_t i = 0; i < rowCount; ++i)
+    {
+        y[i] = 0.0f;
+        for (uint32_t j = 0; j < rowCount; ++j)
+        {
+            y[i] += mass[i * rowCount + j] * x[j];
+        }
+    }
+}
+
+float SolveRowBlock(ConstraintRow* rows, uint32_t rowCount, const float* mass, SolverBodies& bodies)
+{
+    float errors[g_maxBlockRows];
+    float lambdas[g_maxBlockRows];
+    for (uint32_t i = 0; i < rowCount; ++i)
+    {
+        errors[i] = rows[i].m_bias - ComputeJV(rows[i], bodies) - rows[i].m_softness * rows[i].m_impulse;
+    }
+    MultiplyBlockMass(mass, rowCount, errors, lambdas);
+
+    for (uint32_t i = 0; i < rowCount; ++i)
+    {
+        rows[i].m_impulse += lambdas[i];
+    }
+
+    return ApplyBlockImpulses(rows, rowCount, lambdas, bodies);
+}
+
+float SolveRowBlockSoft(ConstraintRow* rows, uint32_t rowCount, const float* mass, SolverBodies& bodies, const Softness& softness, bool useBias)
+{
+    const float massScale = useBias ? softness.m_massScale : 1.0f;
+    const float impulseScale = useBias ? softness.m_impulseScale : 0.0f;
+
+    float errors[g_maxBlockRows];
+    float lambdas[g_maxBlockRows];
+    for (uint32_t i = 0; i < rowCount; ++i)
+    {
+        const ConstraintRow& row = rows[i];
+        float bias = 0.0f;
+        if (useBias)
+        {
+            // The error moves with the bodies' displacements since PreStep,
+            // to first order in their rotations.
+            const glm::quat& q1 = bodies.m_deltaRotations[row.m_index1];
+            const glm::quat& q2 = bodies.m_deltaRotations[row.m_index2];
+            float separation = row.m_separation + glm::dot(row.m_linear, bodies.m_deltaPositions[row.m_index2] - bodies.m_deltaPositions[row.m_index1]);
+            separation += 2.0f * (glm::dot(row.m_angular1, glm::vec3(q1.x, q1.y, q1.z)) + glm::dot(row.m_angular2, glm::vec3(q2.x, q2.y, q2.z)));
+            bias = softness.m_biasRate * separation;
+        }
+        errors[i] = -(ComputeJV(row, bodies) + bias);
+    }
+    MultiplyBlockMass(mass, rowCount, errors, lambdas);
+
+    for (uint32_t i = 0; i < rowCount; ++i)
+    {
+        lambdas[i] = massScale * lambdas[i] - impulseScale * rows[i].m_impulse;
+        rows[i].m_impulse += lambdas[i];
+    }
+
+    return ApplyBlockImpulses(rows, rowCount, lambdas, bodies);
+}
\ No newline at end of file
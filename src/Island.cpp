@@ -0,0 +1,648 @@
+#include "Island.h"
+#include "Arbiter.h"
+#include "Joint.h"
+#include "Solver.h"
+#include "TaskExecutor.h"
+#include <algorithm>
+
+constexpr uint32_t k_invalidIsland = 0xFFFFFFFF;
+constexpr uint32_t k_maxIslandColors = 64;
+constexpr uint32_t k_colorGrainSize = 32;
+
+IslandSolver::IslandSolver(Allocator* allocator)
+: m_islands(allocator)
+, m_colors(allocator)
+, m_smallIslands(allocator)
+, m_largeIslands(allocator)
+, m_jacobiIslands(allocator)
+, m_treeIslands(allocator)
+, m_islandTrees(allocator)
+, m_jointTrees(allocator)
+, m_arbiters(allocator)
+, m_joints(allocator)
+, m_parents(allocator)
+, m_bodyIslands(allocator)
+, m_arbiterIslands(allocator)
+, m_jointIslands(allocator)
+, m_bodyColors(allocator)
+, m_constraintColors(allocator)
+, m_islandStats(allocator)
+, m_workerResiduals(allocator)
+, m_coloredArbiters(allocator)
+, m_coloredJoints(allocator)
+, m_bodyConstraintCounts(allocator)
+, m_jacobiBodies(allocator)
+, m_jacobiOffsets(allocator)
+, m_jacobiDeltaIndices(allocator)
+, m_jacobiCursors(allocator)
+, m_bodySlots(allocator)
+, m_jacobiDeltas(allocator)
+{
+}
+
+uint32_t IslandSolver::FindRoot(uint32_t index)
+{
+    while (m_parents[index] != index)
+    {
+        m_parents[index] = m_parents[m_parents[index]];
+        index = m_parents[index];
+    }
+    return index;
+}
+
+void IslandSolver::Reserve(size_t bodyCount, size_t arbiterCount, size_t jointCount)
+{
+    m_islands.reserve(bodyCount);
+    m_colors.reserve(k_maxIslandColors);
+    m_smallIslands.reserve(bodyCount);
+    m_largeIslands.reserve(bodyCount);
+    m_jacobiIslands.reserve(bodyCount);
+    m_islandStats.reserve(bodyCount);
+    m_parents.reserve(bodyCount);
+    m_bodyIslands.reserve(bodyCount);
+    m_bodyColors.reserve(bodyCount);
+    m_bodyConstraintCounts.reserve(bodyCount);
+    m_bodySlots.reserve(bodyCount);
+    m_jacobiBodies.reserve(bodyCount);
+    m_jacobiOffsets.reserve(bodyCount);
+    m_jacobiCursors.reserve(bodyCount);
+
+    m_arbiters.reserve(arbiterCount);
+    m_arbiterIslands.reserve(arbiterCount);
+    m_coloredArbiters.reserve(arbiterCount);
+    m_jacobiDeltaIndices.reserve(2 * arbiterCount);
+    m_jacobiDeltas.reserve(4 * arbiterCount);
+    m_joints.reserve(jointCount);
+    m_jointIslands.reserve(jointCount);
+    m_coloredJoints.reserve(jointCount);
+    m_constraintColors.reserve(arbiterCount + jointCount);
+}
+
+void IslandSolver::Build(Arbiter* const* arbiters, size_t arbiterCount, Joint* const* joints, size_t jointCount, const SolverBodies& bodies, uint32_t coloringThreshold, uint32_t jacobiThreshold, bool useJointTrees)
+{
+    const size_t bodyCount = bodies.m_invMasses.size();
+
+    // Union-find over the dynamic bodies. The lower index always becomes
+    // the root so that the result only depends on the constraint order.
+    m_parents.resize(bodyCount);
+    for (uint32_t i = 0; i < bodyCount; ++i)
+    {
+        m_parents[i] = i;
+    }
+
+    auto join = [this, &bodies](uint32_t index1, uint32_t index2)
+    {
+        if ((bodies.m_invMasses[index1] == 0.0f) || (bodies.m_invMasses[index2] == 0.0f))
+        {
+            return;
+        }
+
+        const uint32_t root1 = FindRoot(index1);
+        const uint32_t root2 = FindRoot(index2);
+        if (root1 < root2)
+        {
+            m_parents[root2] = root1;
+        }
+        else if (root2 < root1)
+        {
+            m_parents[root1] = root2;
+        }
+    };
+
+    for (size_t i = 0; i < arbiterCount; ++i)
+    {
+        join(arbiters[i]->m_index1, arbiters[i]->m_index2);
+    }
+
+    for (size_t i = 0; i < jointCount; ++i)
+    {
+        join(joints[i]->m_index1, joints[i]->m_index2);
+    }
+
+    // Islands are numbered in the order their first constraint appears.
+    m_islands.clear();
+    m_bodyIslands.assign(bodyCount, k_invalidIsland);
+
+    auto findIsland = [this, &bodies](uint32_t index1, uint32_t index2)
+    {
+        uint32_t index = index1;
+        if (bodies.m_invMasses[index1] == 0.0f)
+        {
+            if (bodies.m_invMasses[index2] == 0.0f)
+            {
+                return k_invalidIsland;
+            }
+            index = index2;
+        }
+
+        const uint32_t root = FindRoot(index);
+        if (m_bodyIslands[root] == k_invalidIsland)
+        {
+            m_bodyIslands[root] = static_cast<uint32_t>(m_islands.size());
+            m_islands.push_back(Island());
+            Island& island = m_islands.back();
+            island.m_arbiterBegin = 0;
+            island.m_arbiterEnd = 0;
+            island.m_jointBegin = 0;
+            island.m_jointEnd = 0;
+            island.m_colorBegin = 0;
+            island.m_colorEnd = 0;
+            island.m_bodyBegin = 0;
+            island.m_bodyEnd = 0;
+        }
+        return m_bodyIslands[root];
+    };
+
+    m_arbiterIslands.resize(arbiterCount);
+    for (size_t i = 0; i < arbiterCount; ++i)
+    {
+        const uint32_t islandIndex = findIsland(arbiters[i]->m_index1, arbiters[i]->m_index2);
+        m_arbiterIslands[i] = islandIndex;
+        if (islandIndex != k_invalidIsland)
+        {
+            ++m_islands[islandIndex].m_arbiterEnd;
+        }
+    }
+
+    m_jointIslands.resize(jointCount);
+    for (size_t i = 0; i < jointCount; ++i)
+    {
+        const uint32_t islandIndex = findIsland(joints[i]->m_index1, joints[i]->m_index2);
+        m_jointIslands[i] = islandIndex;
+        if (islandIndex != k_invalidIsland)
+        {
+            ++m_islands[islandIndex].m_jointEnd;
+        }
+    }
+
+    // Group the constraints by island, keeping their relative order.
+    uint32_t arbiterOffset = 0;
+    uint32_t jointOffset = 0;
+    for (size_t i = 0; i < m_islands.size(); ++i)
+    {
+        Island& island = m_islands[i];
+        island.m_arbiterBegin = arbiterOffset;
+        arbiterOffset += island.m_arbiterEnd;
+        island.m_arbiterEnd = island.m_arbiterBegin;
+        island.m_jointBegin = jointOffset;
+        jointOffset += island.m_jointEnd;
+        island.m_jointEnd = island.m_jointBegin;
+    }
+
+    m_arbiters.resize(arbiterOffset);
+    for (size_t i = 0; i < arbiterCount; ++i)
+    {
+        if (m_arbiterIslands[i] != k_invalidIsland)
+        {
+            m_arbiters[m_islands[m_arbiterIslands[i]].m_arbiterEnd++] = arbiters[i];
+        }
+    }
+
+    m_joints.resize(jointOffset);
+    for (size_t i = 0; i < jointCount; ++i)
+    {
+        if (m_jointIslands[i] != k_invalidIsland)
+        {
+            m_joints[m_islands[m_jointIslands[i]].m_jointEnd++] = joints[i];
+        }
+    }
+
+    m_colors.clear();
+    m_coloredArbiters.clear();
+    m_coloredJoints.clear();
+    m_bodyColors.assign(bodyCount, 0);
+    m_smallIslands.clear();
+    m_largeIslands.clear();
+    m_jacobiIslands.clear();
+    m_treeIslands.clear();
+    m_islandTrees.clear();
+    uint32_t treeCount = 0;
+    m_bodyConstraintCounts.assign(bodyCount, 0);
+    m_jacobiBodies.clear();
+    m_jacobiOffsets.clear();
+    m_jacobiDeltaIndices.clear();
+    m_bodySlots.resize(bodyCount);
+    for (uint32_t i = 0; i < m_islands.size(); ++i)
+    {
+        Island& island = m_islands[i];
+        const uint32_t constraintCount = (island.m_arbiterEnd - island.m_arbiterBegin) + (island.m_jointEnd - island.m_jointBegin);
+
+        if (useJointTrees && (island.m_arbiterEnd == island.m_arbiterBegin))
+        {
+            // Islands with cycles keep their tree too, so that they are
+            // not analyzed again on every step.
+            const uint32_t treeIndex = treeCount++;
+            if (treeIndex == m_jointTrees.size())
+            {
+                m_jointTrees.emplace_back(m_jointTrees.get_allocator().m_allocator);
+            }
+
+            JointTree& tree = m_jointTrees[treeIndex];
+            Joint* const* islandJoints = m_joints.data() + island.m_jointBegin;
+            const uint32_t jointCount = island.m_jointEnd - island.m_jointBegin;
+            const bool isTree = tree.Matches(islandJoints, jointCount) ? tree.m_isTree : tree.Analyze(islandJoints, jointCount, bodies);
+            if (isTree)
+            {
+                m_treeIslands.push_back(i);
+                m_islandTrees.push_back(treeIndex);
+                continue;
+            }
+        }
+
+        if (constraintCount > jacobiThreshold)
+        {
+            PrepareJacobi(island, bodies);
+            m_jacobiIslands.push_back(i);
+        }
+        else if (constraintCount > coloringThreshold)
+        {
+            ColorIsland(island, bodies);
+            m_largeIslands.push_back(i);
+        }
+        else
+        {
+            m_smallIslands.push_back(i);
+        }
+    }
+    m_jacobiDeltas.resize(m_jacobiIslands.empty() ? 0 : 4 * m_arbiters.size());
+
+    // Start the biggest islands first so that the workers finish together.
+    // Ties keep the island order; std::stable_sort would allocate a buffer.
+    std::sort(m_smallIslands.begin(), m_smallIslands.end(), [this](uint32_t a, uint32_t b)
+    {
+        const Island& islandA = m_islands[a];
+        const Island& islandB = m_islands[b];
+        const uint32_t sizeA = (islandA.m_arbiterEnd - islandA.m_arbiterBegin) + (islandA.m_jointEnd - islandA.m_jointBegin);
+        const uint32_t sizeB = (islandB.m_arbiterEnd - islandB.m_arbiterBegin) + (islandB.m_jointEnd - islandB.m_jointBegin);
+        return (sizeA != sizeB) ? (sizeA > sizeB) : (a < b);
+    });
+}
+
+void IslandSolver::ColorIsland(Island& island, const SolverBodies& bodies)
+{
+    // Greedy coloring, the same as the wide contact solver. Constraints that
+    // find no free color go to a last color that is solved serially.
+    const uint32_t arbiterCount = island.m_arbiterEnd - island.m_arbiterBegin;
+    const uint32_t jointCount = island.m_jointEnd - island.m_jointBegin;
+    uint32_t arbiterCounts[k_maxIslandColors + 1] = {};
+    uint32_t jointCounts[k_maxIslandColors + 1] = {};
+
+    auto pickColor = [this, &bodies](uint32_t index1, uint32_t index2)
+    {
+        const bool isDynamic1 = bodies.m_invMasses[index1] != 0.0f;
+        const bool isDynamic2 = bodies.m_invMasses[index2] != 0.0f;
+        const uint64_t usedColors = (isDynamic1 ? m_bodyColors[index1] : 0) | (isDynamic2 ? m_bodyColors[index2] : 0);
+
+        uint32_t color = 0;
+        while ((color < k_maxIslandColors) && (usedColors & (uint64_t(1) << color)))
+        {
+            ++color;
+        }
+
+        if (color < k_maxIslandColors)
+        {
+            if (isDynamic1)
+            {
+                m_bodyColors[index1] |= uint64_t(1) << color;
+            }
+            if (isDynamic2)
+            {
+                m_bodyColors[index2] |= uint64_t(1) << color;
+            }
+        }
+        return color;
+    };
+
+    m_constraintColors.resize(arbiterCount + jointCount);
+    for (uint32_t i = 0; i < arbiterCount; ++i)
+    {
+        const Arbiter* arb = m_arbiters[island.m_arbiterBegin + i];
+        m_constraintColors[i] = pickColor(arb->m_index1, arb->m_index2);
+        ++arbiterCounts[m_constraintColors[i]];
+    }
+
+    for (uint32_t i = 0; i < jointCount; ++i)
+    {
+        const Joint* joint = m_joints[island.m_jointBegin + i];
+        m_constraintColors[arbiterCount + i] = pickColor(joint->m_index1, joint->m_index2);
+        ++jointCounts[m_constraintColors[arbiterCount + i]];
+    }
+
+    uint32_t arbiterStarts[k_maxIslandColors + 1];
+    uint32_t jointStarts[k_maxIslandColors + 1];
+    uint32_t arbiterOffset = static_cast<uint32_t>(m_coloredArbiters.size());
+    uint32_t jointOffset = static_cast<uint32_t>(m_coloredJoints.size());
+    island.m_colorBegin = static_cast<uint32_t>(m_colors.size());
+    for (uint32_t color = 0; color <= k_maxIslandColors; ++color)
+    {
+        arbiterStarts[color] = arbiterOffset;
+        jointStarts[color] = jointOffset;
+
+        if ((arbiterCounts[color] == 0) && (jointCounts[color] == 0))
+        {
+            continue;
+        }
+
+        IslandColor islandColor;
+        islandColor.m_arbiterBegin = arbiterOffset;
+        islandColor.m_arbiterEnd = arbiterOffset + arbiterCounts[color];
+        islandColor.m_jointBegin = jointOffset;
+        islandColor.m_jointEnd = jointOffset + jointCounts[color];
+        islandColor.m_isSerial = (color == k_maxIslandColors);
+        m_colors.push_back(islandColor);
+
+        arbiterOffset += arbiterCounts[color];
+        jointOffset += jointCounts[color];
+    }
+    island.m_colorEnd = static_cast<uint32_t>(m_colors.size());
+
+    m_coloredArbiters.resize(arbiterOffset);
+    for (uint32_t i = 0; i < arbiterCount; ++i)
+    {
+        m_coloredArbiters[arbiterStarts[m_constraintColors[i]]++] = m_arbiters[island.m_arbiterBegin + i];
+    }
+
+    m_coloredJoints.resize(jointOffset);
+    for (uint32_t i = 0; i < jointCount; ++i)
+    {
+        m_coloredJoints[jointStarts[m_constraintColors[arbiterCount + i]]++] = m_joints[island.m_jointBegin + i];
+    }
+}
+
+void IslandSolver::PrepareJacobi(Island& island, const SolverBodies& bodies)
+{
+    // Count the contacts of each dynamic body and list the bodies in the
+    // order they first appear.
+    island.m_bodyBegin = static_cast<uint32_t>(m_jacobiBodies.size());
+    for (uint32_t i = island.m_arbiterBegin; i < island.m_arbiterEnd; ++i)
+    {
+        const uint32_t indices[2] = { m_arbiters[i]->m_index1, m_arbiters[i]->m_index2 };
+        for (uint32_t index : indices)
+        {
+            if (bodies.m_invMasses[index] == 0.0f)
+            {
+                continue;
+            }
+
+            if (m_bodyConstraintCounts[index]++ == 0)
+            {
+                m_bodySlots[index] = static_cast<uint32_t>(m_jacobiBodies.size());
+                m_jacobiBodies.push_back(index);
+            }
+        }
+    }
+    island.m_bodyEnd = static_cast<uint32_t>(m_jacobiBodies.size());
+
+    uint32_t offset = static_cast<uint32_t>(m_jacobiDeltaIndices.size());
+    m_jacobiCursors.resize(m_jacobiBodies.size());
+    for (uint32_t i = island.m_bodyBegin; i < island.m_bodyEnd; ++i)
+    {
+        m_jacobiOffsets.push_back(offset);
+        m_jacobiCursors[i] = offset;
+        offset += m_bodyConstraintCounts[m_jacobiBodies[i]];
+    }
+    m_jacobiDeltaIndices.resize(offset);
+
+    // Each arbiter writes the changes for its first body at 4 * i and for
+    // its second body at 4 * i + 2. Filling the entries in arbiter order
+    // keeps the sums independent of the thread count.
+    auto addEntry = [this, &bodies](uint32_t index, uint32_t deltaIndex)
+    {
+        if (bodies.m_invMasses[index] != 0.0f)
+        {
+            m_jacobiDeltaIndices[m_jacobiCursors[m_bodySlots[index]]++] = deltaIndex;
+        }
+    };
+
+    for (uint32_t i = island.m_arbiterBegin; i < island.m_arbiterEnd; ++i)
+    {
+        addEntry(m_arbiters[i]->m_index1, 4 * i);
+        addEntry(m_arbiters[i]->m_index2, 4 * i + 2);
+    }
+}
+
+void IslandSolver::WarmStartPositions(const Island& island, SolverBodies& bodies)
+{
+    for (uint32_t i = island.m_arbiterBegin; i < island.m_arbiterEnd; ++i)
+    {
+        m_arbiters[i]->WarmStartPseudoImpulse(bodies);
+    }
+}
+
+SolverStats IslandSolver::SolveIsland(const Island& island, SolverBodies& bodies, uint32_t iterations, IslandPass pass, float tolerance)
+{
+    SolverStats stats = {0, 0.0f};
+
+    if (pass == IslandPass::Position)
+    {
+        WarmStartPositions(island, bodies);
+    }
+
+    while (stats.m_iterations < iterations)
+    {
+        float residual = 0.0f;
+
+        for (uint32_t j = island.m_arbiterBegin; j < island.m_arbiterEnd; ++j)
+        {
+            if (pass == IslandPass::Position)
+            {
+                residual = std::max(residual, m_arbiters[j]->ApplyPseudoImpulse(bodies));
+            }
+            else
+            {
+                residual = std::max(residual, m_arbiters[j]->ApplyImpulse(bodies));
+            }
+        }
+
+        if (pass == IslandPass::Velocity)
+        {
+            for (uint32_t j = island.m_jointBegin; j < island.m_jointEnd; ++j)
+            {
+                residual = std::max(residual, SolveRowBlock(m_joints[j]->m_rows, m_joints[j]->m_rowCount, m_joints[j]->m_mass, bodies));
+            }
+        }
+
+        ++stats.m_iterations;
+        stats.m_residual = residual;
+
+        if (residual <= tolerance)
+        {
+            break;
+        }
+    }
+
+    return stats;
+}
+
+float IslandSolver::SolveColor(const IslandColor& color, uint32_t begin, uint32_t end, SolverBodies& bodies, IslandPass pass)
+{
+    const uint32_t arbiterCount = color.m_arbiterEnd - color.m_arbiterBegin;
+    float residual = 0.0f;
+    for (uint32_t i = begin; i < end; ++i)
+    {
+        if (i >= arbiterCount)
+        {
+            if (pass == IslandPass::Velocity)
+            {
+                Joint* joint = m_coloredJoints[color.m_jointBegin + i - arbiterCount];
+                residual = std::max(residual, SolveRowBlock(joint->m_rows, joint->m_rowCount, joint->m_mass, bodies));
+            }
+        }
+        else if (pass == IslandPass::Position)
+        {
+            residual = std::max(residual, m_coloredArbiters[color.m_arbiterBegin + i]->ApplyPseudoImpulse(bodies));
+        }
+        else
+        {
+            residual = std::max(residual, m_coloredArbiters[color.m_arbiterBegin + i]->ApplyImpulse(bodies));
+        }
+    }
+    return residual;
+}
+
+SolverStats IslandSolver::SolveJacobi(TaskExecutor* executor, const Island& island, SolverBodies& bodies, uint32_t iterations, float tolerance)
+{
+    SolverStats stats = {0, 0.0f};
+
+    while (stats.m_iterations < iterations)
+    {
+        std::fill(m_workerResiduals.begin(), m_workerResiduals.end(), 0.0f);
+
+        // The contacts only read the velocities here, so they can all be
+        // solved at once.
+        ParallelFor(executor, island.m_arbiterEnd - island.m_arbiterBegin, k_colorGrainSize, [this, &island, &bodies](uint32_t begin, uint32_t end, uint32_t workerIndex)
+        {
+            float residual = 0.0f;
+            for (uint32_t i = island.m_arbiterBegin + begin; i < island.m_arbiterBegin + end; ++i)
+            {
+                Arbiter* arb = m_arbiters[i];
+                const float share1 = static_cast<float>(std::max(m_bodyConstraintCounts[arb->m_index1], 1u));
+                const float share2 = static_cast<float>(std::max(m_bodyConstraintCounts[arb->m_index2], 1u));
+                residual = std::max(residual, arb->ApplyImpulseMassSplit(bodies, share1, share2, m_jacobiDeltas.data() + 4 * i));
+            }
+            m_workerResiduals[workerIndex] = std::max(m_workerResiduals[workerIndex], residual);
+        });
+
+        ParallelFor(executor, island.m_bodyEnd - island.m_bodyBegin, k_colorGrainSize, [this, &island, &bodies](uint32_t begin, uint32_t end, uint32_t)
+        {
+            for (uint32_t i = island.m_bodyBegin + begin; i < island.m_bodyBegin + end; ++i)
+            {
+                const uint32_t index = m_jacobiBodies[i];
+                const uint32_t offset = m_jacobiOffsets[i];
+                glm::vec3 velocity = bodies.m_velocities[index];
+                glm::vec3 angularVelocity = bodies.m_angularVelocities[index];
+                for (uint32_t j = offset; j < offset + m_bodyConstraintCounts[index]; ++j)
+                {
+                    velocity += m_jacobiDeltas[m_jacobiDeltaIndices[j]];
+                    angularVelocity += m_jacobiDeltas[m_jacobiDeltaIndices[j] + 1];
+                }
+                bodies.m_velocities[index] = velocity;
+                bodies.m_angularVelocities[index] = angularVelocity;
+            }
+        });
+
+        // Joints are usually few even in large piles, so they are solved
+        // one after another on the averaged velocities.
+        for (uint32_t j = island.m_jointBegin; j < island.m_jointEnd; ++j)
+        {
+            m_workerResiduals[0] = std::max(m_workerResiduals[0], SolveRowBlock(m_joints[j]->m_rows, m_joints[j]->m_rowCount, m_joints[j]->m_mass, bodies));
+        }
+
+        ++stats.m_iterations;
+        stats.m_residual = *std::max_element(m_workerResiduals.begin(), m_workerResiduals.end());
+
+        if (stats.m_residual <= tolerance)
+        {
+            break;
+        }
+    }
+
+    return stats;
+}
+
+SolverStats IslandSolver::Solve(TaskExecutor* executor, SolverBodies& bodies, uint32_t iterations, IslandPass pass, float tolerance)
+{
+    m_islandStats.resize(m_smallIslands.size());
+    ParallelFor(executor, static_cast<uint32_t>(m_smallIslands.size()), 1, [this, &bodies, iterations, pass, tolerance](uint32_t begin, uint32_t end, uint32_t)
+    {
+        for (uint32_t i = begin; i < end; ++i)
+        {
+            m_islandStats[i] = SolveIsland(m_islands[m_smallIslands[i]], bodies, iterations, pass, tolerance);
+        }
+    });
+
+    SolverStats stats = {0, 0.0f};
+    for (size_t i = 0; i < m_islandStats.size(); ++i)
+    {
+        stats.m_iterations = std::max(stats.m_iterations, m_islandStats[i].m_iterations);
+        stats.m_residual = std::max(stats.m_residual, m_islandStats[i].m_residual);
+    }
+
+    // Joint-only islands have nothing for the position pass.
+    if ((pass == IslandPass::Velocity) && !m_treeIslands.empty())
+    {
+        ParallelFor(executor, static_cast<uint32_t>(m_treeIslands.size()), 1, [this, &bodies](uint32_t begin, uint32_t end, uint32_t)
+        {
+            for (uint32_t i = begin; i < end; ++i)
+            {
+                m_jointTrees[m_islandTrees[i]].Solve(bodies);
+            }
+        });
+        stats.m_iterations = std::max(stats.m_iterations, 1u);
+    }
+
+    // Each worker keeps the largest change it saw, so that the colors need
+    // no synchronization to report the residual.
+    m_workerResiduals.resize(executor->GetWorkerCount());
+
+    for (size_t i = 0; i < m_jacobiIslands.size(); ++i)
+    {
+        const Island& island = m_islands[m_jacobiIslands[i]];
+        const SolverStats islandStats = (pass == IslandPass::Position) ? SolveIsland(island, bodies, iterations, pass, tolerance) : SolveJacobi(executor, island, bodies, iterations, tolerance);
+        stats.m_iterations = std::max(stats.m_iterations, islandStats.m_iterations);
+        stats.m_residual = std::max(stats.m_residual, islandStats.m_residual);
+    }
+
+    for (size_t i = 0; i < m_largeIslands.size(); ++i)
+    {
+        const Island& island = m_islands[m_largeIslands[i]];
+
+        if (pass == IslandPass::Position)
+        {
+            WarmStartPositions(island, bodies);
+        }
+
+        for (uint32_t j = 0; j < iterations; ++j)
+        {
+            std::fill(m_workerResiduals.begin(), m_workerResiduals.end(), 0.0f);
+
+            for (uint32_t k = island.m_colorBegin; k < island.m_colorEnd; ++k)
+            {
+                const IslandColor& color = m_colors[k];
+                const uint32_t constraintCount = (color.m_arbiterEnd - color.m_arbiterBegin) + (color.m_jointEnd - color.m_jointBegin);
+
+                if (color.m_isSerial)
+                {
+                    m_workerResiduals[0] = std::max(m_workerResiduals[0], SolveColor(color, 0, constraintCount, bodies, pass));
+                    continue;
+                }
+
+                ParallelFor(executor, constraintCount, k_colorGrainSize, [this, &color, &bodies, pass](uint32_t begin, uint32_t end, uint32_t workerIndex)
+                {
+                    m_workerResiduals[workerIndex] = std::max(m_workerResiduals[workerIndex], SolveColor(color, begin, end, bodies, pass));
+                });
+            }
+
+            const float residual = *std::max_element(m_workerResiduals.begin(), m_workerResiduals.end());
+            stats.m_iterations = std::max(stats.m_iterations, j + 1);
+
+            if ((residual <= tolerance) || (j + 1 == iterations))
+            {
+                stats.m_residual = std::max(stats.m_residual, residual);
+                break;
+            }
+        }
+    }
+
+    return stats;
+}
\ No newline at end of file
@@ -0,0 +1,462 @@
+#include "JointTree.h"
+#include "Joint.h"
+#include <algorithm>
+
+constexpr uint32_t k_noBody = 0xFFFFFFFF;
+constexpr uint32_t k_noNode = 0xFFFFFFFF;
+constexpr uint32_t k_noJoint = 0xFFFFFFFF;
+// Compliance added to every row, relative to its effective mass between
+// free bodies. Taut or redundant joints, like a bridge held at both ends,
+// otherwise get huge impulses that blow the bodies apart.
+constexpr float k_compliance = 1.0e-4f;
+
+// A body whose inverse inertia is singular, such as one without shapes,
+// is taken to have infinite inertia and does not turn.
+bool IsRotationFixed(const SolverBodies& bodies, uint32_t body)
+{
+    return glm::determinant(bodies.m_invIs[body]) == 0.0f;
+}
+
+// Velocity Jacobian of a row with respect to one of its bodies, linear part
+// first. The angular part is zero for a body that does not turn.
+void GetRowJacobian(const ConstraintRow& row, const SolverBodies& bodies, uint32_t body, float* jacobian)
+{
+    const bool isFirst = (row.m_index1 == body);
+    const glm::vec3 linear = isFirst ? -row.m_linear : row.m_linear;
+    const glm::vec3 angular = IsRotationFixed(bodies, body) ? glm::vec3(0.0f, 0.0f, 0.0f) : (isFirst ? row.m_angular1 : row.m_angular2);
+    for (int i = 0; i < 3; ++i)
+    {
+        jacobian[i] = linear[i];
+        jacobian[3 + i] = angular[i];
+    }
+}
+
+// LDL^T factorization of a symmetric n x n block in place, with D on the
+// diagonal. Rows with a zero pivot are dropped.
+void FactorSymmetric(float* a, uint32_t n)
+{
+    for (uint32_t j = 0; j < n; ++j)
+    {
+        float d = a[j * n + j];
+        for (uint32_t k = 0; k < j; ++k)
+        {
+            d -= a[j * n + k] * a[j * n + k] * a[k * n + k];
+        }
+
+        a[j * n + j] = d;
+        for (uint32_t i = j + 1; i < n; ++i)
+        {
+            float value = a[i * n + j];
+            for (uint32_t k = 0; k < j; ++k)
+            {
+                value -= a[i * n + k] * a[j * n + k] * a[k * n + k];
+            }
+            a[i * n + j] = (d != 0.0f) ? value / d : 0.0f;
+        }
+    }
+}
+
+void SolveSymmetric(const float* a, uint32_t n, float* x)
+{
+    for (uint32_t i = 0; i < n; ++i)
+    {
+        for (uint32_t k = 0; k < i; ++k)
+        {
+            x[i] -= a[i * n + k] * x[k];
+        }
+    }
+
+    for (uint32_t i = 0; i < n; ++i)
+    {
+        const float d = a[i * n + i];
+        x[i] = (d != 0.0f) ? x[i] / d : 0.0f;
+    }
+
+    for (uint32_t i = n; i-- > 0;)
+    {
+        for (uint32_t k = i + 1; k < n; ++k)
+        {
+            x[i] -= a[k * n + i] * x[k];
+        }
+    }
+}
+
+JointTree::JointTree(Allocator* allocator)
+: m_joints(allocator)
+, m_jointIndices(allocator)
+, m_isTree(false)
+, m_nodes(allocator)
+, m_nodeJoints(allocator)
+, m_values(allocator)
+, m_solution(allocator)
+, m_coupling(allocator)
+, m_bodies(allocator)
+, m_bodyOffsets(allocator)
+, m_bodyJoints(allocator)
+, m_stack(allocator)
+, m_order(allocator)
+, m_parentJoints(allocator)
+, m_bodyNodes(allocator)
+{
+}
+
+bool JointTree::Matches(Joint* const* joints, uint32_t jointCount) const
+{
+    if (jointCount != m_joints.size())
+    {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < jointCount; ++i)
+    {
+        if ((joints[i] != m_joints[i]) || (joints[i]->m_index1 != m_jointIndices[2 * i]) || (joints[i]->m_index2 != m_jointIndices[2 * i + 1]))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool JointTree::Analyze(Joint* const* joints, uint32_t jointCount, const SolverBodies& bodies)
+{
+    m_joints.assign(joints, joints + jointCount);
+    m_jointIndices.resize(2 * jointCount);
+    m_bodies.clear();
+    uint32_t connectingCount = 0;
+    for (uint32_t i = 0; i < jointCount; ++i)
+    {
+        m_jointIndices[2 * i] = joints[i]->m_index1;
+        m_jointIndices[2 * i + 1] = joints[i]->m_index2;
+        const bool isDynamic1 = bodies.m_invMasses[m_jointIndices[2 * i]] != 0.0f;
+        const bool isDynamic2 = bodies.m_invMasses[m_jointIndices[2 * i + 1]] != 0.0f;
+        if (isDynamic1)
+        {
+            m_bodies.push_back(m_jointIndices[2 * i]);
+        }
+        if (isDynamic2)
+        {
+            m_bodies.push_back(m_jointIndices[2 * i + 1]);
+        }
+        if (isDynamic1 && isDynamic2)
+        {
+            ++connectingCount;
+        }
+    }
+    std::sort(m_bodies.begin(), m_bodies.end());
+    m_bodies.erase(std::unique(m_bodies.begin(), m_bodies.end()), m_bodies.end());
+
+    // The island is connected, so it is a tree exactly when it has one
+    // joint between dynamic bodies fewer than it has dynamic bodies.
+    const uint32_t bodyCount = static_cast<uint32_t>(m_bodies.size());
+    m_isTree = (connectingCount + 1 == bodyCount);
+    if (!m_isTree)
+    {
+        return false;
+    }
+
+    auto findBody = [this](uint32_t index)
+    {
+        auto it = std::lower_bound(m_bodies.begin(), m_bodies.end(), index);
+        return ((it != m_bodies.end()) && (*it == index)) ? static_cast<uint32_t>(it - m_bodies.begin()) : k_noBody;
+    };
+
+    // Joints of each body.
+    m_bodyOffsets.assign(bodyCount + 1, 0);
+    for (uint32_t i = 0; i < 2 * jointCount; ++i)
+    {
+        const uint32_t body = findBody(m_jointIndices[i]);
+        if (body != k_noBody)
+        {
+            ++m_bodyOffsets[body + 1];
+        }
+    }
+    for (uint32_t i = 0; i < bodyCount; ++i)
+    {
+        m_bodyOffsets[i + 1] += m_bodyOffsets[i];
+    }
+    m_stack.assign(m_bodyOffsets.begin(), m_bodyOffsets.end() - 1);
+    m_bodyJoints.resize(m_bodyOffsets[bodyCount]);
+    for (uint32_t i = 0; i < 2 * jointCount; ++i)
+    {
+        const uint32_t body = findBody(m_jointIndices[i]);
+        if (body != k_noBody)
+        {
+            m_bodyJoints[m_stack[body]++] = i / 2;
+        }
+    }
+
+    auto getOtherBody = [this, &findBody](uint32_t joint, uint32_t body)
+    {
+        const uint32_t index = (m_jointIndices[2 * joint] == m_bodies[body]) ? m_jointIndices[2 * joint + 1] : m_jointIndices[2 * joint];
+        return findBody(index);
+    };
+
+    // Depth first order from the first body, each body after its parent.
+    m_order.clear();
+    m_parentJoints.assign(bodyCount, k_noJoint);
+    m_bodyNodes.assign(bodyCount, k_noNode);
+    m_stack.clear();
+    m_stack.push_back(0);
+    m_bodyNodes[0] = 0;
+    while (!m_stack.empty())
+    {
+        const uint32_t body = m_stack.back();
+        m_stack.pop_back();
+        m_order.push_back(body);
+
+        for (uint32_t i = m_bodyOffsets[body]; i < m_bodyOffsets[body + 1]; ++i)
+        {
+            const uint32_t other = getOtherBody(m_bodyJoints[i], body);
+            if ((other != k_noBody) && (m_bodyNodes[other] == k_noNode))
+            {
+                m_bodyNodes[other] = 0;
+                m_parentJoints[other] = m_bodyJoints[i];
+                m_stack.push_back(other);
+            }
+        }
+    }
+
+    // Children are eliminated before their parents: each body comes after
+    // the bodies below it and before the joint to its parent.
+    m_nodes.clear();
+    m_nodeJoints.clear();
+    for (uint32_t i = bodyCount; i-- > 0;)
+    {
+        const uint32_t body = m_order[i];
+        m_bodyNodes[body] = static_cast<uint32_t>(m_nodes.size());
+
+        JointTreeNode node;
+        node.m_body = m_bodies[body];
+        node.m_jointBegin = static_cast<uint32_t>(m_nodeJoints.size());
+        node.m_size = 6;
+        for (uint32_t j = m_bodyOffsets[body]; j < m_bodyOffsets[body + 1]; ++j)
+        {
+            const uint32_t joint = m_bodyJoints[j];
+            if (getOtherBody(joint, body) == k_noBody)
+            {
+                m_nodeJoints.push_back(joint);
+                node.m_size += joints[joint]->m_rowCount;
+            }
+        }
+        node.m_jointEnd = static_cast<uint32_t>(m_nodeJoints.size());
+        node.m_parent = k_noNode;
+        m_nodes.push_back(node);
+
+        const uint32_t parentJoint = m_parentJoints[body];
+        if (parentJoint != k_noJoint)
+        {
+            m_nodes.back().m_parent = static_cast<uint32_t>(m_nodes.size());
+
+            node.m_body = k_noBody;
+            node.m_jointBegin = static_cast<uint32_t>(m_nodeJoints.size());
+            m_nodeJoints.push_back(parentJoint);
+            node.m_jointEnd = node.m_jointBegin + 1;
+            node.m_size = joints[parentJoint]->m_rowCount;
+            m_nodes.push_back(node);
+        }
+    }
+
+    uint32_t rowBegin = 0;
+    uint32_t valueCount = 0;
+    for (uint32_t i = 0; i < m_nodes.size(); ++i)
+    {
+        JointTreeNode& node = m_nodes[i];
+        if (node.m_body == k_noBody)
+        {
+            const uint32_t joint = m_nodeJoints[node.m_jointBegin];
+            const uint32_t index1 = findBody(m_jointIndices[2 * joint]);
+            const uint32_t index2 = findBody(m_jointIndices[2 * joint + 1]);
+            const uint32_t parentBody = (m_bodyNodes[index1] > i) ? index1 : index2;
+            node.m_parent = m_bodyNodes[parentBody];
+        }
+
+        node.m_rowBegin = rowBegin;
+        rowBegin += node.m_size;
+        node.m_blockOffset = valueCount;
+        valueCount += node.m_size * node.m_size;
+        node.m_couplingOffset = valueCount;
+        if (node.m_parent != k_noNode)
+        {
+            valueCount += node.m_size * m_nodes[node.m_parent].m_size;
+        }
+    }
+    m_values.resize(valueCount);
+    m_solution.resize(rowBegin);
+
+    return true;
+}
+
+void JointTree::Solve(SolverBodies& bodies)
+{
+    // Diagonal blocks and right hand sides. The unknowns of a body are its
+    // velocity changes, with a zero right hand side, followed by the rows of
+    // its joints to static bodies. The unknown of a joint row is its negated
+    // impulse change.
+    for (uint32_t i = 0; i < m_nodes.size(); ++i)
+    {
+        const JointTreeNode& node = m_nodes[i];
+        const uint32_t n = node.m_size;
+        float* block = m_values.data() + node.m_blockOffset;
+        float* solution = m_solution.data() + node.m_rowBegin;
+        std::fill(block, block + n * n, 0.0f);
+        std::fill(solution, solution + n, 0.0f);
+
+        uint32_t rowIndex = 0;
+        if (node.m_body != k_noBody)
+        {
+            // A body that does not turn keeps its angular unknowns apart,
+            // where they solve to zero.
+            const float mass = 1.0f / bodies.m_invMasses[node.m_body];
+            const glm::mat3 inertia = IsRotationFixed(bodies, node.m_body) ? glm::mat3(1.0f) : glm::inverse(bodies.m_invIs[node.m_body]);
+            for (uint32_t j = 0; j < 3; ++j)
+            {
+                block[j * n + j] = mass;
+                for (uint32_t k = 0; k < 3; ++k)
+                {
+                    block[(3 + j) * n + 3 + k] = inertia[k][j];
+                }
+            }
+            rowIndex = 6;
+        }
+
+        for (uint32_t j = node.m_jointBegin; j < node.m_jointEnd; ++j)
+        {
+            const uint32_t joint = m_nodeJoints[j];
+            const uint32_t rowCount = m_joints[joint]->m_rowCount;
+            for (uint32_t r = 0; r < rowCount; ++r, ++rowIndex)
+            {
+                const ConstraintRow& row = m_joints[joint]->m_rows[r];
+                if (node.m_body != k_noBody)
+                {
+                    float jacobian[6];
+                    GetRowJacobian(row, bodies, node.m_body, jacobian);
+                    for (uint32_t k = 0; k < 6; ++k)
+                    {
+                        block[rowIndex * n + k] = jacobian[k];
+                        block[k * n + rowIndex] = jacobian[k];
+                    }
+                }
+                block[rowIndex * n + rowIndex] = -row.m_softness - ((row.m_mass > 0.0f) ? k_compliance / row.m_mass : 0.0f);
+
+                const float jv = glm::dot(row.m_linear, bodies.m_velocities[row.m_index2] - bodies.m_velocities[row.m_index1]) + glm::dot(row.m_angular1, bodies.m_angularVelocities[row.m_index1]) + glm::dot(row.m_angular2, bodies.m_angularVelocities[row.m_index2]);
+                solution[rowIndex] = row.m_bias - jv - row.m_softness * row.m_impulse;
+            }
+        }
+    }
+
+    // Factor and eliminate each node from its parent, leaves first. The
+    // coupling between a joint and a body is the Jacobian of the joint rows
+    // with respect to the body's velocity unknowns. It is kept premultiplied
+    // by the inverse of the child's block, one column per parent unknown.
+    for (uint32_t i = 0; i < m_nodes.size(); ++i)
+    {
+        const JointTreeNode& node = m_nodes[i];
+        const uint32_t n = node.m_size;
+        float* block = m_values.data() + node.m_blockOffset;
+        float* solution = m_solution.data() + node.m_rowBegin;
+        FactorSymmetric(block, n);
+
+        if (node.m_parent == k_noNode)
+        {
+            continue;
+        }
+
+        const JointTreeNode& parent = m_nodes[node.m_parent];
+        const uint32_t m = parent.m_size;
+        const bool isBody = (node.m_body != k_noBody);
+        const uint32_t joint = m_nodeJoints[isBody ? parent.m_jointBegin : node.m_jointBegin];
+        const ConstraintRow* rows = m_joints[joint]->m_rows;
+
+        m_coupling.assign(n * m, 0.0f);
+        for (uint32_t r = 0; r < m_joints[joint]->m_rowCount; ++r)
+        {
+            float jacobian[6];
+            GetRowJacobian(rows[r], bodies, isBody ? node.m_body : parent.m_body, jacobian);
+            for (uint32_t k = 0; k < 6; ++k)
+            {
+                if (isBody)
+                {
+                    m_coupling[r * n + k] = jacobian[k];
+                }
+                else
+                {
+                    m_coupling[k * n + r] = jacobian[k];
+                }
+            }
+        }
+
+        float* coupling = m_values.data() + node.m_couplingOffset;
+        std::copy(m_coupling.begin(), m_coupling.end(), coupling);
+        for (uint32_t c = 0; c < m; ++c)
+        {
+            SolveSymmetric(block, n, coupling + c * n);
+        }
+
+        float* parentBlock = m_values.data() + parent.m_blockOffset;
+        float* parentSolution = m_solution.data() + parent.m_rowBegin;
+        for (uint32_t c = 0; c < m; ++c)
+        {
+            for (uint32_t d = 0; d < m; ++d)
+            {
+                float value = 0.0f;
+                for (uint32_t r = 0; r < n; ++r)
+                {
+                    value += m_coupling[d * n + r] * coupling[c * n + r];
+                }
+                parentBlock[d * m + c] -= value;
+            }
+
+            for (uint32_t r = 0; r < n; ++r)
+            {
+                parentSolution[c] -= coupling[c * n + r] * solution[r];
+            }
+        }
+    }
+
+    // Back substitution, parents first.
+    for (uint32_t i = static_cast<uint32_t>(m_nodes.size()); i-- > 0;)
+    {
+        const JointTreeNode& node = m_nodes[i];
+        const uint32_t n = node.m_size;
+        float* solution = m_solution.data() + node.m_rowBegin;
+        SolveSymmetric(m_values.data() + node.m_blockOffset, n, solution);
+
+        if (node.m_parent != k_noNode)
+        {
+            const JointTreeNode& parent = m_nodes[node.m_parent];
+            const float* coupling = m_values.data() + node.m_couplingOffset;
+            const float* parentSolution = m_solution.data() + parent.m_rowBegin;
+            for (uint32_t c = 0; c < parent.m_size; ++c)
+            {
+                for (uint32_t r = 0; r < n; ++r)
+                {
+                    solution[r] -= coupling[c * n + r] * parentSolution[c];
+                }
+            }
+        }
+    }
+
+    for (uint32_t i = 0; i < m_nodes.size(); ++i)
+    {
+        const JointTreeNode& node = m_nodes[i];
+        const float* solution = m_solution.data() + node.m_rowBegin;
+        uint32_t rowIndex = 0;
+        if (node.m_body != k_noBody)
+        {
+            bodies.m_velocities[node.m_body] += glm::vec3(solution[0], solution[1], solution[2]);
+            bodies.m_angularVelocities[node.m_body] += glm::vec3(solution[3], solution[4], solution[5]);
+            rowIndex = 6;
+        }
+
+        for (uint32_t j = node.m_jointBegin; j < node.m_jointEnd; ++j)
+        {
+            const uint32_t joint = m_nodeJoints[j];
+            const uint32_t rowCount = m_joints[joint]->m_rowCount;
+            for (uint32_t r = 0; r < rowCount; ++r, ++rowIndex)
+            {
+                m_joints[joint]->m_rows[r].m_impulse -= solution[rowIndex];
+            }
+        }
+    }
+}
\ No newline at end of file
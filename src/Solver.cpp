@@ -0,0 +1,517 @@
+#include "Solver.h"
+#include "Arbiter.h"
+#include "Body.h"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+
+struct FloatW
+{
+    __m256 m_value;
+};
+
+inline FloatW Load(const float* values) { return {_mm256_loadu_ps(values)}; }
+inline void Store(float* values, FloatW a) { _mm256_storeu_ps(values, a.m_value); }
+inline FloatW Splat(float value) { return {_mm256_set1_ps(value)}; }
+inline FloatW operator+(FloatW a, FloatW b) { return {_mm256_add_ps(a.m_value, b.m_value)}; }
+inline FloatW operator-(FloatW a, FloatW b) { return {_mm256_sub_ps(a.m_value, b.m_value)}; }
+inline FloatW operator*(FloatW a, FloatW b) { return {_mm256_mul_ps(a.m_value, b.m_value)}; }
+inline FloatW operator-(FloatW a) { return {_mm256_xor_ps(a.m_value, _mm256_set1_ps(-0.0f))}; }
+inline FloatW Min(FloatW a, FloatW b) { return {_mm256_min_ps(a.m_value, b.m_value)}; }
+inline FloatW Max(FloatW a, FloatW b) { return {_mm256_max_ps(a.m_value, b.m_value)}; }
+inline FloatW Abs(FloatW a) { return {_mm256_andnot_ps(_mm256_set1_ps(-0.0f), a.m_value)}; }
+inline FloatW Less(FloatW a, FloatW b) { return {_mm256_cmp_ps(a.m_value, b.m_value, _CMP_LT_OQ)}; }
+inline FloatW Select(FloatW mask, FloatW a, FloatW b) { return {_mm256_blendv_ps(b.m_value, a.m_value, mask.m_value)}; }
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#include <emmintrin.h>
+
+struct FloatW
+{
+    __m128 m_value;
+};
+
+inline FloatW Load(const float* values) { return {_mm_loadu_ps(values)}; }
+inline void Store(float* values, FloatW a) { _mm_storeu_ps(values, a.m_value); }
+inline FloatW Splat(float value) { return {_mm_set1_ps(value)}; }
+inline FloatW operator+(FloatW a, FloatW b) { return {_mm_add_ps(a.m_value, b.m_value)}; }
+inline FloatW operator-(FloatW a, FloatW b) { return {_mm_sub_ps(a.m_value, b.m_value)}; }
+inline FloatW operator*(FloatW a, FloatW b) { return {_mm_mul_ps(a.m_value, b.m_value)}; }
+inline FloatW operator-(FloatW a) { return {_mm_xor_ps(a.m_value, _mm_set1_ps(-0.0f))}; }
+inline FloatW Min(FloatW a, FloatW b) { return {_mm_min_ps(a.m_value, b.m_value)}; }
+inline FloatW Max(FloatW a, FloatW b) { return {_mm_max_ps(a.m_value, b.m_value)}; }
+inline FloatW Abs(FloatW a) { return {_mm_andnot_ps(_mm_set1_ps(-0.0f), a.m_value)}; }
+inline FloatW Less(FloatW a, FloatW b) { return {_mm_cmplt_ps(a.m_value, b.m_value)}; }
+inline FloatW Select(FloatW mask, FloatW a, FloatW b) { return {_mm_or_ps(_mm_and_ps(mask.m_value, a.m_value), _mm_andnot_ps(mask.m_value, b.m_value))}; }
+#else
+struct FloatW
+{
+    float m_value[g_simdWidth];
+};
+
+inline FloatW Load(const float* values) { FloatW r; for (size_t i = 0; i < g_simdWidth; ++i) r.m_value[i] = values[i]; return r; }
+inline void Store(float* values, FloatW a) { for (size_t i = 0; i < g_simdWidth; ++i) values[i] = a.m_value[i]; }
+inline FloatW Splat(float value) { FloatW r; for (size_t i = 0; i < g_simdWidth; ++i) r.m_value[i] = value; return r; }
+inline FloatW operator+(FloatW a, FloatW b) { for (size_t i = 0; i < g_simdWidth; ++i) a.m_value[i] += b.m_value[i]; return a; }
+inline FloatW operator-(FloatW a, FloatW b) { for (size_t i = 0; i < g_simdWidth; ++i) a.m_value[i] -= b.m_value[i]; return a; }
+inline FloatW operator*(FloatW a, FloatW b) { for (size_t i = 0; i < g_simdWidth; ++i) a.m_value[i] *= b.m_value[i]; return a; }
+inline FloatW operator-(FloatW a) { for (size_t i = 0; i < g_simdWidth; ++i) a.m_value[i] = -a.m_value[i]; return a; }
+inline FloatW Min(FloatW a, FloatW b) { for (size_t i = 0; i < g_simdWidth; ++i) a.m_value[i] = std::min(a.m_value[i], b.m_value[i]); return a; }
+inline FloatW Max(FloatW a, FloatW b) { for (size_t i = 0; i < g_simdWidth; ++i) a.m_value[i] = std::max(a.m_value[i], b.m_value[i]); return a; }
+inline FloatW Abs(FloatW a) { for (size_t i = 0; i < g_simdWidth; ++i) a.m_value[i] = std::abs(a.m_value[i]); return a; }
+inline FloatW Less(FloatW a, FloatW b) { for (size_t i = 0; i < g_simdWidth; ++i) a.m_value[i] = (a.m_value[i] < b.m_value[i]) ? 1.0f : 0.0f; return a; }
+inline FloatW Select(FloatW mask, FloatW a, FloatW b) { for (size_t i = 0; i < g_simdWidth; ++i) a.m_value[i] = (mask.m_value[i] != 0.0f) ? a.m_value[i] : b.m_value[i]; return a; }
+#endif
+
+struct Vec3W
+{
+    FloatW x;
+    FloatW y;
+    FloatW z;
+};
+
+inline Vec3W operator+(const Vec3W& a, const Vec3W& b) { return {a.x + b.x, a.y + b.y, a.z + b.z}; }
+inline Vec3W operator-(const Vec3W& a, const Vec3W& b) { return {a.x - b.x, a.y - b.y, a.z - b.z}; }
+inline Vec3W operator*(const Vec3W& a, FloatW b) { return {a.x * b, a.y * b, a.z * b}; }
+inline FloatW Dot(const Vec3W& a, const Vec3W& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+inline Vec3W Load(const float (&values)[3][g_simdWidth]) { return {Load(values[0]), Load(values[1]), Load(values[2])}; }
+
+Vec3W Gather(const Vector<glm::vec3>& values, const uint32_t* indices)
+{
+    float x[g_simdWidth];
+    float y[g_simdWidth];
+    float z[g_simdWidth];
+    for (size_t lane = 0; lane < g_simdWidth; ++lane)
+    {
+        const glm::vec3& value = values[indices[lane]];
+        x[lane] = value.x;
+        y[lane] = value.y;
+        z[lane] = value.z;
+    }
+    return {Load(x), Load(y), Load(z)};
+}
+
+void Scatter(Vector<glm::vec3>& values, const uint32_t* indices, const Vec3W& value)
+{
+    float x[g_simdWidth];
+    float y[g_simdWidth];
+    float z[g_simdWidth];
+    Store(x, value.x);
+    Store(y, value.y);
+    Store(z, value.z);
+    for (size_t lane = 0; lane < g_simdWidth; ++lane)
+    {
+        values[indices[lane]] = glm::vec3(x[lane], y[lane], z[lane]);
+    }
+}
+
+SolverBodies::SolverBodies(Allocator* allocator)
+: m_velocities(allocator)
+, m_angularVelocities(allocator)
+, m_pseudoVelocities(allocator)
+, m_pseudoAngularVelocities(allocator)
+, m_invMasses(allocator)
+, m_invIs(allocator)
+, m_deltaPositions(allocator)
+, m_deltaRotations(allocator)
+, m_accelerations(allocator)
+, m_angularAccelerations(allocator)
+, m_linearDampings(allocator)
+, m_angularDampings(allocator)
+{
+}
+
+void SolverBodies::Stage(const BodyState* states, size_t bodyCount)
+{
+    m_velocities.resize(bodyCount + 1);
+    m_angularVelocities.resize(bodyCount + 1);
+    m_invMasses.resize(bodyCount + 1);
+    m_invIs.resize(bodyCount + 1);
+    m_pseudoVelocities.assign(bodyCount + 1, glm::vec3(0.0f, 0.0f, 0.0f));
+    m_pseudoAngularVelocities.assign(bodyCount + 1, glm::vec3(0.0f, 0.0f, 0.0f));
+    m_deltaPositions.assign(bodyCount + 1, glm::vec3(0.0f, 0.0f, 0.0f));
+    m_deltaRotations.assign(bodyCount + 1, glm::quat(1.0f, 0.0f, 0.0f, 0.0f));
+
+    for (size_t i = 0; i < bodyCount; ++i)
+    {
+        m_velocities[i] = states[i].m_velocity;
+        m_angularVelocities[i] = states[i].m_angularVelocity;
+        m_invMasses[i] = states[i].m_invMass;
+    }
+
+    m_velocities[bodyCount] = glm::vec3(0.0f, 0.0f, 0.0f);
+    m_angularVelocities[bodyCount] = glm::vec3(0.0f, 0.0f, 0.0f);
+    m_invMasses[bodyCount] = 0.0f;
+    m_invIs[bodyCount] = glm::mat3(0.0f);
+}
+
+void SolverBodies::WriteBack(BodyState* states, size_t bodyCount) const
+{
+    for (size_t i = 0; i < bodyCount; ++i)
+    {
+        if (states[i].m_invMass == 0.0f)
+        {
+            continue;
+        }
+
+        states[i].m_velocity = m_velocities[i];
+        states[i].m_angularVelocity = m_angularVelocities[i];
+    }
+}
+
+void SolverBodies::StageForces(const BodyState* states, size_t bodyCount, const glm::vec3& gravity)
+{
+    m_accelerations.assign(bodyCount + 1, glm::vec3(0.0f, 0.0f, 0.0f));
+    m_angularAccelerations.assign(bodyCount + 1, glm::vec3(0.0f, 0.0f, 0.0f));
+    m_linearDampings.assign(bodyCount + 1, 0.0f);
+    m_angularDampings.assign(bodyCount + 1, 0.0f);
+
+    for (size_t i = 0; i < bodyCount; ++i)
+    {
+        const BodyState& s = states[i];
+
+        if (s.m_invMass == 0.0f)
+        {
+            continue;
+        }
+
+        m_accelerations[i] = s.m_invMass * s.m_force;
+        if (s.m_useGravity)
+        {
+            m_accelerations[i] += gravity;
+        }
+        m_angularAccelerations[i] = m_invIs[i] * s.m_torque;
+        m_linearDampings[i] = s.m_linearDamping;
+        m_angularDampings[i] = s.m_angularDamping;
+    }
+}
+
+void SolverBodies::IntegrateVelocities(uint32_t begin, uint32_t end, float timeStep)
+{
+    for (uint32_t i = begin; i < end; ++i)
+    {
+        if (m_invMasses[i] == 0.0f)
+        {
+            continue;
+        }
+
+        m_velocities[i] += timeStep * m_accelerations[i];
+        m_angularVelocities[i] += timeStep * m_angularAccelerations[i];
+
+        m_velocities[i] *= std::pow(1.0f - m_linearDampings[i], timeStep);
+        m_angularVelocities[i] *= std::pow(1.0f - m_angularDampings[i], timeStep);
+    }
+}
+
+void SolverBodies::IntegratePositions(uint32_t begin, uint32_t end, float timeStep)
+{
+    for (uint32_t i = begin; i < end; ++i)
+    {
+        if (m_invMasses[i] == 0.0f)
+        {
+            continue;
+        }
+
+        m_deltaPositions[i] += timeStep * m_velocities[i];
+        m_deltaRotations[i] = glm::normalize(glm::quat(timeStep * m_angularVelocities[i]) * m_deltaRotations[i]);
+    }
+}
+
+Softness MakeSoftness(float hertz, float dampingRatio, float timeStep)
+{
+    Softness softness;
+
+    if (hertz == 0.0f)
+    {
+        softness.m_biasRate = 0.0f;
+        softness.m_massScale = 1.0f;
+        softness.m_impulseScale = 0.0f;
+        return softness;
+    }
+
+    const float omega = 2.0f * glm::pi<float>() * hertz;
+    const float a1 = 2.0f * dampingRatio + timeStep * omega;
+    const float a2 = timeStep * omega * a1;
+    const float a3 = 1.0f / (1.0f + a2);
+    softness.m_biasRate = omega / a1;
+    softness.m_massScale = a2 * a3;
+    softness.m_impulseScale = a3;
+    return softness;
+}
+
+void PrepareBatchRow(ContactBatchRow& row, size_t lane, const glm::vec3& direction, const Contact* c, const glm::mat3& invI1, const glm::mat3& invI2, float mass, float impulse)
+{
+    const glm::vec3 angular1 = glm::cross(c->m_r1, direction);
+    const glm::vec3 angular2 = glm::cross(c->m_r2, direction);
+    const glm::vec3 response1 = invI1 * angular1;
+    const glm::vec3 response2 = invI2 * angular2;
+
+    for (size_t axis = 0; axis < 3; ++axis)
+    {
+        row.m_direction[axis][lane] = direction[axis];
+        row.m_angular1[axis][lane] = angular1[axis];
+        row.m_angular2[axis][lane] = angular2[axis];
+        row.m_response1[axis][lane] = response1[axis];
+        row.m_response2[axis][lane] = response2[axis];
+    }
+    row.m_mass[lane] = mass;
+    row.m_impulse[lane] = impulse;
+}
+
+// Colors of the wide solver. Arbiters that find none free go to the
+// overflow, which is solved one at a time.
+constexpr uint32_t k_colorCount = 64;
+
+WideContactSolver::WideContactSolver(Allocator* allocator)
+: m_batches(allocator)
+, m_colorOffsets(allocator)
+, m_overflow(allocator)
+, m_bodyColors(allocator)
+, m_arbiterColors(allocator)
+, m_colorCounts(allocator)
+, m_sortedArbiters(allocator)
+{
+}
+
+void WideContactSolver::Reserve(size_t bodyCount, size_t arbiterCount)
+{
+    // Every color but the overflow ends in at most one partial batch.
+    m_batches.reserve(arbiterCount / g_simdWidth + k_colorCount);
+    m_colorOffsets.reserve(k_colorCount + 1);
+    m_overflow.reserve(arbiterCount);
+    m_bodyColors.reserve(bodyCount);
+    m_arbiterColors.reserve(arbiterCount);
+    m_colorCounts.reserve(k_colorCount + 1);
+    m_sortedArbiters.reserve(arbiterCount);
+}
+
+void WideContactSolver::Prepare(Arbiter* const* arbiters, size_t arbiterCount, const SolverBodies& bodies)
+{
+    // Greedy coloring: each arbiter takes the lowest color that neither of
+    // its dynamic bodies uses yet. Static bodies never conflict since the
+    // solver does not change their velocities.
+    m_bodyColors.assign(bodies.m_velocities.size(), 0);
+    m_arbiterColors.resize(arbiterCount);
+    m_colorCounts.assign(k_colorCount + 1, 0);
+    m_overflow.clear();
+
+    for (size_t i = 0; i < arbiterCount; ++i)
+    {
+        const Arbiter* arb = arbiters[i];
+        const bool isDynamic1 = bodies.m_invMasses[arb->m_index1] != 0.0f;
+        const bool isDynamic2 = bodies.m_invMasses[arb->m_index2] != 0.0f;
+
+        uint64_t usedColors = 0;
+        if (isDynamic1)
+        {
+            usedColors |= m_bodyColors[arb->m_index1];
+        }
+        if (isDynamic2)
+        {
+            usedColors |= m_bodyColors[arb->m_index2];
+        }
+
+        uint32_t color = 0;
+        while ((color < k_colorCount) && (usedColors & (uint64_t(1) << color)))
+        {
+            ++color;
+        }
+
+        if (color < k_colorCount)
+        {
+            if (isDynamic1)
+            {
+                m_bodyColors[arb->m_index1] |= uint64_t(1) << color;
+            }
+            if (isDynamic2)
+            {
+                m_bodyColors[arb->m_index2] |= uint64_t(1) << color;
+            }
+        }
+
+        m_arbiterColors[i] = color;
+        ++m_colorCounts[color];
+    }
+
+    // Counting sort of the arbiters by color.
+    Vector<uint32_t>& colorStarts = m_colorCounts;
+    uint32_t offset = 0;
+    for (uint32_t color = 0; color <= k_colorCount; ++color)
+    {
+        const uint32_t count = colorStarts[color];
+        colorStarts[color] = offset;
+        offset += count;
+    }
+
+    m_sortedArbiters.resize(arbiterCount);
+    for (size_t i = 0; i < arbiterCount; ++i)
+    {
+        m_sortedArbiters[colorStarts[m_arbiterColors[i]]++] = arbiters[i];
+    }
+
+    // colorStarts now holds the end of each color.
+    m_batches.clear();
+    m_colorOffsets.clear();
+    const uint32_t nullIndex = bodies.GetNullIndex();
+    uint32_t colorBegin = 0;
+    for (uint32_t color = 0; color < k_colorCount; ++color)
+    {
+        const uint32_t colorEnd = colorStarts[color];
+        m_colorOffsets.push_back(static_cast<uint32_t>(m_batches.size()));
+
+        for (uint32_t first = colorBegin; first < colorEnd; first += g_simdWidth)
+        {
+            m_batches.push_back(ContactBatch());
+            ContactBatch& batch = m_batches.back();
+            batch.m_pointCount = 0;
+
+            for (size_t lane = 0; lane < g_simdWidth; ++lane)
+            {
+                if (first + lane >= colorEnd)
+                {
+                    batch.m_index1[lane] = nullIndex;
+                    batch.m_index2[lane] = nullIndex;
+                    continue;
+                }
+
+                Arbiter* arb = m_sortedArbiters[first + lane];
+                const glm::mat3& invI1 = bodies.m_invIs[arb->m_index1];
+                const glm::mat3& invI2 = bodies.m_invIs[arb->m_index2];
+
+                batch.m_index1[lane] = arb->m_index1;
+                batch.m_index2[lane] = arb->m_index2;
+                batch.m_invMass1[lane] = bodies.m_invMasses[arb->m_index1];
+                batch.m_invMass2[lane] = bodies.m_invMasses[arb->m_index2];
+                batch.m_staticFriction[lane] = arb->m_staticFriction;
+                batch.m_dynamicFriction[lane] = arb->m_dynamicFriction;
+                batch.m_pointCount = std::max(batch.m_pointCount, arb->m_contactCount);
+
+                for (size_t k = 0; k < arb->m_contactCount; ++k)
+                {
+                    Contact* c = arb->m_contacts + k;
+                    ContactBatchPoint& point = batch.m_points[k];
+                    point.m_contacts[lane] = c;
+                    point.m_bias[lane] = c->m_bias;
+                    PrepareBatchRow(point.m_rows[0], lane, c->m_normal, c, invI1, invI2, c->m_massNormal, c->m_Pn);
+                    PrepareBatchRow(point.m_rows[1], lane, c->m_tangent, c, invI1, invI2, c->m_massTangent, c->m_Pt);
+                    PrepareBatchRow(point.m_rows[2], lane, c->m_bitangent, c, invI1, invI2, c->m_massBitangent, c->m_Pb);
+                }
+            }
+        }
+
+        colorBegin = colorEnd;
+    }
+    m_colorOffsets.push_back(static_cast<uint32_t>(m_batches.size()));
+
+    for (uint32_t i = colorBegin; i < colorStarts[k_colorCount]; ++i)
+    {
+        m_overflow.push_back(m_sortedArbiters[i]);
+    }
+}
+
+float ApplyBatchImpulse(ContactBatch& batch, SolverBodies& bodies)
+{
+    Vec3W v1 = Gather(bodies.m_velocities, batch.m_index1);
+    Vec3W w1 = Gather(bodies.m_angularVelocities, batch.m_index1);
+    Vec3W v2 = Gather(bodies.m_velocities, batch.m_index2);
+    Vec3W w2 = Gather(bodies.m_angularVelocities, batch.m_index2);
+    const FloatW invMass1 = Load(batch.m_invMass1);
+    const FloatW invMass2 = Load(batch.m_invMass2);
+    const FloatW staticFriction = Load(batch.m_staticFriction);
+    const FloatW dynamicFriction = Load(batch.m_dynamicFriction);
+    const FloatW zero = Splat(0.0f);
+    const FloatW velocityThreshold = Splat(g_velocityThreshold);
+    FloatW residual = zero;
+
+    for (size_t k = 0; k < batch.m_pointCount; ++k)
+    {
+        ContactBatchPoint& point = batch.m_points[k];
+
+        // Normal impulse, clamped to push only.
+        ContactBatchRow& normalRow = point.m_rows[0];
+        const Vec3W normal = Load(normalRow.m_direction);
+        const FloatW vn = Dot(v2 - v1, normal) + Dot(w2, Load(normalRow.m_angular2)) - Dot(w1, Load(normalRow.m_angular1));
+        const FloatW Pn0 = Load(normalRow.m_impulse);
+        const FloatW Pn = Max(Pn0 + Load(normalRow.m_mass) * (Load(point.m_bias) - vn), zero);
+        const FloatW dPn = Pn - Pn0;
+        Store(normalRow.m_impulse, Pn);
+        residual = Max(residual, Abs(dPn));
+
+        v1 = v1 - normal * (invMass1 * dPn);
+        w1 = w1 - Load(normalRow.m_response1) * dPn;
+        v2 = v2 + normal * (invMass2 * dPn);
+        w2 = w2 + Load(normalRow.m_response2) * dPn;
+
+        // Friction impulses, clamped to the friction cone.
+        for (size_t r = 1; r < 3; ++r)
+        {
+            ContactBatchRow& row = point.m_rows[r];
+            const Vec3W direction = Load(row.m_direction);
+            const FloatW vt = Dot(v2 - v1, direction) + Dot(w2, Load(row.m_angular2)) - Dot(w1, Load(row.m_angular1));
+            const FloatW friction = Select(Less(Abs(vt), velocityThreshold), staticFriction, dynamicFriction);
+            const FloatW maxPt = friction * Pn;
+            const FloatW Pt0 = Load(row.m_impulse);
+            const FloatW Pt = Min(Max(Pt0 - Load(row.m_mass) * vt, -maxPt), maxPt);
+            const FloatW dPt = Pt - Pt0;
+            Store(row.m_impulse, Pt);
+            residual = Max(residual, Abs(dPt));
+
+            v1 = v1 - direction * (invMass1 * dPt);
+            w1 = w1 - Load(row.m_response1) * dPt;
+            v2 = v2 + direction * (invMass2 * dPt);
+            w2 = w2 + Load(row.m_response2) * dPt;
+        }
+    }
+
+    Scatter(bodies.m_velocities, batch.m_index1, v1);
+    Scatter(bodies.m_angularVelocities, batch.m_index1, w1);
+    Scatter(bodies.m_velocities, batch.m_index2, v2);
+    Scatter(bodies.m_angularVelocities, batch.m_index2, w2);
+
+    float lanes[g_simdWidth];
+    Store(lanes, residual);
+    float maxResidual = 0.0f;
+    for (size_t lane = 0; lane < g_simdWidth; ++lane)
+    {
+        maxResidual = std::max(maxResidual, lanes[lane]);
+    }
+    return maxResidual;
+}
+
+float WideContactSolver::ApplyImpulses(SolverBodies& bodies)
+{
+    float residual = 0.0f;
+
+    for (size_t i = 0; i < m_batches.size(); ++i)
+    {
+        residual = std::max(residual, ApplyBatchImpulse(m_batches[i], bodies));
+    }
+
+    for (size_t i = 0; i < m_overflow.size(); ++i)
+    {
+        residual = std::max(residual, m_overflow[i]->ApplyImpulse(bodies));
+    }
+
+    return residual;
+}
+
+void WideContactSolver::StoreImpulses() const
+{
+    for (size_t i = 0; i < m_batches.size(); ++i)
+    {
+        const ContactBatch& batch = m_batches[i];
+        for (size_t k = 0; k < batch.m_pointCount; ++k)
+        {
+            const ContactBatchPoint& point = batch.m_points[k];
+            for (size_t lane = 0; lane < g_simdWidth; ++lane)
+            {
+                Contact* c = point.m_contacts[lane];
+                if (c)
+                {
+                    c->m_Pn = point.m_rows[0].m_impulse[lane];
+                    c->m_Pt = point.m_rows[1].m_impulse[lane];
+                    c->m_Pb = point.m_rows[2].m_impulse[lane];
+                }
+            }
+        }
+    }
+}
\ No newline at end of file
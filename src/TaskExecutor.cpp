@@ -0,0 +1,85 @@
+#include "TaskExecutor.h"
+#include <algorithm>
+#include <cassert>
+
+TaskGraph::TaskGraph(Allocator* allocator)
+: m_tasks(allocator)
+, m_dependencies(allocator)
+{
+}
+
+uint32_t TaskGraph::AddTask(TaskFunction function, void* context, uint32_t count, uint32_t grainSize)
+{
+    Task task;
+    task.m_function = function;
+    task.m_context = context;
+    task.m_count = count;
+    task.m_grainSize = grainSize;
+    m_tasks.push_back(task);
+    return static_cast<uint32_t>(m_tasks.size() - 1);
+}
+
+void TaskGraph::AddDependency(uint32_t task, uint32_t successor)
+{
+    assert((task < m_tasks.size()) && (successor < m_tasks.size()));
+
+    TaskDependency dependency;
+    dependency.m_task = task;
+    dependency.m_successor = successor;
+    m_dependencies.push_back(dependency);
+}
+
+void TaskGraph::Clear()
+{
+    m_tasks.clear();
+    m_dependencies.clear();
+}
+
+void TaskExecutor::Run(const TaskGraph& graph)
+{
+    m_pendingDependencies.assign(graph.m_tasks.size(), 0);
+    for (size_t i = 0; i < graph.m_dependencies.size(); ++i)
+    {
+        ++m_pendingDependencies[graph.m_dependencies[i].m_successor];
+    }
+
+    m_readyTasks.clear();
+    for (uint32_t i = 0; i < graph.m_tasks.size(); ++i)
+    {
+        if (m_pendingDependencies[i] == 0)
+        {
+            m_readyTasks.push_back(i);
+        }
+    }
+
+    for (size_t next = 0; next < m_readyTasks.size(); ++next)
+    {
+        const uint32_t taskIndex = m_readyTasks[next];
+        const Task& task = graph.m_tasks[taskIndex];
+        ParallelFor(task.m_count, task.m_grainSize, task.m_function, task.m_context);
+
+        for (size_t i = 0; i < graph.m_dependencies.size(); ++i)
+        {
+            const TaskDependency& dependency = graph.m_dependencies[i];
+            if ((dependency.m_task == taskIndex) && (--m_pendingDependencies[dependency.m_successor] == 0))
+            {
+                m_readyTasks.push_back(dependency.m_successor);
+            }
+        }
+    }
+
+    assert((m_readyTasks.size() == graph.m_tasks.size()) && "Task graph has a cycle");
+}
+
+uint32_t SerialTaskExecutor::GetWorkerCount() const
+{
+    return 1;
+}
+
+void SerialTaskExecutor::ParallelFor(uint32_t count, uint32_t, TaskFunction function, void* context)
+{
+    if (count > 0)
+    {
+        function(context, 0, count, 0);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,309 @@
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cassert>
+
+ThreadPool::ThreadPool(uint32_t threadCount)
+: m_function(nullptr)
+, m_context(nullptr)
+, m_count(0)
+, m_grainSize(1)
+, m_busyThreads(0)
+, m_generation(0)
+, m_quit(false)
+, m_graph(nullptr)
+, m_readyBegin(0)
+, m_unfinishedTasks(0)
+, m_runningRanges(0)
+{
+    if (threadCount == 0)
+    {
+        threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+
+    m_queues.reset(new WorkStealingQueue[threadCount]);
+    for (uint32_t i = 0; i < threadCount; ++i)
+    {
+        m_queues[i].m_begin = 0;
+        m_queues[i].m_end = 0;
+    }
+
+    for (uint32_t i = 1; i < threadCount; ++i)
+    {
+        m_threads.emplace_back(&ThreadPool::WorkerMain, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_quit = true;
+    }
+    m_wakeCondition.notify_all();
+
+    for (size_t i = 0; i < m_threads.size(); ++i)
+    {
+        m_threads[i].join();
+    }
+}
+
+uint32_t ThreadPool::GetWorkerCount() const
+{
+    return static_cast<uint32_t>(m_threads.size() + 1);
+}
+
+void ThreadPool::ParallelFor(uint32_t count, uint32_t grainSize, TaskFunction function, void* context)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    grainSize = std::max(grainSize, 1u);
+    const uint32_t rangeCount = (count + grainSize - 1) / grainSize;
+    if ((rangeCount == 1) || m_threads.empty())
+    {
+        function(context, 0, count, 0);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_function = function;
+        m_context = context;
+        m_count = count;
+        m_grainSize = grainSize;
+
+        const uint32_t workerCount = GetWorkerCount();
+        for (uint32_t i = 0; i < workerCount; ++i)
+        {
+            std::lock_guard<std::mutex> queueLock(m_queues[i].m_mutex);
+            m_queues[i].m_begin = static_cast<uint32_t>((uint64_t(rangeCount) * i) / workerCount);
+            m_queues[i].m_end = static_cast<uint32_t>((uint64_t(rangeCount) * (i + 1)) / workerCount);
+        }
+
+        m_busyThreads = static_cast<uint32_t>(m_threads.size());
+        ++m_generation;
+    }
+    m_wakeCondition.notify_all();
+
+    RunRanges(0);
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_doneCondition.wait(lock, [this] { return m_busyThreads == 0; });
+}
+
+static uint32_t GetRangeCount(const Task& task)
+{
+    const uint32_t grainSize = std::max(task.m_grainSize, 1u);
+    return (task.m_count + grainSize - 1) / grainSize;
+}
+
+void ThreadPool::Run(const TaskGraph& graph)
+{
+    if (m_threads.empty())
+    {
+        TaskExecutor::Run(graph);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_graph = &graph;
+
+        const size_t taskCount = graph.m_tasks.size();
+        m_pendingDependencies.assign(taskCount, 0);
+        for (size_t i = 0; i < graph.m_dependencies.size(); ++i)
+        {
+            ++m_pendingDependencies[graph.m_dependencies[i].m_successor];
+        }
+
+        m_nextRanges.assign(taskCount, 0);
+        m_unfinishedRanges.resize(taskCount);
+        for (size_t i = 0; i < taskCount; ++i)
+        {
+            m_unfinishedRanges[i] = GetRangeCount(graph.m_tasks[i]);
+        }
+
+        m_readyTasks.clear();
+        m_readyBegin = 0;
+        m_unfinishedTasks = static_cast<uint32_t>(taskCount);
+        for (uint32_t i = 0; i < taskCount; ++i)
+        {
+            if (m_pendingDependencies[i] == 0)
+            {
+                MakeReady(i);
+            }
+        }
+
+        m_busyThreads = static_cast<uint32_t>(m_threads.size());
+        ++m_generation;
+    }
+    m_wakeCondition.notify_all();
+
+    RunGraph(0);
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_doneCondition.wait(lock, [this] { return m_busyThreads == 0; });
+    m_graph = nullptr;
+}
+
+void ThreadPool::RunGraph(uint32_t workerIndex)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    for (;;)
+    {
+        while ((m_readyBegin < m_readyTasks.size()) && (m_nextRanges[m_readyTasks[m_readyBegin]] == GetRangeCount(m_graph->m_tasks[m_readyTasks[m_readyBegin]])))
+        {
+            ++m_readyBegin;
+        }
+
+        if (m_unfinishedTasks == 0)
+        {
+            return;
+        }
+
+        // The remaining ranges are running elsewhere, and finishing them
+        // may make more tasks ready.
+        if (m_readyBegin == m_readyTasks.size())
+        {
+            assert((m_runningRanges > 0) && "Task graph has a cycle");
+            m_graphCondition.wait(lock);
+            continue;
+        }
+
+        const uint32_t taskIndex = m_readyTasks[m_readyBegin];
+        const Task& task = m_graph->m_tasks[taskIndex];
+        const uint32_t grainSize = std::max(task.m_grainSize, 1u);
+        const uint32_t begin = m_nextRanges[taskIndex]++ * grainSize;
+        const uint32_t end = std::min(begin + grainSize, task.m_count);
+        ++m_runningRanges;
+
+        lock.unlock();
+        task.m_function(task.m_context, begin, end, workerIndex);
+        lock.lock();
+
+        --m_runningRanges;
+        if (--m_unfinishedRanges[taskIndex] == 0)
+        {
+            FinishTask(taskIndex);
+            m_graphCondition.notify_all();
+        }
+    }
+}
+
+void ThreadPool::MakeReady(uint32_t taskIndex)
+{
+    // A task without items is done as soon as it is ready.
+    if (m_unfinishedRanges[taskIndex] == 0)
+    {
+        FinishTask(taskIndex);
+        return;
+    }
+
+    m_readyTasks.push_back(taskIndex);
+}
+
+void ThreadPool::FinishTask(uint32_t taskIndex)
+{
+    --m_unfinishedTasks;
+
+    for (size_t i = 0; i < m_graph->m_dependencies.size(); ++i)
+    {
+        const TaskDependency& dependency = m_graph->m_dependencies[i];
+        if ((dependency.m_task == taskIndex) && (--m_pendingDependencies[dependency.m_successor] == 0))
+        {
+            MakeReady(dependency.m_successor);
+        }
+    }
+}
+
+void ThreadPool::WorkerMain(uint32_t workerIndex)
+{
+    uint64_t generation = 0;
+
+    for (;;)
+    {
+        bool runGraph;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wakeCondition.wait(lock, [this, generation] { return m_quit || (m_generation != generation); });
+
+            if (m_quit)
+            {
+                return;
+            }
+
+            generation = m_generation;
+            runGraph = (m_graph != nullptr);
+        }
+
+        if (runGraph)
+        {
+            RunGraph(workerIndex);
+        }
+        else
+        {
+            RunRanges(workerIndex);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (--m_busyThreads == 0)
+            {
+                m_doneCondition.notify_one();
+            }
+        }
+    }
+}
+
+void ThreadPool::RunRanges(uint32_t workerIndex)
+{
+    const uint32_t workerCount = GetWorkerCount();
+
+    for (;;)
+    {
+        uint32_t range;
+        bool found = m_queues[workerIndex].PopFront(range);
+        for (uint32_t i = 1; (i < workerCount) && !found; ++i)
+        {
+            found = m_queues[(workerIndex + i) % workerCount].StealBack(range);
+        }
+
+        // Nothing is added to the queues while a ParallelFor runs, so empty
+        // queues everywhere mean this worker is done.
+        if (!found)
+        {
+            return;
+        }
+
+        const uint32_t begin = range * m_grainSize;
+        const uint32_t end = std::min(begin + m_grainSize, m_count);
+        m_function(m_context, begin, end, workerIndex);
+    }
+}
+
+bool WorkStealingQueue::PopFront(uint32_t& range)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_begin == m_end)
+    {
+        return false;
+    }
+
+    range = m_begin++;
+    return true;
+}
+
+bool WorkStealingQueue::StealBack(uint32_t& range)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_begin == m_end)
+    {
+        return false;
+    }
+
+    range = --m_end;
+    return true;
+}
\ No newline at end of file
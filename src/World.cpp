@@ -1,6 +1,23 @@
 #include "World.h"
 #include "Body.h"
 #include "Joint.h"
+#include <cmath>
+
+constexpr uint32_t k_maxTimeOfImpactSubSteps = 4;
+constexpr uint32_t k_maxTimeOfImpactSamples = 64;
+constexpr uint32_t k_timeOfImpactBisections = 12;
+constexpr uint32_t k_bodyGrainSize = 64;
+constexpr uint32_t k_pairFindingGrainSize = 4;
+constexpr uint32_t k_narrowPhaseGrainSize = 16;
+constexpr uint32_t k_constraintGrainSize = 64;
+
+WorldWorker::WorldWorker(Allocator* allocator)
+: m_bvhPairs(allocator)
+, m_bvhStack(allocator)
+, m_shapePairs(allocator)
+, m_arbiters(allocator)
+{
+}
 
 uint64_t ComputeArbiterKey(Shape* s1, Shape* s2)
 {
@@ -14,22 +31,197 @@ uint64_t ComputeArbiterKey(Shape* s1, Shape* s2)
     }
 }
 
-World::World(glm::vec3 gravity, uint32_t iterations)
+bool HaveSameValues(const Material& material1, const Material& material2)
+{
+    return (material1.m_staticFriction == material2.m_staticFriction) &&
+           (material1.m_dynamicFriction == material2.m_dynamicFriction) &&
+           (material1.m_restitution == material2.m_restitution) &&
+           (material1.m_frictionCombineMode == material2.m_frictionCombineMode) &&
+           (material1.m_restitutionCombineMode == material2.m_restitutionCombineMode);
+}
+
+World::World(glm::vec3 gravity, uint32_t iterations, Allocator* allocator)
 : m_gravity(gravity)
 , m_iterations(iterations)
+, m_useSpeculativeContacts(false)
+, m_solverType(SolverType::Sequential)
+, m_useBlockSolver(false)
+, m_useSplitImpulse(false)
+, m_positionIterations(4)
+, m_impulseTolerance(0.0f)
+, m_velocityStats{0, 0.0f}
+, m_positionStats{0, 0.0f}
+, m_islandColoringThreshold(256)
+, m_islandJacobiThreshold(0xFFFFFFFF)
+, m_useJointTrees(false)
+, m_deterministic(false)
+, m_stateHash(0)
+, m_subStepCount(0)
+, m_subStepIterations(1)
+, m_contactHertz(30.0f)
+, m_contactDampingRatio(10.0f)
+, m_jointHertz(60.0f)
+, m_jointDampingRatio(2.0f)
+, m_maxContactPushVelocity(3.0f)
+, m_fixedTimeStep(1.0f / 60.0f)
+, m_maxFixedSteps(4)
+, m_accumulator(0.0f)
+, m_allocator(allocator ? allocator : &m_defaultAllocator)
+, m_taskExecutor(&m_serialTaskExecutor)
+, m_workers(m_allocator)
+, m_candidatePairs(m_allocator)
+, m_newArbiters(m_allocator)
+, m_staleArbiterKeys(m_allocator)
+, m_taskGraph(m_allocator)
+, m_materialPairs(m_allocator)
+, m_materialValues(m_allocator)
+, m_materialTableSize(0)
+, m_materialPool(m_allocator)
+, m_bodyPool(m_allocator)
+, m_shapePool(m_allocator)
+, m_jointPool(m_allocator)
+, m_bodies(m_allocator)
+, m_bodyStates(m_allocator)
+, m_joints(m_allocator)
+, m_articulations(m_allocator)
+, m_arbiters(0, ArbiterMap::allocator_type(m_allocator))
+, m_worldListeners(m_allocator)
+, m_onCollisions(m_allocator)
+, m_onTriggerEnters(m_allocator)
+, m_onTriggerExits(m_allocator)
+, m_shapePairs(m_allocator)
+, m_bvhStack(m_allocator)
+, m_timeOfImpactArbiters(m_allocator)
+, m_solverBodies(m_allocator)
+, m_contactConstraints(m_allocator)
+, m_wideContactSolver(m_allocator)
+, m_constraintRows(m_allocator)
+, m_constraintRowOffsets(m_allocator)
+, m_islandSolver(m_allocator)
+, m_timestamp(0)
+, m_commandBuffer(m_allocator)
+, m_appliedCommands(m_allocator)
+, m_pendingBodyRemovals(m_allocator)
+, m_pendingJointRemovals(m_allocator)
+, m_removedBodies(m_allocator)
+, m_removedJoints(m_allocator)
+, m_transforms{Vector<BodyTransform>(m_allocator), Vector<BodyTransform>(m_allocator)}
+, m_publishedTransforms(0)
+, m_interpolatedTransforms(m_allocator)
+, m_bodyWrites(m_allocator)
+, m_appliedBodyWrites(m_allocator)
+, m_asyncQuit(false)
+{
+}
+
+World::~World()
 {
+    {
+        std::lock_guard<std::mutex> lock(m_asyncMutex);
+        m_asyncQuit = true;
+    }
+    m_asyncCondition.notify_one();
+
+    if (m_asyncThread.joinable())
+    {
+        m_asyncThread.join();
+    }
+
+    RemoveBodies(m_bodies.data(), m_bodies.size());
 }
 
 void World::Clear()
 {
-    m_bodies.clear();
+    RemoveBodies(m_bodies.data(), m_bodies.size());
     m_joints.clear();
+    m_articulations.clear();
     m_arbiters.clear();
+    m_transforms[0].clear();
+    m_transforms[1].clear();
+    m_interpolatedTransforms.clear();
+    m_accumulator = 0.0f;
+    m_materialPairs.clear();
+    m_materialValues.clear();
+    m_materialTableSize = 0;
+
+    m_jointPool.Clear();
+    m_shapePool.Clear();
+    m_bodyPool.Clear();
+    m_materialPool.Clear();
+}
+
+void World::Reserve(uint32_t bodyCount, uint32_t jointCount, uint32_t pairCount)
+{
+    m_bodies.reserve(bodyCount);
+    m_bodyStates.reserve(bodyCount);
+    m_transforms[0].reserve(bodyCount);
+    m_transforms[1].reserve(bodyCount);
+    m_interpolatedTransforms.reserve(bodyCount);
+    m_joints.reserve(jointCount);
+
+    m_arbiters.reserve(pairCount);
+    m_candidatePairs.reserve(pairCount);
+    m_newArbiters.reserve(pairCount);
+    m_staleArbiterKeys.reserve(pairCount);
+    m_contactConstraints.reserve(pairCount);
+    m_onCollisions.reserve(pairCount * g_maxContactPoints);
+    m_onTriggerEnters.reserve(pairCount);
+    m_onTriggerExits.reserve(pairCount);
+
+    // The arbiter map takes a node per pair. Depending on the standard
+    // library, a node adds one or two pointers' worth of links and cached
+    // hash to the key and arbiter.
+    const size_t arbiterNodeSize = sizeof(ArbiterMap::value_type);
+    m_allocator->Reserve(arbiterNodeSize + sizeof(void*), alignof(ArbiterMap::value_type), pairCount);
+    m_allocator->Reserve(arbiterNodeSize + 2 * sizeof(void*), alignof(ArbiterMap::value_type), pairCount);
+
+    // Any one worker may end up with all of the pairs.
+    ResizeWorkers();
+    for (size_t i = 0; i < m_workers.size(); ++i)
+    {
+        m_workers[i].m_bvhPairs.reserve(pairCount);
+        m_workers[i].m_bvhStack.reserve(pairCount);
+        m_workers[i].m_shapePairs.reserve(pairCount);
+        m_workers[i].m_arbiters.reserve(pairCount);
+    }
+
+    m_wideContactSolver.Reserve(bodyCount + 1, pairCount);
+    m_constraintRows.reserve(pairCount * 3 * g_maxContactPoints);
+    m_constraintRowOffsets.reserve(pairCount + 1);
+    m_islandSolver.Reserve(bodyCount + 1, pairCount, jointCount);
+}
+
+void World::ResizeWorkers()
+{
+    const size_t workerCount = m_taskExecutor->GetWorkerCount();
+    if (m_workers.size() > workerCount)
+    {
+        m_workers.erase(m_workers.begin() + workerCount, m_workers.end());
+    }
+
+    while (m_workers.size() < workerCount)
+    {
+        m_workers.emplace_back(m_allocator);
+    }
 }
 
 void World::Add(Body* body)
 {
+    assert((body->m_state == &body->m_localState) && "Body is already in a world");
+
+    const BodyState* bodyStates = m_bodyStates.data();
     m_bodies.push_back(body);
+    m_bodyStates.push_back(body->m_localState);
+    LinkBodyStates((m_bodyStates.data() == bodyStates) ? m_bodies.size() - 1 : 0);
+}
+
+void World::LinkBodyStates(size_t begin)
+{
+    for (size_t i = begin; i < m_bodies.size(); ++i)
+    {
+        m_bodies[i]->m_state = &m_bodyStates[i];
+        m_bodies[i]->m_solverIndex = static_cast<uint32_t>(i);
+    }
 }
 
 void World::Add(Joint* joint)
@@ -37,200 +229,432 @@ void World::Add(Joint* joint)
     m_joints.push_back(joint);
 }
 
+void World::Add(Articulation* articulation)
+{
+    m_articulations.push_back(articulation);
+}
+
+void World::Remove(Articulation* articulation)
+{
+    m_articulations.erase(std::remove(m_articulations.begin(), m_articulations.end(), articulation), m_articulations.end());
+}
+
 void World::Remove(Body* body)
 {
-    m_bodies.erase(std::find(m_bodies.begin(), m_bodies.end(), body));
+    RemoveBodies(&body, 1);
+}
+
+void World::Remove(Joint* joint)
+{
+    RemoveJoints(&joint, 1);
+}
+
+void World::RemoveBodies(Body* const* bodies, size_t bodyCount)
+{
+    m_removedBodies.assign(bodies, bodies + bodyCount);
+    std::sort(m_removedBodies.begin(), m_removedBodies.end());
+
+    auto isRemoved = [this](const Body* body)
+    {
+        return std::binary_search(m_removedBodies.begin(), m_removedBodies.end(), body);
+    };
 
+    // Removed bodies take their state back.
+    size_t keptCount = 0;
     for (size_t i = 0; i < m_bodies.size(); ++i)
     {
-        Body* bi = m_bodies[i];
-        for (size_t s1 = 0; s1 < bi->m_shapes.size(); ++s1)
+        Body* body = m_bodies[i];
+        if (isRemoved(body))
         {
-            for (size_t j = i + 1; j < m_bodies.size(); ++j)
-            {
-                Body* bj = m_bodies[j];
-                for (size_t s2 = 0; s2 < bj->m_shapes.size(); ++s2)
-                {
-                    const uint64_t key = ComputeArbiterKey(bi->m_shapes[s1], bj->m_shapes[s2]);
-                    m_arbiters.erase(key);
-                }
-            }
+            body->m_localState = m_bodyStates[i];
+            body->m_state = &body->m_localState;
+        }
+        else
+        {
+            m_bodies[keptCount] = body;
+            m_bodyStates[keptCount] = m_bodyStates[i];
+            ++keptCount;
+        }
+    }
+
+    m_bodies.resize(keptCount);
+    m_bodyStates.resize(keptCount);
+    LinkBodyStates(0);
+
+    for (auto iter = m_arbiters.begin(); iter != m_arbiters.end();)
+    {
+        if (isRemoved(iter->second.m_body1) || isRemoved(iter->second.m_body2))
+        {
+            iter = m_arbiters.erase(iter);
+        }
+        else
+        {
+            ++iter;
         }
     }
+
+    m_removedBodies.clear();
 }
 
-void World::Remove(Joint* joint)
+void World::RemoveJoints(Joint* const* joints, size_t jointCount)
 {
-    m_joints.erase(std::find(m_joints.begin(), m_joints.end(), joint));
+    m_removedJoints.assign(joints, joints + jointCount);
+    std::sort(m_removedJoints.begin(), m_removedJoints.end());
+
+    m_joints.erase(std::remove_if(m_joints.begin(), m_joints.end(), [this](const Joint* joint)
+    {
+        return std::binary_search(m_removedJoints.begin(), m_removedJoints.end(), joint);
+    }), m_joints.end());
+
+    m_removedJoints.clear();
 }
 
-void World::BroadPhase()
+Handle<Body> World::CreateBody()
 {
-    m_onCollisions.clear();
-    m_onTriggerEnters.clear();
-    m_onTriggerExits.clear();
+    return m_bodyPool.Create<Body>();
+}
 
-    for (size_t i = 0; i < m_bodies.size(); ++i)
+Handle<Shape> World::CreateShape(Handle<Body> body, ShapeType type)
+{
+    Body* owner = m_bodyPool.Get(body);
+    if (!owner)
     {
-        Body* bi = m_bodies[i];
+        return NullHandle<Shape>();
+    }
 
-        for (size_t s1 = 0; s1 < bi->m_shapes.size(); ++s1)
+    Handle<Shape> shape = NullHandle<Shape>();
+    switch (type)
+    {
+        case ShapeType::Box:
         {
-            for (size_t j = i + 1; j < m_bodies.size(); ++j)
-            {
-                Body* bj = m_bodies[j];
+            shape = m_shapePool.Create<ShapeBox>();
+            break;
+        }
 
-                if ((bi->m_invMass == 0.0f) && (bj->m_invMass == 0.0f))
-                {
-                    continue;
-                }
+        case ShapeType::Sphere:
+        {
+            shape = m_shapePool.Create<ShapeSphere>();
+            break;
+        }
 
-                for (size_t s2 = 0; s2 < bj->m_shapes.size(); ++s2)
-                {
-                    Arbiter newArb(bi->m_shapes[s1], bj->m_shapes[s2]);
-                    const uint64_t key = ComputeArbiterKey(bi->m_shapes[s1], bj->m_shapes[s2]);
-
-                    if (newArb.m_contactCount > 0)
-                    {
-                        const auto iter = m_arbiters.find(key);
-                        if (iter == m_arbiters.end())
-                        {
-                            m_arbiters.insert({key, newArb});
-
-                            if (!m_worldListeners.empty())
-                            {
-                                if (bi->m_shapes[s1]->IsTrigger() || bj->m_shapes[s2]->IsTrigger())
-                                {
-                                    TriggerResult triggerResult;
-                                    triggerResult.m_body1 = newArb.m_body1;
-                                    triggerResult.m_body2 = newArb.m_body2;
-                                    m_onTriggerEnters.push_back(triggerResult);
-                                }
-                                else
-                                {
-                                    for (size_t k = 0; k < newArb.m_contactCount; ++k)
-                                    {
-                                        CollisionResult collisionResult;
-                                        collisionResult.m_body1 = newArb.m_body1;
-                                        collisionResult.m_body2 = newArb.m_body2;
-                                        collisionResult.m_position = newArb.m_contacts[k].m_position;
-                                        collisionResult.m_normal = newArb.m_contacts[k].m_normal;
-                                        collisionResult.m_impulse = newArb.m_contacts[k].m_Pn;
-                                        collisionResult.m_separation = newArb.m_contacts[k].m_separation;
-                                        m_onCollisions.push_back(collisionResult);
-                                    }
-                                }
-                            }
-                        }
-                        else
-                        {
-                            Contact newContacts[g_maxContactPoints];
-                            size_t newContactCount;
-                            iter->second.Update(newArb.m_contacts, newArb.m_contactCount, newContacts, newContactCount);
-
-                            if (!m_worldListeners.empty())
-                            {
-                                for (size_t k = 0; k < newContactCount; ++k)
-                                {
-                                    CollisionResult collisionResult;
-                                    collisionResult.m_body1 = newArb.m_body1;
-                                    collisionResult.m_body2 = newArb.m_body2;
-                                    collisionResult.m_position = newContacts[k].m_position;
-                                    collisionResult.m_normal = newContacts[k].m_normal;
-                                    collisionResult.m_impulse = newContacts[k].m_Pn;
-                                    collisionResult.m_separation = newContacts[k].m_separation;
-                                    m_onCollisions.push_back(collisionResult);
-                                }
-                            }
-                        }
-                    }
-                    else
-                    {
-                        if (bi->m_shapes[s1]->IsTrigger() || bj->m_shapes[s2]->IsTrigger())
-                        {
-                            const auto iter = m_arbiters.find(key);
-                            if (iter != m_arbiters.end())
-                            {
-                                TriggerResult triggerResult;
-                                triggerResult.m_body1 = newArb.m_body1;
-                                triggerResult.m_body2 = newArb.m_body2;
-                                m_onTriggerExits.push_back(triggerResult);
-                            }
-                        }
-
-                        m_arbiters.erase(key);
-                    }
-                }
-            }
+        case ShapeType::Capsule:
+        {
+            shape = m_shapePool.Create<ShapeCapsule>();
+            break;
+        }
+
+        default:
+        {
+            assert(false);
+            return shape;
         }
     }
 
-    for (size_t i = 0; i < m_worldListeners.size(); ++i)
+    owner->AddShape(m_shapePool.Get(shape));
+    return shape;
+}
+
+Handle<Joint> World::CreateJoint(JointType type)
+{
+    switch (type)
     {
-        if (!m_onCollisions.empty())
+        case JointType::Spherical:
         {
-            m_worldListeners[i]->OnCollision(&m_onCollisions[0], m_onCollisions.size());
+            return m_jointPool.Create<JointSpherical>();
         }
 
-        if (!m_onTriggerEnters.empty())
+        case JointType::Hinge:
         {
-            m_worldListeners[i]->OnTriggerEnter(&m_onTriggerEnters[0], m_onTriggerEnters.size());
+            return m_jointPool.Create<JointHinge>();
         }
 
-        if (!m_onTriggerExits.empty())
+        default:
         {
-            m_worldListeners[i]->OnTriggerEnter(&m_onTriggerExits[0], m_onTriggerExits.size());
+            assert(false);
+            return NullHandle<Joint>();
         }
     }
 }
 
-void World::Step(float elapsedTime)
+Handle<Material> World::CreateMaterial()
 {
-    BroadPhase();
+    const Handle<Material> material = m_materialPool.Create<Material>();
+    Material* m = m_materialPool.Get(material);
+    m->m_world = this;
+    m->m_id = material.m_index;
+    UpdateMaterialPairs(m);
+    return material;
+}
 
-    for (size_t i = 0; i < m_bodies.size(); ++i)
+void World::UpdateMaterial(Handle<Material> material)
+{
+    const Material* m = m_materialPool.Get(material);
+    if (m)
     {
-        Body* b = m_bodies[i];
+        UpdateMaterialPairs(m);
+    }
+}
 
-        if (b->m_invMass == 0.0f)
+void World::UpdateMaterials()
+{
+    for (uint32_t i = 0; i < m_materialPool.GetSlotCount(); ++i)
+    {
+        const Material* material = m_materialPool.GetAt(i);
+        if (material && !HaveSameValues(*material, m_materialValues[i]))
         {
-            continue;
+            UpdateMaterialPairs(material);
         }
+    }
+}
+
+void World::UpdateMaterialPairs(const Material* m)
+{
+    const uint32_t materialCount = m_materialPool.GetSlotCount();
+    if (materialCount > m_materialTableSize)
+    {
+        const uint32_t tableSize = std::max(2 * m_materialTableSize, materialCount);
 
-        glm::vec3 totalForce = b->m_invMass * b->m_force;
-        if (b->m_useGravity)
+        Vector<MaterialPair> materialPairs(m_allocator);
+        materialPairs.resize(tableSize * tableSize);
+        for (uint32_t i = 0; i < m_materialTableSize; ++i)
         {
-            totalForce += m_gravity;
+            std::copy_n(&m_materialPairs[i * m_materialTableSize], m_materialTableSize, &materialPairs[i * tableSize]);
         }
-        b->m_velocity += elapsedTime * totalForce;
-        b->m_angularVelocity += elapsedTime * (b->m_invI * b->m_torque);
 
-        b->m_velocity *= std::pow(1.0f - b->m_linearDamping, elapsedTime);
-        b->m_angularVelocity *= std::pow(1.0f - b->m_angularDamping, elapsedTime);
+        m_materialPairs.swap(materialPairs);
+        m_materialTableSize = tableSize;
     }
 
-    float invElapsedTime = (elapsedTime > 0.0f) ? 1.0f / elapsedTime : 0.0f;
+    if (materialCount > m_materialValues.size())
+    {
+        m_materialValues.resize(materialCount);
+    }
+    m_materialValues[m->m_id] = *m;
 
-    for (auto& arb : m_arbiters)
+    // Every combine mode is symmetric, so one result fills both entries.
+    for (uint32_t i = 0; i < materialCount; ++i)
+    {
+        const Material* other = m_materialPool.GetAt(i);
+        if (other)
+        {
+            const MaterialPair materialPair = CombineMaterials(*m, *other);
+            m_materialPairs[m->m_id * m_materialTableSize + i] = materialPair;
+            m_materialPairs[i * m_materialTableSize + m->m_id] = materialPair;
+        }
+    }
+}
+
+MaterialPair World::GetMaterialPair(const Material* material1, const Material* material2) const
+{
+    if ((material1->m_world == this) && (material2->m_world == this))
     {
-        arb.second.PreStep(invElapsedTime);
+        return m_materialPairs[material1->m_id * m_materialTableSize + material2->m_id];
     }
 
-    for (size_t i = 0; i < m_joints.size(); ++i)
+    return CombineMaterials(*material1, *material2);
+}
+
+void World::Destroy(Handle<Body> body)
+{
+    Body* b = m_bodyPool.Get(body);
+    if (!b)
+    {
+        return;
+    }
+
+    RemoveBodies(&b, 1);
+
+    // Joints created by the world go with the body, others are only
+    // removed, as are the articulations it is a link of.
+    for (size_t i = m_joints.size(); i-- > 0;)
+    {
+        Joint* joint = m_joints[i];
+        if ((joint->m_body1 == b) || (joint->m_body2 == b))
+        {
+            RemoveJoints(&joint, 1);
+            m_jointPool.Destroy(m_jointPool.Find(joint));
+        }
+    }
+
+    for (size_t i = m_articulations.size(); i-- > 0;)
+    {
+        const std::vector<ArticulationLink>& links = m_articulations[i]->m_links;
+        if (std::any_of(links.begin(), links.end(), [b](const ArticulationLink& link) { return link.m_body == b; }))
+        {
+            m_articulations.erase(m_articulations.begin() + i);
+        }
+    }
+
+    // Shapes that were not created by the world are left to the body.
+    for (size_t i = b->m_shapes.size(); i-- > 0;)
+    {
+        m_shapePool.Destroy(m_shapePool.Find(b->m_shapes[i]));
+    }
+
+    m_bodyPool.Destroy(body);
+}
+
+void World::Destroy(Handle<Shape> shape)
+{
+    Shape* s = m_shapePool.Get(shape);
+    if (!s)
+    {
+        return;
+    }
+
+    for (auto iter = m_arbiters.begin(); iter != m_arbiters.end();)
+    {
+        if ((iter->second.m_shape1 == s) || (iter->second.m_shape2 == s))
+        {
+            iter = m_arbiters.erase(iter);
+        }
+        else
+        {
+            ++iter;
+        }
+    }
+
+    m_shapePool.Destroy(shape);
+}
+
+void World::Destroy(Handle<Joint> joint)
+{
+    Joint* j = m_jointPool.Get(joint);
+    if (!j)
+    {
+        return;
+    }
+
+    RemoveJoints(&j, 1);
+    m_jointPool.Destroy(joint);
+}
+
+void World::Destroy(Handle<Material> material)
+{
+    const Material* m = m_materialPool.Get(material);
+    if (!m)
+    {
+        return;
+    }
+
+    // The next material in the slot starts from a cleared row.
+    const MaterialPair clearedPair = {0.0f, 0.0f, 0.0f};
+    for (uint32_t i = 0; i < m_materialTableSize; ++i)
+    {
+        m_materialPairs[m->m_id * m_materialTableSize + i] = clearedPair;
+        m_materialPairs[i * m_materialTableSize + m->m_id] = clearedPair;
+    }
+    m_materialValues[m->m_id] = Material();
+
+    m_materialPool.Destroy(material);
+}
+
+Body* World::Get(Handle<Body> body) const
+{
+    return m_bodyPool.Get(body);
+}
+
+Shape* World::Get(Handle<Shape> shape) const
+{
+    return m_shapePool.Get(shape);
+}
+
+Joint* World::Get(Handle<Joint> joint) const
+{
+    return m_jointPool.Get(joint);
+}
+
+Material* World::Get(Handle<Material> material) const
+{
+    return m_materialPool.Get(material);
+}
+
+void World::FlushRemovals()
+{
+    if (!m_pendingBodyRemovals.empty())
+    {
+        RemoveBodies(m_pendingBodyRemovals.data(), m_pendingBodyRemovals.size());
+        m_pendingBodyRemovals.clear();
+    }
+
+    if (!m_pendingJointRemovals.empty())
     {
-        switch (m_joints[i]->GetType())
+        RemoveJoints(m_pendingJointRemovals.data(), m_pendingJointRemovals.size());
+        m_pendingJointRemovals.clear();
+    }
+}
+
+void World::ApplyCommands()
+{
+    m_commandBuffer.Swap(m_appliedCommands);
+
+    // Removals are gathered and done in one pass over the bodies and the
+    // arbiters. An add flushes them first so that removing and adding the
+    // same object keeps its recorded order.
+    for (size_t i = 0; i < m_appliedCommands.size(); ++i)
+    {
+        const WorldCommand& command = m_appliedCommands[i];
+        switch (command.m_type)
         {
-            case JointType::Spherical:
+            case WorldCommandType::AddBody:
+            {
+                FlushRemovals();
+                Add(command.m_body);
+                break;
+            }
+
+            case WorldCommandType::RemoveBody:
+            {
+                m_pendingBodyRemovals.push_back(command.m_body);
+                break;
+            }
+
+            case WorldCommandType::AddJoint:
+            {
+                FlushRemovals();
+                Add(command.m_joint);
+                break;
+            }
+
+            case WorldCommandType::RemoveJoint:
+            {
+                m_pendingJointRemovals.push_back(command.m_joint);
+                break;
+            }
+
+            case WorldCommandType::AddShape:
+            {
+                command.m_body->AddShape(command.m_shape);
+                break;
+            }
+
+            case WorldCommandType::SetBox:
+            {
+                static_cast<ShapeBox*>(command.m_shape)->Set(command.m_values);
+                break;
+            }
+
+            case WorldCommandType::SetSphere:
+            {
+                static_cast<ShapeSphere*>(command.m_shape)->Set(command.m_values.x);
+                break;
+            }
+
+            case WorldCommandType::SetCapsule:
+            {
+                static_cast<ShapeCapsule*>(command.m_shape)->Set(command.m_values.x, command.m_values.y);
+                break;
+            }
+
+            case WorldCommandType::SetIsTrigger:
             {
-                JointSpherical* jointSpherical = static_cast<JointSpherical*>(m_joints[i]);
-                jointSpherical->PreStep(invElapsedTime);
+                command.m_shape->SetIsTrigger(command.m_values.x != 0.0f);
                 break;
             }
 
-            case JointType::Hinge:
+            case WorldCommandType::SetMass:
             {
-                JointHinge* jointHinge = static_cast<JointHinge*>(m_joints[i]);
-                jointHinge->PreStep(invElapsedTime);
+                command.m_body->SetMass(command.m_values.x);
                 break;
             }
 
@@ -241,47 +665,1020 @@ void World::Step(float elapsedTime)
         }
     }
 
-    for (uint32_t i = 0; i < m_iterations; ++i)
+    FlushRemovals();
+}
+
+void World::UpdateArbiter(Arbiter& newArb)
+{
+    const uint64_t key = ComputeArbiterKey(newArb.m_shape1, newArb.m_shape2);
+
+    newArb.m_timestamp = m_timestamp;
+
+    const auto iter = m_arbiters.find(key);
+    if (iter == m_arbiters.end())
     {
-        for (auto& arb : m_arbiters)
-        {
-            arb.second.ApplyImpulse();
-        }
+        m_arbiters.insert({key, newArb});
 
-        for (size_t j = 0; j < m_joints.size(); ++j)
+        if (!m_worldListeners.empty())
         {
-            switch (m_joints[j]->GetType())
+            if (newArb.m_isTrigger)
             {
-                case JointType::Spherical:
-                {
-                    JointSpherical* jointSpherical = static_cast<JointSpherical*>(m_joints[j]);
-                    jointSpherical->ApplyImpulse();
-                    break;
-                }
-
-                case JointType::Hinge:
-                {
-                    JointHinge* jointHinge = static_cast<JointHinge*>(m_joints[i]);
-                    jointHinge->ApplyImpulse();
-                    break;
-                }
-
-                default:
+                TriggerResult triggerResult;
+                triggerResult.m_body1 = newArb.m_body1;
+                triggerResult.m_body2 = newArb.m_body2;
+                m_onTriggerEnters.push_back(triggerResult);
+            }
+            else
+            {
+                for (size_t k = 0; k < newArb.m_contactCount; ++k)
                 {
-                    assert(false);
+                    CollisionResult collisionResult;
+                    collisionResult.m_body1 = newArb.m_body1;
+                    collisionResult.m_body2 = newArb.m_body2;
+                    collisionResult.m_position = newArb.m_contacts[k].m_position;
+                    collisionResult.m_normal = newArb.m_contacts[k].m_normal;
+                    collisionResult.m_impulse = newArb.m_contacts[k].m_Pn;
+                    collisionResult.m_separation = newArb.m_contacts[k].m_separation;
+                    m_onCollisions.push_back(collisionResult);
                 }
             }
         }
     }
-
+    else
+    {
+        Contact newContacts[g_maxContactPoints];
+        size_t newContactCount;
+        iter->second.Update(newArb.m_contacts, newArb.m_contactCount, newContacts, newContactCount);
+        iter->second.m_timestamp = m_timestamp;
+
+        if (!m_worldListeners.empty())
+        {
+            for (size_t k = 0; k < newContactCount; ++k)
+            {
+                CollisionResult collisionResult;
+                collisionResult.m_body1 = newArb.m_body1;
+                collisionResult.m_body2 = newArb.m_body2;
+                collisionResult.m_position = newContacts[k].m_position;
+                collisionResult.m_normal = newContacts[k].m_normal;
+                collisionResult.m_impulse = newContacts[k].m_Pn;
+                collisionResult.m_separation = newContacts[k].m_separation;
+                m_onCollisions.push_back(collisionResult);
+            }
+        }
+    }
+}
+
+bool CompareArbiterKeys(const Arbiter* a, const Arbiter* b)
+{
+    return ComputeArbiterKey(a->m_shape1, a->m_shape2) < ComputeArbiterKey(b->m_shape1, b->m_shape2);
+}
+
+float ComputeBoundingRadius(const BVH& bvh)
+{
+    const AABB& localAABB = bvh.GetRootAABB();
+    return glm::length(localAABB.GetHalfExtents()) + glm::length(localAABB.GetCenter());
+}
+
+void World::BroadPhase(float elapsedTime)
+{
+    ParallelFor(m_taskExecutor, static_cast<uint32_t>(m_bodies.size()), k_bodyGrainSize, [this](uint32_t begin, uint32_t end, uint32_t)
+    {
+        for (uint32_t i = begin; i < end; ++i)
+        {
+            m_bodies[i]->UpdateBVH();
+        }
+    });
+
+    ParallelFor(m_taskExecutor, static_cast<uint32_t>(m_bodies.size()), k_pairFindingGrainSize, [this, elapsedTime](uint32_t begin, uint32_t end, uint32_t workerIndex)
+    {
+        FindPairs(begin, end, elapsedTime, m_workers[workerIndex]);
+    });
+
+    m_candidatePairs.clear();
+    for (size_t i = 0; i < m_workers.size(); ++i)
+    {
+        m_candidatePairs.insert(m_candidatePairs.end(), m_workers[i].m_shapePairs.begin(), m_workers[i].m_shapePairs.end());
+        m_workers[i].m_shapePairs.clear();
+    }
+}
+
+void World::FindPairs(uint32_t begin, uint32_t end, float elapsedTime, WorldWorker& worker)
+{
+    for (size_t i = begin; i < end; ++i)
+    {
+        Body* bi = m_bodies[i];
+
+        for (size_t j = i + 1; j < m_bodies.size(); ++j)
+        {
+            Body* bj = m_bodies[j];
+
+            if ((bi->m_state->m_invMass == 0.0f) && (bj->m_state->m_invMass == 0.0f))
+            {
+                continue;
+            }
+
+            if (bi->m_bvh.IsEmpty() || bj->m_bvh.IsEmpty())
+            {
+                continue;
+            }
+
+            if ((bi->m_articulation != nullptr) && (bi->m_articulation == bj->m_articulation))
+            {
+                continue;
+            }
+
+            // Fatten by how far the two bodies can move towards each other
+            // during the step.
+            float margin = 0.0f;
+            if (m_useSpeculativeContacts)
+            {
+                const float relativeSpeed = glm::length(bj->m_state->m_velocity - bi->m_state->m_velocity) + glm::length(bi->m_state->m_angularVelocity) * ComputeBoundingRadius(bi->m_bvh) + glm::length(bj->m_state->m_angularVelocity) * ComputeBoundingRadius(bj->m_bvh);
+                margin = relativeSpeed * elapsedTime;
+            }
+
+            worker.m_bvhPairs.clear();
+            QueryPairs(bi->m_bvh, bi->m_state->m_position, bi->m_state->m_rotation, bj->m_bvh, bj->m_state->m_position, bj->m_state->m_rotation, margin, worker.m_bvhPairs, worker.m_bvhStack);
+
+            for (size_t k = 0; k < worker.m_bvhPairs.size(); ++k)
+            {
+                ShapePair shapePair;
+                shapePair.m_shape1 = bi->m_shapes[worker.m_bvhPairs[k].m_index1];
+                shapePair.m_shape2 = bj->m_shapes[worker.m_bvhPairs[k].m_index2];
+                shapePair.m_margin = (shapePair.m_shape1->IsTrigger() || shapePair.m_shape2->IsTrigger()) ? 0.0f : margin;
+                worker.m_shapePairs.push_back(shapePair);
+            }
+        }
+    }
+}
+
+void World::NarrowPhase(uint32_t begin, uint32_t end, WorldWorker& worker)
+{
+    for (uint32_t i = begin; i < end; ++i)
+    {
+        const ShapePair& shapePair = m_candidatePairs[i];
+        Arbiter arb(shapePair.m_shape1, shapePair.m_shape2, shapePair.m_margin, GetMaterialPair(shapePair.m_shape1->m_material, shapePair.m_shape2->m_material));
+        if (arb.m_contactCount > 0)
+        {
+            worker.m_arbiters.push_back(arb);
+        }
+    }
+}
+
+void World::UpdateArbiters()
+{
+    m_onCollisions.clear();
+    m_onTriggerEnters.clear();
+    m_onTriggerExits.clear();
+
+    ++m_timestamp;
+
+    // Workers find the arbiters in an order that depends on scheduling, so
+    // deterministic mode merges them sorted by key.
+    m_newArbiters.clear();
+    for (size_t i = 0; i < m_workers.size(); ++i)
+    {
+        Vector<Arbiter>& arbiters = m_workers[i].m_arbiters;
+        for (size_t k = 0; k < arbiters.size(); ++k)
+        {
+            m_newArbiters.push_back(&arbiters[k]);
+        }
+    }
+
+    if (m_deterministic)
+    {
+        std::sort(m_newArbiters.begin(), m_newArbiters.end(), CompareArbiterKeys);
+    }
+
+    for (size_t i = 0; i < m_newArbiters.size(); ++i)
+    {
+        UpdateArbiter(*m_newArbiters[i]);
+    }
+
+    for (size_t i = 0; i < m_workers.size(); ++i)
+    {
+        m_workers[i].m_arbiters.clear();
+    }
+
+    // Arbiters that were not refreshed this step have either been culled
+    // by the midphase or lost all their contact points.
+    m_staleArbiterKeys.clear();
+    for (const auto& arb : m_arbiters)
+    {
+        if (arb.second.m_timestamp != m_timestamp)
+        {
+            m_staleArbiterKeys.push_back(arb.first);
+        }
+    }
+
+    if (m_deterministic)
+    {
+        std::sort(m_staleArbiterKeys.begin(), m_staleArbiterKeys.end());
+    }
+
+    for (size_t i = 0; i < m_staleArbiterKeys.size(); ++i)
+    {
+        const auto iter = m_arbiters.find(m_staleArbiterKeys[i]);
+
+        if (iter->second.m_isTrigger)
+        {
+            TriggerResult triggerResult;
+            triggerResult.m_body1 = iter->second.m_body1;
+            triggerResult.m_body2 = iter->second.m_body2;
+            m_onTriggerExits.push_back(triggerResult);
+        }
+
+        m_arbiters.erase(iter);
+    }
+
+    for (size_t i = 0; i < m_worldListeners.size(); ++i)
+    {
+        if (!m_onCollisions.empty())
+        {
+            m_worldListeners[i]->OnCollision(&m_onCollisions[0], m_onCollisions.size());
+        }
+
+        if (!m_onTriggerEnters.empty())
+        {
+            m_worldListeners[i]->OnTriggerEnter(&m_onTriggerEnters[0], m_onTriggerEnters.size());
+        }
+
+        if (!m_onTriggerExits.empty())
+        {
+            m_worldListeners[i]->OnTriggerEnter(&m_onTriggerExits[0], m_onTriggerExits.size());
+        }
+    }
+}
+
+float ComputeMinHalfExtent(const BVH& bvh)
+{
+    float minHalfExtent = std::numeric_limits<float>::infinity();
+    for (size_t i = 0; i < bvh.m_nodes.size(); ++i)
+    {
+        if (bvh.m_nodes[i].IsLeaf())
+        {
+            const glm::vec3 halfExtents = bvh.m_nodes[i].m_aabb.GetHalfExtents();
+            minHalfExtent = std::min(minHalfExtent, std::min(halfExtents.x, std::min(halfExtents.y, halfExtents.z)));
+        }
+    }
+    return minHalfExtent;
+}
+
+bool World::TestOverlap(Body* body, const glm::vec3& position, const glm::quat& rotation, Body* other)
+{
+    m_shapePairs.clear();
+    QueryPairs(body->m_bvh, position, rotation, other->m_bvh, other->m_state->m_position, other->m_state->m_rotation, 0.0f, m_shapePairs, m_bvhStack);
+
+    for (size_t k = 0; k < m_shapePairs.size(); ++k)
+    {
+        Shape* shape1 = body->m_shapes[m_shapePairs[k].m_index1];
+        Shape* shape2 = other->m_shapes[m_shapePairs[k].m_index2];
+
+        if (shape1->IsTrigger() || shape2->IsTrigger())
+        {
+            continue;
+        }
+
+        Contact contacts[g_maxContactPoints];
+        if (Collide(contacts, position, rotation, shape1, other->m_state->m_position, other->m_state->m_rotation, shape2, 0.0f) > 0)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+float World::ComputeTimeOfImpact(Body* body, Body* other, const glm::vec3& position0, const glm::quat& rotation0, const glm::vec3& position1, const glm::quat& rotation1, uint32_t sampleCount)
+{
+    // Pairs that already touch at the start of the motion are handled by
+    // the discrete contacts.
+    if (TestOverlap(body, position0, rotation0, other))
+    {
+        return 1.0f;
+    }
+
+    float t0 = 0.0f;
+    for (uint32_t i = 1; i <= sampleCount; ++i)
+    {
+        float t1 = static_cast<float>(i) / static_cast<float>(sampleCount);
+        if (!TestOverlap(body, glm::mix(position0, position1, t1), glm::slerp(rotation0, rotation1, t1), other))
+        {
+            t0 = t1;
+            continue;
+        }
+
+        // Root-find the first contact between the last separated sample
+        // and the first overlapping one.
+        for (uint32_t j = 0; j < k_timeOfImpactBisections; ++j)
+        {
+            const float t = (t0 + t1) * 0.5f;
+            if (TestOverlap(body, glm::mix(position0, position1, t), glm::slerp(rotation0, rotation1, t), other))
+            {
+                t1 = t;
+            }
+            else
+            {
+                t0 = t;
+            }
+        }
+
+        return t1;
+    }
+
+    return 1.0f;
+}
+
+void World::IntegrateContinuous(Body* body, float elapsedTime)
+{
+    const AABB& localAABB = body->m_bvh.GetRootAABB();
+    const float minHalfExtent = ComputeMinHalfExtent(body->m_bvh);
+    const float radius = ComputeBoundingRadius(body->m_bvh);
+    const float invElapsedTime = (elapsedTime > 0.0f) ? 1.0f / elapsedTime : 0.0f;
+    float remainingTime = elapsedTime;
+
+    for (uint32_t subStep = 0; subStep < k_maxTimeOfImpactSubSteps; ++subStep)
+    {
+        const glm::vec3 position0 = body->m_state->m_position;
+        const glm::quat rotation0 = body->m_state->m_rotation;
+        const glm::vec3 position1 = position0 + remainingTime * body->m_state->m_velocity;
+        const glm::quat rotation1 = glm::normalize(glm::quat(remainingTime * body->m_state->m_angularVelocity) * rotation0);
+
+        body->m_state->m_position = position1;
+        body->m_state->m_rotation = rotation1;
+
+        // Bodies that move less than their own thickness cannot skip past
+        // anything the discrete contacts would miss.
+        const float motion = remainingTime * (glm::length(body->m_state->m_velocity) + radius * glm::length(body->m_state->m_angularVelocity));
+        if (motion <= minHalfExtent)
+        {
+            return;
+        }
+
+        const uint32_t sampleCount = std::min(static_cast<uint32_t>(std::ceil(motion / minHalfExtent)), k_maxTimeOfImpactSamples);
+        const AABB sweptAABB = Merge(TransformAABB(localAABB, position0, rotation0), TransformAABB(localAABB, position1, rotation1));
+
+        float timeOfImpact = 1.0f;
+        Body* hitBody = nullptr;
+        for (size_t i = 0; i < m_bodies.size(); ++i)
+        {
+            Body* other = m_bodies[i];
+
+            if ((other == body) || (other->m_state->m_invMass != 0.0f) || other->m_bvh.IsEmpty())
+            {
+                continue;
+            }
+
+            if (!Overlap(sweptAABB, TransformAABB(other->m_bvh.GetRootAABB(), other->m_state->m_position, other->m_state->m_rotation)))
+            {
+                continue;
+            }
+
+            const float t = ComputeTimeOfImpact(body, other, position0, rotation0, position1, rotation1, sampleCount);
+            if (t < timeOfImpact)
+            {
+                timeOfImpact = t;
+                hitBody = other;
+            }
+        }
+
+        if (!hitBody)
+        {
+            return;
+        }
+
+        // Move to the time of impact, resolve the contact against the static
+        // geometry and spend the remaining time with the new velocity.
+        body->m_state->m_position = glm::mix(position0, position1, timeOfImpact);
+        body->m_state->m_rotation = glm::slerp(rotation0, rotation1, timeOfImpact);
+
+        // The contacts are solved at the new rotation, so the staged inverse
+        // inertia must follow it.
+        m_solverBodies.m_invIs[body->m_solverIndex] = RotateDiagonal(body->m_state->m_rotation, body->m_state->m_invI);
+
+        m_timeOfImpactArbiters.clear();
+        m_shapePairs.clear();
+        QueryPairs(body->m_bvh, body->m_state->m_position, body->m_state->m_rotation, hitBody->m_bvh, hitBody->m_state->m_position, hitBody->m_state->m_rotation, 0.0f, m_shapePairs, m_bvhStack);
+        for (size_t k = 0; k < m_shapePairs.size(); ++k)
+        {
+            Shape* shape1 = body->m_shapes[m_shapePairs[k].m_index1];
+            Shape* shape2 = hitBody->m_shapes[m_shapePairs[k].m_index2];
+            Arbiter arb(shape1, shape2, 0.0f, GetMaterialPair(shape1->m_material, shape2->m_material));
+            if ((arb.m_contactCount > 0) && !arb.m_isTrigger)
+            {
+                m_timeOfImpactArbiters.push_back(arb);
+            }
+        }
+
+        for (size_t k = 0; k < m_timeOfImpactArbiters.size(); ++k)
+        {
+            m_timeOfImpactArbiters[k].PreStep(m_solverBodies, invElapsedTime, m_useBlockSolver, false);
+            m_timeOfImpactArbiters[k].WarmStart(m_solverBodies);
+        }
+
+        for (uint32_t i = 0; i < m_iterations; ++i)
+        {
+            for (size_t k = 0; k < m_timeOfImpactArbiters.size(); ++k)
+            {
+                m_timeOfImpactArbiters[k].ApplyImpulse(m_solverBodies);
+            }
+        }
+
+        body->m_state->m_velocity = m_solverBodies.m_velocities[body->m_solverIndex];
+        body->m_state->m_angularVelocity = m_solverBodies.m_angularVelocities[body->m_solverIndex];
+
+        remainingTime *= 1.0f - timeOfImpact;
+    }
+}
+
+void World::IntegrateForces(uint32_t begin, uint32_t end, float elapsedTime)
+{
+    for (uint32_t i = begin; i < end; ++i)
+    {
+        const BodyState& s = m_bodyStates[i];
+
+        if (s.m_invMass == 0.0f)
+        {
+            m_solverBodies.m_invIs[i] = glm::mat3(0.0f);
+            continue;
+        }
+
+        // Rotated once here so that the constraints can use it directly.
+        const glm::mat3 invI = RotateDiagonal(s.m_rotation, s.m_invI);
+        m_solverBodies.m_invIs[i] = invI;
+
+        // The substepping solver integrates the forces itself.
+        if (m_subStepCount > 0)
+        {
+            continue;
+        }
+
+        glm::vec3 totalForce = s.m_invMass * s.m_force;
+        if (s.m_useGravity)
+        {
+            totalForce += m_gravity;
+        }
+
+        glm::vec3& velocity = m_solverBodies.m_velocities[i];
+        glm::vec3& angularVelocity = m_solverBodies.m_angularVelocities[i];
+        velocity += elapsedTime * totalForce;
+        angularVelocity += elapsedTime * (invI * s.m_torque);
+
+        velocity *= std::pow(1.0f - s.m_linearDamping, elapsedTime);
+        angularVelocity *= std::pow(1.0f - s.m_angularDamping, elapsedTime);
+    }
+}
+
+void World::IntegrateVelocities(uint32_t begin, uint32_t end, float elapsedTime)
+{
+    for (uint32_t i = begin; i < end; ++i)
+    {
+        BodyState& s = m_bodyStates[i];
+
+        // Continuous bodies have already been moved by IntegrateContinuous.
+        const bool isContinuous = s.m_useCCD && (s.m_invMass != 0.0f) && !m_bodies[i]->m_bvh.IsEmpty();
+        if (!isContinuous && (m_subStepCount > 0))
+        {
+            s.m_position += m_solverBodies.m_deltaPositions[i];
+            s.m_rotation = glm::normalize(m_solverBodies.m_deltaRotations[i] * s.m_rotation);
+        }
+        else if (!isContinuous)
+        {
+            // The pseudo-velocities of the split impulse move the body but
+            // are not kept.
+            const glm::vec3 velocity = s.m_velocity + m_solverBodies.m_pseudoVelocities[i];
+            const glm::vec3 angularVelocity = s.m_angularVelocity + m_solverBodies.m_pseudoAngularVelocities[i];
+            s.m_position += elapsedTime * velocity;
+            s.m_rotation = glm::normalize(glm::quat(elapsedTime * angularVelocity) * s.m_rotation);
+        }
+
+        s.m_force = glm::vec3(0.0f, 0.0f, 0.0f);
+        s.m_torque = glm::vec3(0.0f, 0.0f, 0.0f);
+    }
+}
+
+std::future<void> World::StepAsync(float elapsedTime)
+{
+    std::packaged_task<void()> step([this, elapsedTime] { Step(elapsedTime); });
+    std::future<void> future = step.get_future();
+
+    {
+        std::lock_guard<std::mutex> lock(m_asyncMutex);
+        m_asyncSteps.push_back(std::move(step));
+
+        if (!m_asyncThread.joinable())
+        {
+            m_asyncThread = std::thread(&World::AsyncMain, this);
+        }
+    }
+    m_asyncCondition.notify_one();
+
+    return future;
+}
+
+void World::AsyncMain()
+{
+    for (;;)
+    {
+        std::packaged_task<void()> step;
+
+        {
+            std::unique_lock<std::mutex> lock(m_asyncMutex);
+            m_asyncCondition.wait(lock, [this] { return m_asyncQuit || !m_asyncSteps.empty(); });
+
+            if (m_asyncSteps.empty())
+            {
+                return;
+            }
+
+            step = std::move(m_asyncSteps.front());
+            m_asyncSteps.pop_front();
+        }
+
+        step();
+    }
+}
+
+void World::ApplyForce(Body* body, const glm::vec3& force, const glm::vec3& torque)
+{
+    BodyWrite bodyWrite;
+    bodyWrite.m_body = body;
+    bodyWrite.m_type = BodyWriteType::Force;
+    bodyWrite.m_linear = force;
+    bodyWrite.m_angular = torque;
+
+    std::lock_guard<std::mutex> lock(m_bodyWritesMutex);
+    m_bodyWrites.push_back(bodyWrite);
+}
+
+void World::SetVelocity(Body* body, const glm::vec3& velocity, const glm::vec3& angularVelocity)
+{
+    BodyWrite bodyWrite;
+    bodyWrite.m_body = body;
+    bodyWrite.m_type = BodyWriteType::Velocity;
+    bodyWrite.m_linear = velocity;
+    bodyWrite.m_angular = angularVelocity;
+
+    std::lock_guard<std::mutex> lock(m_bodyWritesMutex);
+    m_bodyWrites.push_back(bodyWrite);
+}
+
+void World::ApplyBodyWrites()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_bodyWritesMutex);
+        m_appliedBodyWrites.swap(m_bodyWrites);
+    }
+
+    for (size_t i = 0; i < m_appliedBodyWrites.size(); ++i)
+    {
+        const BodyWrite& bodyWrite = m_appliedBodyWrites[i];
+        switch (bodyWrite.m_type)
+        {
+            case BodyWriteType::Force:
+            {
+                bodyWrite.m_body->m_state->m_force += bodyWrite.m_linear;
+                bodyWrite.m_body->m_state->m_torque += bodyWrite.m_angular;
+                break;
+            }
+
+            case BodyWriteType::Velocity:
+            {
+                bodyWrite.m_body->m_state->m_velocity = bodyWrite.m_linear;
+                bodyWrite.m_body->m_state->m_angularVelocity = bodyWrite.m_angular;
+                break;
+            }
+
+            default:
+            {
+                assert(false);
+            }
+        }
+    }
+
+    m_appliedBodyWrites.clear();
+}
+
+void World::PublishTransforms()
+{
+    const uint32_t backBuffer = 1 - m_publishedTransforms.load(std::memory_order_relaxed);
+    Vector<BodyTransform>& transforms = m_transforms[backBuffer];
+
+    transforms.resize(m_bodies.size());
     for (size_t i = 0; i < m_bodies.size(); ++i)
     {
-        Body* b = m_bodies[i];
+        transforms[i].m_body = m_bodies[i];
+        transforms[i].m_position = m_bodyStates[i].m_position;
+        transforms[i].m_rotation = m_bodyStates[i].m_rotation;
+    }
+
+    m_publishedTransforms.store(backBuffer, std::memory_order_release);
+}
+
+const Vector<BodyTransform>& World::GetTransforms() const
+{
+    return m_transforms[m_publishedTransforms.load(std::memory_order_acquire)];
+}
+
+uint32_t World::Advance(float elapsedTime)
+{
+    m_accumulator += elapsedTime;
+
+    uint32_t stepCount = 0;
+    while ((m_accumulator >= m_fixedTimeStep) && (stepCount < m_maxFixedSteps))
+    {
+        Step(m_fixedTimeStep);
+        m_accumulator -= m_fixedTimeStep;
+        ++stepCount;
+    }
 
-        b->m_position += elapsedTime * b->m_velocity;
-        b->m_rotation = glm::normalize(glm::quat(elapsedTime * b->m_angularVelocity) * b->m_rotation);
+    if (m_accumulator >= m_fixedTimeStep)
+    {
+        m_accumulator = std::fmod(m_accumulator, m_fixedTimeStep);
+    }
+
+    InterpolateTransforms(m_accumulator / m_fixedTimeStep);
+
+    return stepCount;
+}
+
+void World::InterpolateTransforms(float alpha)
+{
+    // The back buffer still holds the poses published by the step before
+    // the last one.
+    const uint32_t frontBuffer = m_publishedTransforms.load(std::memory_order_acquire);
+    const Vector<BodyTransform>& current = m_transforms[frontBuffer];
+    const Vector<BodyTransform>& previous = m_transforms[1 - frontBuffer];
+
+    m_interpolatedTransforms.resize(current.size());
+    for (size_t i = 0; i < current.size(); ++i)
+    {
+        BodyTransform& transform = m_interpolatedTransforms[i];
+        transform = current[i];
+
+        // Bodies added since the previous step have nothing to blend with.
+        if ((i < previous.size()) && (previous[i].m_body == current[i].m_body))
+        {
+            transform.m_position = glm::mix(previous[i].m_position, current[i].m_position, alpha);
+            transform.m_rotation = glm::slerp(previous[i].m_rotation, current[i].m_rotation, alpha);
+        }
+    }
+}
+
+const Vector<BodyTransform>& World::GetInterpolatedTransforms() const
+{
+    return m_interpolatedTransforms;
+}
 
-        b->m_force = glm::vec3(0.0f, 0.0f, 0.0f);
-        b->m_torque = glm::vec3(0.0f, 0.0f, 0.0f);
+void World::WarmStart()
+{
+    for (size_t i = 0; i < m_contactConstraints.size(); ++i)
+    {
+        m_contactConstraints[i]->WarmStart(m_solverBodies);
+    }
+
+    for (size_t i = 0; i < m_joints.size(); ++i)
+    {
+        WarmStartRows(m_joints[i]->m_rows, m_joints[i]->m_rowCount, m_solverBodies);
+    }
+}
+
+void World::SolveConstraintRows()
+{
+    // Contacts warm start as usual and their rows then start from the same
+    // accumulated impulses. Joints are solved in their own rows after them.
+    const uint32_t arbiterCount = static_cast<uint32_t>(m_contactConstraints.size());
+    m_constraintRowOffsets.resize(arbiterCount + 1);
+    uint32_t rowCount = 0;
+    for (uint32_t i = 0; i < arbiterCount; ++i)
+    {
+        m_constraintRowOffsets[i] = rowCount;
+        rowCount += m_contactConstraints[i]->GetRowCount();
+    }
+    m_constraintRowOffsets.back() = rowCount;
+    m_constraintRows.resize(rowCount);
+
+    ParallelFor(m_taskExecutor, arbiterCount, k_constraintGrainSize, [this](uint32_t begin, uint32_t end, uint32_t)
+    {
+        for (uint32_t i = begin; i < end; ++i)
+        {
+            m_contactConstraints[i]->BuildRows(m_solverBodies, m_constraintRows.data() + m_constraintRowOffsets[i]);
+        }
+    });
+
+    for (uint32_t i = 0; i < m_iterations; ++i)
+    {
+        float residual = SolveRows(m_constraintRows.data(), m_constraintRows.size(), m_solverBodies);
+
+        for (size_t j = 0; j < m_joints.size(); ++j)
+        {
+            residual = glm::max(residual, SolveRows(m_joints[j]->m_rows, m_joints[j]->m_rowCount, m_solverBodies));
+        }
+
+        m_velocityStats.m_iterations = i + 1;
+        m_velocityStats.m_residual = residual;
+
+        if (residual <= m_impulseTolerance)
+        {
+            break;
+        }
+    }
+
+    for (uint32_t i = 0; i < arbiterCount; ++i)
+    {
+        m_contactConstraints[i]->StoreRows(m_constraintRows.data() + m_constraintRowOffsets[i]);
+    }
+}
+
+void World::SolvePseudoImpulses()
+{
+    for (size_t i = 0; i < m_contactConstraints.size(); ++i)
+    {
+        m_contactConstraints[i]->WarmStartPseudoImpulse(m_solverBodies);
+    }
+
+    for (uint32_t i = 0; i < m_positionIterations; ++i)
+    {
+        float residual = 0.0f;
+
+        for (size_t j = 0; j < m_contactConstraints.size(); ++j)
+        {
+            residual = glm::max(residual, m_contactConstraints[j]->ApplyPseudoImpulse(m_solverBodies));
+        }
+
+        m_positionStats.m_iterations = i + 1;
+        m_positionStats.m_residual = residual;
+
+        if (residual <= m_impulseTolerance)
+        {
+            break;
+        }
+    }
+}
+
+void World::SolveSubSteps(float elapsedTime)
+{
+    const float subStep = elapsedTime / static_cast<float>(m_subStepCount);
+    const float invSubStep = (subStep > 0.0f) ? 1.0f / subStep : 0.0f;
+
+    // A contact stiffer than a quarter of the substep rate would overshoot.
+    const Softness contactSoftness = MakeSoftness(glm::min(m_contactHertz, 0.25f * invSubStep), m_contactDampingRatio, subStep);
+    const Softness jointSoftness = MakeSoftness(m_jointHertz, m_jointDampingRatio, subStep);
+    const uint32_t bodyCount = static_cast<uint32_t>(m_bodies.size());
+
+    for (uint32_t i = 0; i < m_subStepCount; ++i)
+    {
+        ParallelFor(m_taskExecutor, bodyCount, k_bodyGrainSize, [this, subStep](uint32_t begin, uint32_t end, uint32_t)
+        {
+            m_solverBodies.IntegrateVelocities(begin, end, subStep);
+        });
+
+        WarmStart();
+
+        for (uint32_t j = 0; j < m_subStepIterations; ++j)
+        {
+            float residual = 0.0f;
+
+            for (size_t k = 0; k < m_contactConstraints.size(); ++k)
+            {
+                residual = glm::max(residual, m_contactConstraints[k]->SolveSoft(m_solverBodies, contactSoftness, invSubStep, m_maxContactPushVelocity, true));
+            }
+
+            for (size_t k = 0; k < m_joints.size(); ++k)
+            {
+                residual = glm::max(residual, SolveRowBlockSoft(m_joints[k]->m_rows, m_joints[k]->m_rowCount, m_joints[k]->m_mass, m_solverBodies, jointSoftness, true));
+            }
+
+            if (residual <= m_impulseTolerance)
+            {
+                break;
+            }
+        }
+
+        ParallelFor(m_taskExecutor, bodyCount, k_bodyGrainSize, [this, subStep](uint32_t begin, uint32_t end, uint32_t)
+        {
+            m_solverBodies.IntegratePositions(begin, end, subStep);
+        });
+
+        // Relax: remove the velocity added by the position correction.
+        for (uint32_t j = 0; j < m_subStepIterations; ++j)
+        {
+            float residual = 0.0f;
+
+            for (size_t k = 0; k < m_contactConstraints.size(); ++k)
+            {
+                residual = glm::max(residual, m_contactConstraints[k]->SolveSoft(m_solverBodies, contactSoftness, invSubStep, m_maxContactPushVelocity, false));
+            }
+
+            for (size_t k = 0; k < m_joints.size(); ++k)
+            {
+                residual = glm::max(residual, SolveRowBlockSoft(m_joints[k]->m_rows, m_joints[k]->m_rowCount, m_joints[k]->m_mass, m_solverBodies, jointSoftness, false));
+            }
+
+            m_velocityStats.m_iterations = glm::max(m_velocityStats.m_iterations, j + 1);
+            m_velocityStats.m_residual = residual;
+
+            if (residual <= m_impulseTolerance)
+            {
+                break;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < m_contactConstraints.size(); ++i)
+    {
+        m_contactConstraints[i]->ApplyRestitution(m_solverBodies);
+    }
+}
+
+void World::Step(float elapsedTime)
+{
+    ResizeWorkers();
+
+    ApplyCommands();
+    ApplyBodyWrites();
+    UpdateMaterials();
+
+    BroadPhase(elapsedTime);
+
+    for (size_t i = 0; i < m_articulations.size(); ++i)
+    {
+        m_articulations[i]->PreStep(elapsedTime);
+    }
+
+    // Forces are integrated into the staged velocities, which are written
+    // back to the bodies after the solve. Narrowphase does not read
+    // velocities, so this can run alongside it.
+    m_solverBodies.Stage(m_bodyStates.data(), m_bodyStates.size());
+
+    auto narrowPhase = [this](uint32_t begin, uint32_t end, uint32_t workerIndex)
+    {
+        NarrowPhase(begin, end, m_workers[workerIndex]);
+    };
+    auto integrateForces = [this, elapsedTime](uint32_t begin, uint32_t end, uint32_t)
+    {
+        IntegrateForces(begin, end, elapsedTime);
+    };
+
+    m_taskGraph.Clear();
+    AddTask(m_taskGraph, static_cast<uint32_t>(m_candidatePairs.size()), k_narrowPhaseGrainSize, narrowPhase);
+    AddTask(m_taskGraph, static_cast<uint32_t>(m_bodies.size()), k_bodyGrainSize, integrateForces);
+    m_taskExecutor->Run(m_taskGraph);
+
+    UpdateArbiters();
+
+    float invElapsedTime = (elapsedTime > 0.0f) ? 1.0f / elapsedTime : 0.0f;
+
+    if (m_subStepCount > 0)
+    {
+        m_solverBodies.StageForces(m_bodyStates.data(), m_bodyStates.size(), m_gravity);
+    }
+
+    m_contactConstraints.clear();
+    for (auto& arb : m_arbiters)
+    {
+        if (!arb.second.m_isTrigger)
+        {
+            m_contactConstraints.push_back(&arb.second);
+        }
+    }
+
+    if (m_deterministic)
+    {
+        std::sort(m_contactConstraints.begin(), m_contactConstraints.end(), CompareArbiterKeys);
+    }
+
+    // The substepping solver has its own soft position correction.
+    const bool useSplitImpulse = m_useSplitImpulse && (m_subStepCount == 0);
+    ParallelFor(m_taskExecutor, static_cast<uint32_t>(m_contactConstraints.size()), k_constraintGrainSize, [this, invElapsedTime, useSplitImpulse](uint32_t begin, uint32_t end, uint32_t)
+    {
+        for (uint32_t i = begin; i < end; ++i)
+        {
+            m_contactConstraints[i]->PreStep(m_solverBodies, invElapsedTime, m_useBlockSolver, useSplitImpulse);
+        }
+    });
+
+    for (size_t i = 0; i < m_joints.size(); ++i)
+    {
+        PreStepJoint(m_joints[i], m_solverBodies, invElapsedTime);
+    }
+
+    m_velocityStats = {0, 0.0f};
+    m_positionStats = {0, 0.0f};
+
+    if (m_subStepCount > 0)
+    {
+        SolveSubSteps(elapsedTime);
+    }
+    else if (m_solverType == SolverType::Wide)
+    {
+        WarmStart();
+        m_wideContactSolver.Prepare(m_contactConstraints.data(), m_contactConstraints.size(), m_solverBodies);
+
+        for (uint32_t i = 0; i < m_iterations; ++i)
+        {
+            float residual = m_wideContactSolver.ApplyImpulses(m_solverBodies);
+
+            for (size_t j = 0; j < m_joints.size(); ++j)
+            {
+                residual = glm::max(residual, SolveRowBlock(m_joints[j]->m_rows, m_joints[j]->m_rowCount, m_joints[j]->m_mass, m_solverBodies));
+            }
+
+            m_velocityStats.m_iterations = i + 1;
+            m_velocityStats.m_residual = residual;
+
+            if (residual <= m_impulseTolerance)
+            {
+                break;
+            }
+        }
+
+        m_wideContactSolver.StoreImpulses();
+
+        if (useSplitImpulse)
+        {
+            SolvePseudoImpulses();
+        }
+    }
+    else if (m_solverType == SolverType::Rows)
+    {
+        WarmStart();
+        SolveConstraintRows();
+
+        if (useSplitImpulse)
+        {
+            SolvePseudoImpulses();
+        }
+    }
+    else
+    {
+        WarmStart();
+        const uint32_t jacobiThreshold = (m_solverType == SolverType::Jacobi) ? 0 : m_islandJacobiThreshold;
+        m_islandSolver.Build(m_contactConstraints.data(), m_contactConstraints.size(), m_joints.data(), m_joints.size(), m_solverBodies, m_islandColoringThreshold, jacobiThreshold, m_useJointTrees);
+        m_velocityStats = m_islandSolver.Solve(m_taskExecutor, m_solverBodies, m_iterations, IslandPass::Velocity, m_impulseTolerance);
+
+        if (useSplitImpulse)
+        {
+            m_positionStats = m_islandSolver.Solve(m_taskExecutor, m_solverBodies, m_positionIterations, IslandPass::Position, m_impulseTolerance);
+        }
+    }
+
+    m_solverBodies.WriteBack(m_bodyStates.data(), m_bodyStates.size());
+
+    for (size_t i = 0; i < m_articulations.size(); ++i)
+    {
+        m_articulations[i]->ApplyImpulses();
+    }
+
+    for (size_t i = 0; i < m_bodies.size(); ++i)
+    {
+        const BodyState& s = m_bodyStates[i];
+
+        if (s.m_useCCD && (s.m_invMass != 0.0f) && !m_bodies[i]->m_bvh.IsEmpty())
+        {
+            IntegrateContinuous(m_bodies[i], elapsedTime);
+        }
+    }
+
+    ParallelFor(m_taskExecutor, static_cast<uint32_t>(m_bodies.size()), k_bodyGrainSize, [this, elapsedTime](uint32_t begin, uint32_t end, uint32_t)
+    {
+        IntegrateVelocities(begin, end, elapsedTime);
+    });
+
+    for (size_t i = 0; i < m_articulations.size(); ++i)
+    {
+        m_articulations[i]->UpdatePositions();
+    }
+
+    PublishTransforms();
+
+    if (m_deterministic)
+    {
+        m_stateHash = ComputeStateHash();
+    }
+}
+
+uint64_t HashBytes(uint64_t hash, const void* data, size_t size)
+{
+    // FNV-1a.
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash ^= bytes[i];
+        hash *= 0x100000001B3ull;
+    }
+    return hash;
+}
+
+uint64_t World::ComputeStateHash() const
+{
+    uint64_t hash = 0xCBF29CE484222325ull;
+    for (size_t i = 0; i < m_bodies.size(); ++i)
+    {
+        const BodyState& s = m_bodyStates[i];
+        hash = HashBytes(hash, &s.m_position, sizeof(s.m_position));
+        hash = HashBytes(hash, &s.m_rotation, sizeof(s.m_rotation));
+        hash = HashBytes(hash, &s.m_velocity, sizeof(s.m_velocity));
+        hash = HashBytes(hash, &s.m_angularVelocity, sizeof(s.m_angularVelocity));
     }
+    return hash;
 }
\ No newline at end of file
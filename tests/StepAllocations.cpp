@@ -0,0 +1,326 @@
+#include "Body.h"
+#include "Joint.h"
+#include "ThreadPool.h"
+#include "World.h"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <new>
+
+#if defined(_WIN32)
+#include <malloc.h>
+#endif
+
+// Counts the allocations made through the global operator new while
+// counting is switched on.
+static std::atomic<bool> g_counting(false);
+static std::atomic<size_t> g_allocationCount(0);
+
+static void* Allocate(size_t size)
+{
+    if (g_counting)
+    {
+        ++g_allocationCount;
+    }
+
+    void* p = std::malloc(size ? size : 1);
+    if (!p)
+    {
+        throw std::bad_alloc();
+    }
+
+    return p;
+}
+
+static void* AllocateAligned(size_t size, std::align_val_t alignment)
+{
+    if (g_counting)
+    {
+        ++g_allocationCount;
+    }
+
+    const size_t align = static_cast<size_t>(alignment);
+#if defined(_WIN32)
+    void* p = _aligned_malloc(size ? size : 1, align);
+#else
+    // aligned_alloc takes only multiples of the alignment.
+    void* p = std::aligned_alloc(align, ((size ? size : 1) + align - 1) / align * align);
+#endif
+    if (!p)
+    {
+        throw std::bad_alloc();
+    }
+
+    return p;
+}
+
+static void FreeAligned(void* p)
+{
+#if defined(_WIN32)
+    _aligned_free(p);
+#else
+    std::free(p);
+#endif
+}
+
+void* operator new(size_t size) { return Allocate(size); }
+void* operator new[](size_t size) { return Allocate(size); }
+void* operator new(size_t size, std::align_val_t alignment) { return AllocateAligned(size, alignment); }
+void* operator new[](size_t size, std::align_val_t alignment) { return AllocateAligned(size, alignment); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { FreeAligned(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { FreeAligned(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { FreeAligned(p); }
+void operator delete[](void* p, size_t, std::align_val_t) noexcept { FreeAligned(p); }
+
+constexpr float k_timeStep = 1.0f / 60.0f;
+constexpr uint32_t k_warmUpSteps = 30;
+constexpr uint32_t k_measuredSteps = 60;
+
+static Body* CreateBox(World& world, Material* material, const glm::vec3& halfSize, float mass, const glm::vec3& position)
+{
+    Handle<Body> handle = world.CreateBody();
+    ShapeBox* shape = static_cast<ShapeBox*>(world.Get(world.CreateShape(handle, ShapeType::Box)));
+    shape->Set(halfSize);
+    shape->m_material = material;
+
+    Body* body = world.Get(handle);
+    body->SetMass(mass);
+    body->m_state->m_position = position;
+    world.Add(body);
+
+    return body;
+}
+
+static Body* CreateGround(World& world, Material* material)
+{
+    return CreateBox(world, material, glm::vec3(50.0f, 10.0f, 10.0f), std::numeric_limits<float>::infinity(), glm::vec3(0.0f, -10.0f, 0.0f));
+}
+
+static void CreateStack(World& world, Material* material)
+{
+    CreateGround(world, material);
+
+    for (int i = 0; i < 10; ++i)
+    {
+        CreateBox(world, material, glm::vec3(0.5f, 0.5f, 0.5f), 1.0f, glm::vec3(0.01f * (i % 3), 0.51f + 1.05f * i, 0.0f));
+    }
+}
+
+static void CreatePyramid(World& world, Material* material)
+{
+    CreateGround(world, material);
+
+    glm::vec3 x(-6.0f, 0.75f, 0.0f);
+
+    for (int i = 0; i < 12; ++i)
+    {
+        glm::vec3 y = x;
+
+        for (int j = i; j < 12; ++j)
+        {
+            CreateBox(world, material, glm::vec3(0.5f, 0.5f, 0.5f), 10.0f, y);
+            y += glm::vec3(1.125f, 0.0f, 0.0f);
+        }
+
+        x += glm::vec3(0.5625f, 2.0f, 0.0f);
+    }
+}
+
+static void CreateChain(World& world, Material* material)
+{
+    Body* b1 = CreateGround(world, material);
+
+    for (int i = 0; i < 15; ++i)
+    {
+        Body* b2 = CreateBox(world, material, glm::vec3(0.375f, 0.125f, 0.375f), 10.0f, glm::vec3(0.5f + i, 12.0f, 0.0f));
+
+        JointSpherical* joint = static_cast<JointSpherical*>(world.Get(world.CreateJoint(JointType::Spherical)));
+        joint->Set(b1, b2, glm::vec3(float(i), 12.0f, 0.0f));
+        world.Add(joint);
+
+        b1 = b2;
+    }
+}
+
+static void CreateCompound(World& world, Material* material)
+{
+    CreateGround(world, material);
+
+    for (int c = 0; c < 2; ++c)
+    {
+        Handle<Body> handle = world.CreateBody();
+
+        for (int x = 0; x < 6; ++x)
+        {
+            for (int z = 0; z < 6; ++z)
+            {
+                ShapeBox* shape = static_cast<ShapeBox*>(world.Get(world.CreateShape(handle, ShapeType::Box)));
+                shape->Set(glm::vec3(0.25f, 0.25f, 0.25f));
+                shape->SetTransform(glm::vec3(x * 0.5f - 1.25f, 0.0f, z * 0.5f - 1.25f), glm::quat(1.0f, 0.0f, 0.0f, 0.0f));
+                shape->m_material = material;
+            }
+        }
+
+        Body* body = world.Get(handle);
+        body->SetMass(36.0f);
+        body->m_state->m_position = glm::vec3(0.3f * c, 0.3f + 1.5f * c, 0.0f);
+        world.Add(body);
+    }
+}
+
+static void CreateBullets(World& world, Material* material)
+{
+    CreateGround(world, material);
+    CreateBox(world, material, glm::vec3(3.0f, 0.05f, 3.0f), std::numeric_limits<float>::infinity(), glm::vec3(0.0f, 5.0f, 0.0f));
+
+    for (int i = 0; i < 4; ++i)
+    {
+        Body* body = CreateBox(world, material, glm::vec3(0.25f, 0.25f, 0.25f), 50.0f, glm::vec3(-1.5f + i, 15.0f, 0.0f));
+        body->m_state->m_useCCD = true;
+    }
+}
+
+// Fires the bullets at the platform again every so often, so that the
+// measured steps keep hitting it between steps.
+static void UpdateBullets(World& world, uint32_t step)
+{
+    if (step % 30 != 0)
+    {
+        return;
+    }
+
+    for (size_t i = 2; i < world.m_bodies.size(); ++i)
+    {
+        Body* body = world.m_bodies[i];
+        body->m_state->m_position = glm::vec3(-1.5f + (i - 2), 15.0f, 0.0f);
+        body->m_state->m_rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+        body->m_state->m_velocity = glm::vec3(0.0f, -300.0f, 0.0f);
+        body->m_state->m_angularVelocity = glm::vec3(0.0f, 0.0f, 0.0f);
+    }
+}
+
+struct Scene
+{
+    const char* m_name;
+    void (*m_create)(World&, Material*);
+    // Called before each step, if set.
+    void (*m_update)(World&, uint32_t);
+};
+
+struct SolverConfig
+{
+    const char* m_name;
+    SolverType m_solverType;
+    uint32_t m_subStepCount;
+    uint32_t m_islandColoringThreshold;
+    bool m_useBlockSolver;
+    bool m_useSplitImpulse;
+    bool m_useJointTrees;
+    bool m_useSpeculativeContacts;
+    bool m_deterministic;
+};
+
+// Builds the scene, sizes the world for it and lets it settle, then returns
+// the number of allocations made by the steps after that.
+static size_t CountStepAllocations(const Scene& scene, const SolverConfig& config, TaskExecutor* taskExecutor)
+{
+    World world(glm::vec3(0.0f, -10.0f, 0.0f), 10);
+    if (taskExecutor)
+    {
+        world.m_taskExecutor = taskExecutor;
+    }
+
+    world.m_solverType = config.m_solverType;
+    world.m_subStepCount = config.m_subStepCount;
+    world.m_islandColoringThreshold = config.m_islandColoringThreshold;
+    world.m_useBlockSolver = config.m_useBlockSolver;
+    world.m_useSplitImpulse = config.m_useSplitImpulse;
+    world.m_useJointTrees = config.m_useJointTrees;
+    world.m_useSpeculativeContacts = config.m_useSpeculativeContacts;
+    world.m_deterministic = config.m_deterministic;
+
+    Handle<Material> material = world.CreateMaterial();
+    scene.m_create(world, world.Get(material));
+
+    uint32_t shapeCount = 0;
+    for (Body* body : world.m_bodies)
+    {
+        shapeCount += static_cast<uint32_t>(body->m_shapes.size());
+    }
+
+    world.Reserve(static_cast<uint32_t>(world.m_bodies.size()), static_cast<uint32_t>(world.m_joints.size()), 8 * shapeCount);
+
+    for (uint32_t i = 0; i < k_warmUpSteps + k_measuredSteps; ++i)
+    {
+        if (scene.m_update)
+        {
+            scene.m_update(world, i);
+        }
+
+        if (i == k_warmUpSteps)
+        {
+            g_allocationCount = 0;
+            g_counting = true;
+        }
+
+        world.Step(k_timeStep);
+    }
+
+    g_counting = false;
+
+    return g_allocationCount;
+}
+
+int main()
+{
+    const Scene scenes[] =
+    {
+        { "stack", CreateStack, nullptr },
+        { "pyramid", CreatePyramid, nullptr },
+        { "chain", CreateChain, nullptr },
+        { "compound", CreateCompound, nullptr },
+        { "bullets", CreateBullets, UpdateBullets },
+    };
+
+    const SolverConfig configs[] =
+    {
+        { "sequential", SolverType::Sequential, 0, 256, false, false, false, false, false },
+        { "colored islands", SolverType::Sequential, 0, 1, false, false, false, false, false },
+        { "block split impulse", SolverType::Sequential, 0, 256, true, true, false, false, false },
+        { "joint trees", SolverType::Sequential, 0, 256, false, false, true, false, false },
+        { "jacobi", SolverType::Jacobi, 0, 256, false, false, false, false, false },
+        { "wide", SolverType::Wide, 0, 256, false, true, false, false, false },
+        { "rows", SolverType::Rows, 0, 256, false, true, false, false, false },
+        { "substeps", SolverType::Sequential, 4, 256, false, false, false, false, false },
+        { "speculative deterministic", SolverType::Sequential, 0, 256, false, false, false, true, true },
+    };
+
+    ThreadPool threadPool(4);
+    TaskExecutor* taskExecutors[] = { nullptr, &threadPool };
+    const char* taskExecutorNames[] = { "serial", "thread pool" };
+
+    int failures = 0;
+
+    for (const Scene& scene : scenes)
+    {
+        for (const SolverConfig& config : configs)
+        {
+            for (int i = 0; i < 2; ++i)
+            {
+                const size_t allocationCount = CountStepAllocations(scene, config, taskExecutors[i]);
+                if (allocationCount)
+                {
+                    std::printf("%s, %s, %s: %zu allocations in %u steps\n", scene.m_name, config.m_name, taskExecutorNames[i], allocationCount, k_measuredSteps);
+                    ++failures;
+                }
+            }
+        }
+    }
+
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
\ No newline at end of file